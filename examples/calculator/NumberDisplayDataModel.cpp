@@ -56,6 +56,8 @@ setInData(std::shared_ptr<NodeData> data, int)
 {
   auto numberData = std::dynamic_pointer_cast<DecimalData>(data);
 
+  _number = numberData;
+
   if (numberData)
   {
     modelValidationState = NodeValidationState::Valid;
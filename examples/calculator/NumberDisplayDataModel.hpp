@@ -7,6 +7,8 @@
 
 #include <iostream>
 
+class DecimalData;
+
 using QtNodes::PortType;
 using QtNodes::PortIndex;
 using QtNodes::NodeData;
@@ -64,10 +66,16 @@ public:
   QString
   validationMessage() const override;
 
+  /// Last number received, or nullptr if the input is missing.
+  std::shared_ptr<DecimalData>
+  number() const { return _number; }
+
 private:
 
   NodeValidationState modelValidationState = NodeValidationState::Warning;
   QString modelValidationError = QStringLiteral("Missing or incorrect inputs");
 
+  std::shared_ptr<DecimalData> _number;
+
   QLabel * _label;
 };
@@ -0,0 +1,451 @@
+#include "FlowCompiler.hpp"
+
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonValue>
+#include <QtCore/QRegularExpression>
+
+namespace
+{
+
+QJsonObject
+parseObject(QByteArray const &json, char const *what)
+{
+  QJsonParseError error;
+  QJsonDocument document = QJsonDocument::fromJson(json, &error);
+
+  if (error.error != QJsonParseError::NoError || !document.isObject())
+  {
+    throw std::runtime_error(std::string("Cannot parse ") + what + ": " +
+                             error.errorString().toStdString());
+  }
+
+  return document.object();
+}
+
+
+std::runtime_error
+compileError(QString const &message)
+{
+  return std::runtime_error(message.toStdString());
+}
+
+
+QString
+indent(QString const &code, QString const &prefix)
+{
+  QStringList lines = code.split('\n');
+
+  for (QString &line : lines)
+  {
+    if (!line.trimmed().isEmpty())
+      line = prefix + line;
+  }
+
+  return lines.join('\n');
+}
+
+
+QString
+templateCode(QJsonValue const &value)
+{
+  // Code may be given as one string or as an array of lines.
+  if (value.isArray())
+  {
+    QStringList lines;
+    for (QJsonValue const &line : value.toArray())
+      lines << line.toString();
+
+    return lines.join('\n');
+  }
+
+  return value.toString();
+}
+
+}
+
+
+void
+FlowCompiler::
+loadTemplates(QByteArray const &templatesJson)
+{
+  QJsonObject templates = parseObject(templatesJson, "templates");
+
+  _types      = templates["types"].toObject();
+  _converters = templates["converters"].toObject();
+  _models     = templates["models"].toObject();
+}
+
+
+QString
+FlowCompiler::
+cType(QString const &typeId) const
+{
+  QJsonValue type = _types[typeId];
+
+  if (!type.isObject())
+    throw compileError(QString("No C++ type for data type '%1'").arg(typeId));
+
+  return type.toObject()["type"].toString();
+}
+
+
+QString
+FlowCompiler::
+zero(QString const &typeId) const
+{
+  cType(typeId);
+
+  return _types[typeId].toObject()["zero"].toString();
+}
+
+
+QString
+FlowCompiler::
+expand(QString code,
+       std::vector<PortVariable> const &inputs,
+       std::vector<PortVariable> const &outputs,
+       QString const &parameter,
+       QString const &result) const
+{
+  static QRegularExpression const placeholder(
+    QStringLiteral("\\$(?:(in|out)(\\d+)(_ok)?|(param)|(result)(_ok)?)"));
+
+  QString expanded;
+  int     last = 0;
+
+  QRegularExpressionMatchIterator it = placeholder.globalMatch(code);
+
+  while (it.hasNext())
+  {
+    QRegularExpressionMatch match = it.next();
+
+    expanded += code.midRef(last, match.capturedStart() - last);
+    last      = match.capturedEnd();
+
+    if (!match.captured(1).isEmpty())
+    {
+      bool const isInput = (match.captured(1) == "in");
+      auto const &ports  = isInput ? inputs : outputs;
+
+      std::size_t const index = match.captured(2).toUInt();
+
+      if (index >= ports.size())
+        throw compileError(QString("Template refers to missing port %1")
+                           .arg(match.captured(0)));
+
+      bool const validity = !match.captured(3).isEmpty();
+
+      expanded += validity ? ports[index].valid : ports[index].value;
+    }
+    else if (!match.captured(4).isEmpty())
+    {
+      if (parameter.isEmpty())
+        throw compileError("$param used by a model that is not a source");
+
+      expanded += parameter;
+    }
+    else
+    {
+      if (result.isEmpty())
+        throw compileError("$result used by a model that is not a sink");
+
+      bool const validity = !match.captured(6).isEmpty();
+
+      expanded += validity ? result + "_valid" : result;
+    }
+  }
+
+  expanded += code.midRef(last);
+
+  return expanded;
+}
+
+
+void
+FlowCompiler::
+compile(QByteArray const &flowJson, QString const &functionName)
+{
+  static QRegularExpression const identifier(
+    QStringLiteral("^[A-Za-z_][A-Za-z0-9_]*$"));
+
+  if (!identifier.match(functionName).hasMatch())
+    throw compileError(QString("'%1' is not a valid function name").arg(functionName));
+
+  QJsonObject const flow = parseObject(flowJson, "flow");
+
+  QJsonArray const nodesJson       = flow["nodes"].toArray();
+  QJsonArray const connectionsJson = flow["connections"].toArray();
+
+  int const nodeCount = nodesJson.size();
+
+  std::map<QString, int> indexById;
+  std::vector<QJsonObject> modelJson(nodeCount);
+  std::vector<QJsonObject> modelTemplate(nodeCount);
+  std::vector<QString> nodeId(nodeCount);
+
+  for (int i = 0; i < nodeCount; ++i)
+  {
+    QJsonObject node = nodesJson[i].toObject();
+
+    nodeId[i]    = node["id"].toString();
+    modelJson[i] = node["model"].toObject();
+
+    QString const name = modelJson[i]["name"].toString();
+
+    if (!_models.contains(name))
+      throw compileError(QString("No code template for model '%1'").arg(name));
+
+    modelTemplate[i] = _models[name].toObject();
+    indexById[nodeId[i]] = i;
+  }
+
+  // Every input port is fed by at most one connection.
+  struct Incoming
+  {
+    int     node = -1;
+    int     port = -1;
+    QString converter;
+  };
+
+  std::vector<std::vector<Incoming>> incoming(nodeCount);
+  std::vector<std::set<int>> consumers(nodeCount);
+  std::vector<int> pendingInputs(nodeCount, 0);
+
+  for (int i = 0; i < nodeCount; ++i)
+  {
+    incoming[i].resize(modelTemplate[i]["inputs"].toArray().size());
+  }
+
+  for (QJsonValue const &value : connectionsJson)
+  {
+    QJsonObject connection = value.toObject();
+
+    auto outIt = indexById.find(connection["out_id"].toString());
+    auto inIt  = indexById.find(connection["in_id"].toString());
+
+    if (outIt == indexById.end() || inIt == indexById.end())
+      throw compileError("Connection refers to an unknown node");
+
+    int const inNode  = inIt->second;
+    int const inPort  = connection["in_index"].toInt();
+
+    if (inPort < 0 || inPort >= int(incoming[inNode].size()))
+      throw compileError(QString("Node %1 has no input port %2")
+                         .arg(nodeId[inNode]).arg(inPort));
+
+    Incoming &in = incoming[inNode][inPort];
+
+    if (in.node != -1)
+      throw compileError(QString("Input port %1 of node %2 is connected twice")
+                         .arg(inPort).arg(nodeId[inNode]));
+
+    in.node = outIt->second;
+    in.port = connection["out_index"].toInt();
+
+    if (in.port < 0 ||
+        in.port >= modelTemplate[in.node]["outputs"].toArray().size())
+      throw compileError(QString("Node %1 has no output port %2")
+                         .arg(nodeId[in.node]).arg(in.port));
+
+    QJsonValue converter = connection["converter"];
+    if (converter.isObject())
+    {
+      QString const key =
+        converter.toObject()["out"].toObject()["id"].toString() + "->" +
+        converter.toObject()["in"].toObject()["id"].toString();
+
+      if (!_converters.contains(key))
+        throw compileError(QString("No code template for converter '%1'").arg(key));
+
+      in.converter = _converters[key].toString();
+    }
+
+    if (consumers[in.node].insert(inNode).second)
+      ++pendingInputs[inNode];
+  }
+
+  // Dependency order, ties broken by the order of the nodes in the file.
+  std::vector<int> order;
+  std::set<int>    ready;
+
+  for (int i = 0; i < nodeCount; ++i)
+  {
+    if (pendingInputs[i] == 0)
+      ready.insert(i);
+  }
+
+  while (!ready.empty())
+  {
+    int const i = *ready.begin();
+    ready.erase(ready.begin());
+
+    order.push_back(i);
+
+    for (int consumer : consumers[i])
+    {
+      if (--pendingInputs[consumer] == 0)
+        ready.insert(consumer);
+    }
+  }
+
+  if (int(order.size()) != nodeCount)
+    throw compileError("The flow contains a cycle");
+
+  // Sources and sinks are numbered in file order.
+  std::vector<int> sourceIndex(nodeCount, -1);
+  std::vector<int> resultIndex(nodeCount, -1);
+
+  QString inputsStruct  = functionName.at(0).toUpper() + functionName.mid(1) + "Inputs";
+  QString outputsStruct = functionName.at(0).toUpper() + functionName.mid(1) + "Outputs";
+
+  QString inputFields;
+  QString outputFields;
+
+  _sourceCount = 0;
+  _resultCount = 0;
+
+  for (int i = 0; i < nodeCount; ++i)
+  {
+    QJsonObject const &t = modelTemplate[i];
+
+    if (t.contains("source"))
+    {
+      QString const type = t["outputs"].toArray().at(0).toString();
+
+      QJsonValue defaultValue = modelJson[i][t["source"].toString()];
+
+      double const number = defaultValue.isString() ?
+                            defaultValue.toString().toDouble() :
+                            defaultValue.toDouble();
+
+      QString const literal = (cType(type) == "double") ?
+                              QString::number(number, 'g', 17) :
+                              QString::number(qint64(number));
+
+      sourceIndex[i] = _sourceCount++;
+
+      inputFields += QString("  %1 source%2 = %3; // %4 %5\n")
+                     .arg(cType(type)).arg(sourceIndex[i]).arg(literal)
+                     .arg(modelJson[i]["name"].toString(), nodeId[i]);
+    }
+
+    if (t.contains("sink"))
+    {
+      QString const type = t["sink"].toString();
+
+      resultIndex[i] = _resultCount++;
+
+      outputFields += QString("  %1 result%2 = %3; // %4 %5\n"
+                              "  bool result%2_valid = false;\n")
+                      .arg(cType(type)).arg(resultIndex[i]).arg(zero(type))
+                      .arg(modelJson[i]["name"].toString(), nodeId[i]);
+    }
+  }
+
+  _header =
+    QString("// Generated by flow_compiler. Do not edit.\n"
+            "#pragma once\n"
+            "\n"
+            "struct %1\n"
+            "{\n"
+            "%2"
+            "};\n"
+            "\n"
+            "struct %3\n"
+            "{\n"
+            "%4"
+            "};\n"
+            "\n"
+            "void\n"
+            "%5(%1 const &inputs, %3 &outputs);\n")
+    .arg(inputsStruct, inputFields, outputsStruct, outputFields, functionName);
+
+  QString body;
+
+  for (int i : order)
+  {
+    QJsonObject const &t = modelTemplate[i];
+
+    QJsonArray const inputTypes  = t["inputs"].toArray();
+    QJsonArray const outputTypes = t["outputs"].toArray();
+
+    std::vector<PortVariable> inputs;
+    std::vector<PortVariable> outputs;
+
+    for (int port = 0; port < inputTypes.size(); ++port)
+    {
+      Incoming const &in = incoming[i][port];
+      QString const type = inputTypes[port].toString();
+
+      if (in.node == -1)
+      {
+        inputs.push_back({zero(type), "false", type});
+        continue;
+      }
+
+      QString value = QString("n%1_out%2").arg(in.node).arg(in.port);
+
+      if (!in.converter.isEmpty())
+      {
+        QString converted = in.converter;
+        value = "(" + converted.replace("$in", value) + ")";
+      }
+
+      inputs.push_back({value, QString("n%1_out%2_ok").arg(in.node).arg(in.port), type});
+    }
+
+    body += QString("  // n%1: %2 %3\n")
+            .arg(i).arg(modelJson[i]["name"].toString(), nodeId[i]);
+
+    for (int port = 0; port < outputTypes.size(); ++port)
+    {
+      QString const type = outputTypes[port].toString();
+      QString const name = QString("n%1_out%2").arg(i).arg(port);
+
+      outputs.push_back({name, name + "_ok", type});
+
+      body += QString("  %1 %2 = %3;\n"
+                      "  bool %2_ok = false;\n")
+              .arg(cType(type), name, zero(type));
+    }
+
+    QString const parameter = (sourceIndex[i] >= 0) ?
+                              QString("inputs.source%1").arg(sourceIndex[i]) :
+                              QString();
+
+    QString const result = (resultIndex[i] >= 0) ?
+                           QString("outputs.result%1").arg(resultIndex[i]) :
+                           QString();
+
+    QString const code = expand(templateCode(t["code"]),
+                                inputs, outputs, parameter, result);
+
+    body += "  {\n" + indent(code, "    ") + "\n  }\n\n";
+  }
+
+  body.chop(1);
+
+  _body = QString("void\n"
+                  "%1(%2 const &inputs, %3 &outputs)\n"
+                  "{\n"
+                  "%4"
+                  "}\n")
+          .arg(functionName, inputsStruct, outputsStruct, body);
+}
+
+
+QString
+FlowCompiler::
+source(QString const &headerFileName) const
+{
+  return QString("// Generated by flow_compiler. Do not edit.\n"
+                 "#include \"%1\"\n"
+                 "\n"
+                 "%2")
+         .arg(headerFileName, _body);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include <vector>
+
+/// Translates a saved flow into a standalone C++ function.
+///
+/// Every model of the flow needs a code template (see
+/// calculator_templates.json). Nodes are emitted in dependency order,
+/// every output port becomes a pair of plain locals holding the value and
+/// its validity, and connections with a type converter get the converter's
+/// expression applied in place. Source models turn into fields of an
+/// `<Function>Inputs` struct and sink models into fields of
+/// `<Function>Outputs`, both listed in the order the nodes appear in the
+/// file.
+///
+/// Errors are reported by throwing std::runtime_error.
+class FlowCompiler
+{
+public:
+
+  void
+  loadTemplates(QByteArray const &templatesJson);
+
+  void
+  compile(QByteArray const &flowJson, QString const &functionName);
+
+  QString const &
+  header() const { return _header; }
+
+  /// Source file; includes the header as `headerFileName`.
+  QString
+  source(QString const &headerFileName) const;
+
+  int
+  sourceCount() const { return _sourceCount; }
+
+  int
+  resultCount() const { return _resultCount; }
+
+private:
+
+  struct PortVariable
+  {
+    QString value;
+    QString valid;
+    QString type; // data type id
+  };
+
+  QString
+  cType(QString const &typeId) const;
+
+  QString
+  zero(QString const &typeId) const;
+
+  QString
+  expand(QString code,
+         std::vector<PortVariable> const &inputs,
+         std::vector<PortVariable> const &outputs,
+         QString const &parameter,
+         QString const &result) const;
+
+private:
+
+  QJsonObject _types;
+  QJsonObject _converters;
+  QJsonObject _models;
+
+  QString _header;
+  QString _body;
+
+  int _sourceCount = 0;
+  int _resultCount = 0;
+};
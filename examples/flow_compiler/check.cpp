@@ -0,0 +1,288 @@
+#include <nodes/DataModelRegistry>
+#include <nodes/FlowScene>
+#include <nodes/Node>
+#include <nodes/TypeConverter>
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtWidgets/QApplication>
+
+#include <array>
+#include <iostream>
+#include <map>
+#include <random>
+
+#include "NumberSourceDataModel.hpp"
+#include "NumberDisplayDataModel.hpp"
+#include "AdditionModel.hpp"
+#include "SubtractionModel.hpp"
+#include "MultiplicationModel.hpp"
+#include "DivisionModel.hpp"
+#include "ModuloModel.hpp"
+#include "Converters.hpp"
+
+#include "sample_flow.hpp"
+
+using QtNodes::DataModelRegistry;
+using QtNodes::FlowScene;
+using QtNodes::Node;
+using QtNodes::TypeConverter;
+
+/// Evaluates sample.flow both through FlowScene and through the function
+/// generated by flow_compiler, checks that every result matches exactly and
+/// reports the time per evaluation of both paths.
+
+using Sources = std::array<double, 4>;
+
+static std::shared_ptr<DataModelRegistry>
+registerDataModels()
+{
+  auto ret = std::make_shared<DataModelRegistry>();
+
+  ret->registerModel<NumberSourceDataModel>("Sources");
+  ret->registerModel<NumberDisplayDataModel>("Displays");
+  ret->registerModel<AdditionModel>("Operators");
+  ret->registerModel<SubtractionModel>("Operators");
+  ret->registerModel<MultiplicationModel>("Operators");
+  ret->registerModel<DivisionModel>("Operators");
+  ret->registerModel<ModuloModel>("Operators");
+
+  ret->registerTypeConverter(std::make_pair(DecimalData().type(),
+                                            IntegerData().type()),
+                             TypeConverter{DecimalToIntegerConverter()});
+
+  ret->registerTypeConverter(std::make_pair(IntegerData().type(),
+                                            DecimalData().type()),
+                             TypeConverter{IntegerToDecimalConverter()});
+
+  return ret;
+}
+
+
+class Interpreter
+{
+public:
+
+  explicit
+  Interpreter(QByteArray const &flow)
+    : _scene(registerDataModels())
+  {
+    _scene.loadFromMemory(flow);
+
+    std::map<QString, Node*> nodeById;
+    for (Node* node : _scene.allNodes())
+      nodeById[node->id().toString()] = node;
+
+    // Sources and results in file order, the order flow_compiler uses.
+    QJsonArray nodes = QJsonDocument::fromJson(flow).object()["nodes"].toArray();
+
+    for (QJsonValue const &value : nodes)
+    {
+      QJsonObject nodeJson = value.toObject();
+
+      Node* node = nodeById.at(nodeJson["id"].toString());
+      QString const name = nodeJson["model"].toObject()["name"].toString();
+
+      if (name == "NumberSource")
+        _sources.push_back(node);
+      else if (name == "Result")
+        _results.push_back(node);
+    }
+  }
+
+  void
+  setSources(Sources const &values)
+  {
+    for (std::size_t i = 0; i < _sources.size(); ++i)
+    {
+      QJsonObject modelJson;
+      modelJson["number"] = QString::number(values[i], 'g', 17);
+
+      _sources[i]->nodeDataModel()->restore(modelJson);
+    }
+
+    evaluate();
+  }
+
+  void
+  evaluate()
+  {
+    for (Node* source : _sources)
+      source->onDataUpdated(0);
+  }
+
+  std::shared_ptr<DecimalData>
+  result(std::size_t i) const
+  {
+    return static_cast<NumberDisplayDataModel*>(
+      _results[i]->nodeDataModel())->number();
+  }
+
+  std::size_t
+  sourceCount() const { return _sources.size(); }
+
+  std::size_t
+  resultCount() const { return _results.size(); }
+
+private:
+
+  FlowScene _scene;
+
+  std::vector<Node*> _sources;
+  std::vector<Node*> _results;
+};
+
+
+static EvaluateSampleFlowOutputs
+compiled(Sources const &values)
+{
+  EvaluateSampleFlowInputs inputs;
+  inputs.source0 = values[0];
+  inputs.source1 = values[1];
+  inputs.source2 = values[2];
+  inputs.source3 = values[3];
+
+  EvaluateSampleFlowOutputs outputs;
+  evaluateSampleFlow(inputs, outputs);
+
+  return outputs;
+}
+
+
+static bool
+compare(Interpreter &interpreter, Sources const &values)
+{
+  interpreter.setSources(values);
+
+  EvaluateSampleFlowOutputs const outputs = compiled(values);
+
+  std::array<std::pair<double, bool>, 3> const expected = {{
+    { outputs.result0, outputs.result0_valid },
+    { outputs.result1, outputs.result1_valid },
+    { outputs.result2, outputs.result2_valid }
+  }};
+
+  bool same = true;
+
+  for (std::size_t i = 0; i < expected.size(); ++i)
+  {
+    auto number = interpreter.result(i);
+
+    bool const equal = number ?
+                       (expected[i].second && number->number() == expected[i].first) :
+                       !expected[i].second;
+
+    if (!equal)
+    {
+      std::cerr << "mismatch for sources ("
+                << values[0] << ", " << values[1] << ", "
+                << values[2] << ", " << values[3] << ") result " << i
+                << ": interpreted "
+                << (number ? QString::number(number->number(), 'g', 17).toStdString() : "<none>")
+                << ", compiled "
+                << (expected[i].second ? QString::number(expected[i].first, 'g', 17).toStdString() : "<none>")
+                << std::endl;
+      same = false;
+    }
+  }
+
+  return same;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+
+  QApplication app(argc, argv);
+
+  int iterations = 2000;
+  if (app.arguments().size() > 1)
+    iterations = app.arguments()[1].toInt();
+
+  QFile file(SAMPLE_FLOW);
+  if (!file.open(QIODevice::ReadOnly))
+  {
+    std::cerr << "cannot open " << SAMPLE_FLOW << std::endl;
+    return 1;
+  }
+
+  Interpreter interpreter(file.readAll());
+
+  if (interpreter.sourceCount() != 4 || interpreter.resultCount() != 3)
+  {
+    std::cerr << "unexpected sample flow layout" << std::endl;
+    return 1;
+  }
+
+  // Equivalence: hand-picked corner cases (zero divisors, negative
+  // operands) followed by random inputs.
+  std::vector<Sources> cases = {
+    {{ 7.5, 2, 4, 3 }},
+    {{ 0, 0, 0, 0 }},
+    {{ 2.5, 3, 0, -4 }},
+    {{ -3.25, 5, -2, 1.5 }},
+    {{ 1e6, -7, 0.5, 11 }},
+    {{ 0.1, 0.2, 0.3, 0.7 }},
+  };
+
+  std::mt19937 random(2024);
+  std::uniform_real_distribution<double> real(-100.0, 100.0);
+  std::uniform_int_distribution<int> integer(-9, 9);
+
+  for (int i = 0; i < 500; ++i)
+  {
+    cases.push_back({{ real(random), double(integer(random)),
+                       (i % 7 == 0) ? 0.0 : real(random), real(random) }});
+  }
+
+  int mismatches = 0;
+  for (Sources const &values : cases)
+  {
+    if (!compare(interpreter, values))
+      ++mismatches;
+  }
+
+  std::cout << cases.size() << " input sets, "
+            << mismatches << " mismatches" << std::endl;
+
+  // Benchmark.
+  interpreter.setSources(cases.front());
+
+  QElapsedTimer timer;
+
+  timer.start();
+  for (int i = 0; i < iterations; ++i)
+    interpreter.evaluate();
+
+  double const interpretedNs = double(timer.nsecsElapsed()) / iterations;
+
+  int const compiledIterations = iterations * 1000;
+
+  EvaluateSampleFlowInputs inputs;
+  EvaluateSampleFlowOutputs outputs;
+  volatile double sink = 0.0;
+
+  timer.restart();
+  for (int i = 0; i < compiledIterations; ++i)
+  {
+    inputs.source0 = cases[i % cases.size()][0];
+
+    evaluateSampleFlow(inputs, outputs);
+
+    sink = sink + outputs.result0;
+  }
+
+  double const compiledNs = double(timer.nsecsElapsed()) / compiledIterations;
+
+  std::cout << "interpreted: " << interpretedNs << " ns/evaluation" << std::endl
+            << "compiled:    " << compiledNs << " ns/evaluation" << std::endl
+            << "speedup:     " << interpretedNs / compiledNs << "x" << std::endl;
+
+  return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QStringList>
+
+#include <iostream>
+#include <stdexcept>
+
+#include "FlowCompiler.hpp"
+
+static QByteArray
+readFile(QString const &fileName)
+{
+  QFile file(fileName);
+
+  if (!file.open(QIODevice::ReadOnly))
+    throw std::runtime_error("Cannot open " + fileName.toStdString());
+
+  return file.readAll();
+}
+
+
+static void
+writeFile(QString const &fileName, QString const &contents)
+{
+  QFile file(fileName);
+
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    throw std::runtime_error("Cannot write " + fileName.toStdString());
+
+  file.write(contents.toUtf8());
+}
+
+
+/// flow_compiler <flow> <templates> <output base> <function name>
+///
+/// Writes `<output base>.hpp` and `<output base>.cpp`.
+int
+main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  QStringList const args = app.arguments();
+
+  if (args.size() != 5)
+  {
+    std::cerr << "usage: flow_compiler <flow> <templates> "
+                 "<output base> <function name>" << std::endl;
+    return 2;
+  }
+
+  try
+  {
+    FlowCompiler compiler;
+
+    compiler.loadTemplates(readFile(args[2]));
+    compiler.compile(readFile(args[1]), args[4]);
+
+    QString const headerName = args[3] + ".hpp";
+
+    writeFile(headerName, compiler.header());
+    writeFile(args[3] + ".cpp",
+              compiler.source(QFileInfo(headerName).fileName()));
+  }
+  catch (std::exception const &e)
+  {
+    std::cerr << "flow_compiler: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,192 @@
+#include <nodes/FlowScene>
+#include <nodes/Node>
+#include <nodes/NodeDataModel>
+#include <nodes/ObjectPool>
+
+#include <QtCore/QElapsedTimer>
+#include <QtWidgets/QApplication>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+using QtNodes::EdgeDescriptor;
+using QtNodes::FlowScene;
+using QtNodes::Node;
+using QtNodes::NodeData;
+using QtNodes::NodeDataModel;
+using QtNodes::NodeDataType;
+using QtNodes::NodeDescriptor;
+using QtNodes::ObjectPool;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+
+// Every operator new in the process, Qt included, is counted here.
+static std::atomic<std::size_t> allocationCount(0);
+
+void*
+operator new(std::size_t size)
+{
+  ++allocationCount;
+
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+
+  throw std::bad_alloc();
+}
+
+
+void
+operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+
+/// One input, one output, no widget: measures the framework alone.
+class PassThroughModel : public NodeDataModel
+{
+public:
+
+  QString
+  caption() const override { return QStringLiteral("Pass"); }
+
+  QString
+  name() const override { return QStringLiteral("Pass"); }
+
+  unsigned int
+  nPorts(PortType) const override { return 1; }
+
+  NodeDataType
+  dataType(PortType, PortIndex) const override
+  {
+    return NodeDataType {"value", "Value"};
+  }
+
+  std::shared_ptr<NodeData>
+  outData(PortIndex) override { return _data; }
+
+  void
+  setInData(std::shared_ptr<NodeData> data, PortIndex) override
+  {
+    _data = std::move(data);
+  }
+
+  QWidget*
+  embeddedWidget() override { return nullptr; }
+
+private:
+
+  std::shared_ptr<NodeData> _data;
+};
+
+
+int
+main(int argc, char *argv[])
+{
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+
+  QApplication app(argc, argv);
+
+  // scene_benchmark [count] [bulk]
+  int count = 50000;
+  if (app.arguments().size() > 1)
+    count = app.arguments()[1].toInt();
+
+  bool const bulk = app.arguments().contains(QStringLiteral("bulk"));
+
+  FlowScene scene;
+
+  ObjectPool::Statistics const poolBefore = ObjectPool::instance().statistics();
+  std::size_t const allocationsBefore = allocationCount;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  if (bulk)
+  {
+    std::vector<NodeDescriptor> nodes(count);
+    std::vector<EdgeDescriptor> edges(count > 0 ? count - 1 : 0);
+
+    for (int i = 0; i < count; ++i)
+    {
+      nodes[i].model    = std::make_unique<PassThroughModel>();
+      nodes[i].position = QPointF(200.0 * (i % 100), 150.0 * (i / 100));
+
+      if (i > 0)
+      {
+        EdgeDescriptor & edge = edges[i - 1];
+        edge.outNode = i - 1;
+        edge.outPort = 0;
+        edge.inNode  = i;
+        edge.inPort  = 0;
+      }
+    }
+
+    scene.createGraph(std::move(nodes), edges);
+  }
+  else
+  {
+    Node* previous = nullptr;
+    for (int i = 0; i < count; ++i)
+    {
+      Node& node = scene.createNode(std::make_unique<PassThroughModel>());
+
+      scene.setNodePosition(node, QPointF(200.0 * (i % 100), 150.0 * (i / 100)));
+
+      if (previous)
+        scene.createConnection(node, 0, *previous, 0);
+
+      previous = &node;
+    }
+  }
+
+  qint64 const elapsedMs = timer.elapsed();
+
+  ObjectPool::Statistics const pool = ObjectPool::instance().statistics();
+
+  double const pooledBlocks =
+    double(pool.allocations - poolBefore.allocations);
+
+  double const poolSystemAllocations =
+    double(pool.systemAllocations - poolBefore.systemAllocations);
+
+  double const heapAllocations =
+    double(allocationCount - allocationsBefore);
+
+  // without the pool every block would have been an operator new of its own
+  double const unpooledAllocations =
+    heapAllocations - poolSystemAllocations + pooledBlocks;
+
+  std::cout << (bulk ? "createGraph: " : "one by one: ")
+            << count << " nodes, " << count - 1 << " connections in "
+            << elapsedMs << " ms" << std::endl
+            << "operator new per node:            "
+            << heapAllocations / count << std::endl
+            << "operator new per node, unpooled:  "
+            << unpooledAllocations / count << std::endl
+            << "pooled blocks per node:           "
+            << pooledBlocks / count << std::endl
+            << "pool memory:                      "
+            << (pool.bytesReserved >> 10) << " KiB in "
+            << poolSystemAllocations << " system allocations" << std::endl;
+
+  timer.restart();
+
+  scene.clearScene();
+
+  std::cout << "clearScene:                       "
+            << timer.elapsed() << " ms" << std::endl;
+
+  return 0;
+}
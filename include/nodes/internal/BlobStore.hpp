@@ -0,0 +1,110 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QJsonValue>
+#include <QtCore/QString>
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "Export.hpp"
+#include "FlowSnapshot.hpp"
+#include "QStringStdHash.hpp"
+
+namespace QtNodes
+{
+
+/// Large model payloads shared by the nodes of a scene and saved with it.
+///
+/// Blobs are identified by the hex SHA-256 of their content, so identical
+/// payloads are stored and saved once however many models refer to them.
+/// Models keep the id in their save() output, wrapped by reference(), and
+/// only the blobs referred to that way are written to a flow file, in a
+/// section of their own. Payloads are kept zlib compressed when that makes
+/// them smaller; blobs read from a file are checked against their id as
+/// they are added and decompressed again on first access.
+///
+/// Blobs stay until collect() finds them unreferenced, which happens only
+/// when asked for: FlowScene::collectBlobs(), run by clearScene() and after
+/// FlowJournal::compact(). Saved models held outside the scene, such as
+/// those of FlowUndoStack, retain() theirs.
+///
+/// Not thread safe: get() caches what it decompresses.
+class NODE_EDITOR_PUBLIC BlobStore
+{
+public:
+
+  /// Stores `data` unless it is stored already, returns its id.
+  QString
+  put(QByteArray const & data);
+
+  /// Content of the blob, empty if there is none with that id.
+  QByteArray
+  get(QString const & id) const;
+
+  bool
+  contains(QString const & id) const;
+
+  std::size_t
+  size() const { return _blobs.size(); }
+
+  void
+  clear() { _blobs.clear(); }
+
+  /// Adds a blob in the form it is saved in, to be decompressed on first
+  /// access. Blobs already stored are left alone. Returns false, adding
+  /// nothing, if the content doesn't have the size and hash of the record.
+  bool
+  insert(FlowSnapshot::BlobRecord const & record);
+
+  /// Saved form of the blobs referred to from the models of `nodes`. Ids
+  /// missing from the store are skipped.
+  std::vector<FlowSnapshot::BlobRecord>
+  records(std::vector<FlowSnapshot::NodeRecord> const & nodes) const;
+
+  /// Keeps the blobs with these ids through collect(), until they are
+  /// released as many times.
+  void
+  retain(std::vector<QString> const & ids);
+
+  void
+  release(std::vector<QString> const & ids);
+
+  /// Drops the blobs neither referred to from the models of `nodes` nor
+  /// retained, returns how many.
+  std::size_t
+  collect(std::vector<FlowSnapshot::NodeRecord> const & nodes);
+
+public:
+
+  /// JSON value a model saves in place of the blob: {"$blob": id}.
+  static QJsonObject
+  reference(QString const & id);
+
+  /// Id held by a value made by reference(), or an empty string.
+  static QString
+  referencedId(QJsonValue const & value);
+
+  /// Appends the ids of the references found anywhere within `value`.
+  static void
+  collectReferences(QJsonValue const & value, std::vector<QString> & ids);
+
+private:
+
+  struct Blob
+  {
+    QByteArray stored;
+    bool       compressed = false;
+    quint64    size = 0;
+
+    mutable QByteArray data;
+    mutable bool       decoded = false;
+  };
+
+  std::unordered_map<QString, Blob> _blobs;
+
+  std::unordered_map<QString, std::size_t> _retained;
+};
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+/// Raw memory block handed out by a BufferPool.
+/// The block goes back to its pool when the last reference drops.
+class NODE_EDITOR_PUBLIC PooledBuffer
+{
+public:
+
+  ~PooledBuffer() = default;
+
+  PooledBuffer(PooledBuffer const &) = delete;
+  PooledBuffer& operator=(PooledBuffer const &) = delete;
+
+  unsigned char*
+  data() { return _data; }
+
+  unsigned char const*
+  data() const { return _data; }
+
+  /// Size requested by the caller.
+  std::size_t
+  size() const { return _size; }
+
+  /// Size of the underlying size class, always >= size().
+  std::size_t
+  capacity() const { return _capacity; }
+
+private:
+
+  friend class BufferPool;
+
+  PooledBuffer(unsigned char* data,
+               std::size_t size,
+               std::size_t capacity)
+    : _data(data)
+    , _size(size)
+    , _capacity(capacity)
+  {}
+
+  unsigned char* _data;
+  std::size_t    _size;
+  std::size_t    _capacity;
+};
+
+using SharedBuffer = std::shared_ptr<PooledBuffer>;
+
+
+/// Size-classed pool of large buffers for NodeData payloads.
+///
+/// Requests are rounded up to the next power of two. Released buffers are
+/// kept per size class and handed out again instead of going back to the
+/// system allocator, which avoids fresh page faults for every update of
+/// image- or array-like data. The pool is thread safe.
+class NODE_EDITOR_PUBLIC BufferPool
+{
+public:
+
+  struct Limits
+  {
+    /// Upper bound for the total size of idle buffers kept by the pool.
+    std::size_t maxRetainedBytes = std::size_t(256) << 20;
+
+    /// Upper bound for the number of idle buffers kept per size class.
+    std::size_t maxBuffersPerClass = 8;
+
+    /// Requests above this size bypass the pool.
+    std::size_t maxPooledSize = std::size_t(512) << 20;
+  };
+
+  struct Statistics
+  {
+    std::size_t acquisitions  = 0; ///< calls to acquire()
+    std::size_t reuses        = 0; ///< served from an idle buffer
+    std::size_t allocations   = 0; ///< served by the system allocator
+    std::size_t releases      = 0; ///< buffers given back to the pool
+    std::size_t discards      = 0; ///< released buffers freed due to limits
+    std::size_t bytesInUse    = 0; ///< capacity currently handed out
+    std::size_t bytesRetained = 0; ///< capacity of idle buffers
+  };
+
+public:
+
+  BufferPool();
+
+  explicit
+  BufferPool(Limits const & limits);
+
+  ~BufferPool();
+
+  BufferPool(BufferPool const &) = delete;
+  BufferPool& operator=(BufferPool const &) = delete;
+
+public:
+
+  /// Returns a buffer of at least `size` bytes. The content is undefined.
+  SharedBuffer
+  acquire(std::size_t size);
+
+  Statistics
+  statistics() const;
+
+  Limits
+  limits() const;
+
+  /// New limits apply to subsequent releases; call trim() to enforce
+  /// them on buffers that are already idle.
+  void
+  setLimits(Limits const & limits);
+
+  /// Frees idle buffers until the pool fits its limits.
+  void
+  trim();
+
+  /// Frees all idle buffers.
+  void
+  clear();
+
+  /// Process-wide pool used by the examples and by default.
+  static
+  BufferPool&
+  instance();
+
+  /// Smallest size class, in bytes.
+  static constexpr std::size_t MinimumClassSize = 4096;
+
+private:
+
+  struct State;
+
+  // Shared with the deleters of outstanding buffers, so that buffers
+  // released after the pool itself has been destroyed are still freed.
+  std::shared_ptr<State> _state;
+};
+}
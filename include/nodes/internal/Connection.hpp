@@ -13,6 +13,7 @@
 #include "TypeConverter.hpp"
 #include "QUuidStdHash.hpp"
 #include "Export.hpp"
+#include "SlotMap.hpp"
 #include "memory.hpp"
 
 class QPointF;
@@ -60,9 +61,17 @@ public:
 
 public:
 
+  /// Generated on first use; connections are persisted without ids.
   QUuid
   id() const;
 
+  /// Handle of the connection in the FlowScene owning it.
+  SlotHandle
+  sceneHandle() const { return _sceneHandle; }
+
+  void
+  setSceneHandle(SlotHandle handle) { _sceneHandle = handle; }
+
   /// Remembers the end being dragged.
   /// Invalidates Node address.
   /// Grabs mouse.
@@ -118,6 +127,10 @@ public:
   void
   setTypeConverter(TypeConverter converter);
 
+  /// Whether data passes through a type converter.
+  bool
+  hasTypeConverter() const { return static_cast<bool>(_converter); }
+
   bool
   complete() const;
 
@@ -139,7 +152,9 @@ Q_SIGNALS:
 
 private:
 
-  QUuid _uid;
+  mutable QUuid _uid;
+
+  SlotHandle _sceneHandle;
 
 private:
 
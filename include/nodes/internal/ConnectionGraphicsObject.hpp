@@ -4,6 +4,8 @@
 
 #include <QtWidgets/QGraphicsObject>
 
+#include "ObjectPool.hpp"
+
 class QGraphicsSceneMouseEvent;
 
 namespace QtNodes
@@ -17,6 +19,7 @@ class Node;
 /// Graphic Object for connection. Adds itself to scene
 class ConnectionGraphicsObject
   : public QGraphicsObject
+  , public PoolAllocated
 {
   Q_OBJECT
 
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <set>
+#include <shared_mutex>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -29,6 +31,11 @@ operator<(QtNodes::NodeDataType const & d1,
 
 
 /// Class uses map for storing models (name, model)
+///
+/// The registry is meant to be filled once and then shared, possibly by
+/// scenes living in different threads. Registration and lookups may run
+/// concurrently; after freeze() no more registration is accepted and
+/// create() and the converter lookups no longer take any lock.
 class NODE_EDITOR_PUBLIC DataModelRegistry
 {
 
@@ -46,10 +53,10 @@ public:
   ~DataModelRegistry() = default;
 
   DataModelRegistry(DataModelRegistry const &) = delete;
-  DataModelRegistry(DataModelRegistry &&)      = default;
+  DataModelRegistry(DataModelRegistry &&other);
 
   DataModelRegistry&operator=(DataModelRegistry const &) = delete;
-  DataModelRegistry&operator=(DataModelRegistry &&)      = default;
+  DataModelRegistry&operator=(DataModelRegistry &&other);
 
 public:
 
@@ -57,13 +64,9 @@ public:
   void registerModel(RegistryItemCreator creator,
                      QString const &category = "Nodes")
   {
+    // May instantiate a model, so it is done before taking the lock.
     const QString name = computeName<ModelType>(HasStaticMethodName<ModelType>{}, creator);
-    if (!_registeredItemCreators.count(name))
-    {
-      _registeredItemCreators[name] = std::move(creator);
-      _categories.insert(category);
-      _registeredModelsCategory[name] = category;
-    }
+    registerCreator(name, std::move(creator), category);
   }
 
   template<typename ModelType>
@@ -94,13 +97,18 @@ public:
   }
 
   void registerTypeConverter(TypeConverterId const & id,
-                             TypeConverter typeConverter)
-  {
-    _registeredTypeConverters[id] = std::move(typeConverter);
-  }
+                             TypeConverter typeConverter);
+
+  /// Makes the registry read-only. Registering anything afterwards
+  /// throws std::logic_error.
+  void freeze();
+
+  bool isFrozen() const;
 
   std::unique_ptr<NodeDataModel>create(QString const &modelName);
 
+  /// The containers below are returned without synchronisation; use
+  /// them from the thread filling the registry or after freeze().
   RegisteredModelCreatorsMap const &registeredModelCreators() const;
 
   RegisteredModelsCategoryMap const &registeredModelsCategoryAssociation() const;
@@ -110,6 +118,20 @@ public:
   TypeConverter getTypeConverter(NodeDataType const & d1,
                                  NodeDataType const & d2) const;
 
+  /// Same lookup without copying the converter; nullptr if there is none.
+  /// The pointer stays valid while the registry lives, unless the same
+  /// pair is registered again before freeze().
+  TypeConverter const *findTypeConverter(NodeDataType const & d1,
+                                         NodeDataType const & d2) const;
+
+private:
+
+  void registerCreator(QString const &name,
+                       RegistryItemCreator creator,
+                       QString const &category);
+
+  RegistryItemCreator const *findCreator(QString const &modelName) const;
+
 private:
 
   RegisteredModelsCategoryMap _registeredModelsCategory;
@@ -120,6 +142,10 @@ private:
 
   RegisteredTypeConvertersMap _registeredTypeConverters;
 
+  mutable std::shared_timed_mutex _mutex;
+
+  std::atomic<bool> _frozen{false};
+
 private:
 
   // If the registered ModelType class has the static member method
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QRectF>
+#include <QtCore/QUuid>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Export.hpp"
+#include "FlowSnapshot.hpp"
+
+class QIODevice;
+
+namespace QtNodes
+{
+
+/// Compact binary encoding of a FlowSnapshot.
+///
+/// A file starts with the magic "QNFLOWB\0", a 16 bit major and minor
+/// version and 4 reserved bytes. Chunks follow, each a four character tag,
+/// 4 reserved bytes, a 64 bit payload size and the payload padded to 8
+/// bytes. Readers skip chunks they don't know. All numbers are little
+/// endian.
+///
+///   HEAD  FlowHeader: node and connection counts, bounds as four doubles
+///         and the size and bytes of the thumbnail; always the first
+///         chunk (since 1.3)
+///   STRS  string table: every model name and converter type, stored once
+///   BLOB  fixed size records: SHA-256 id, flags (bit 0: zlib compressed),
+///         decoded size and the range of the content, followed by the
+///         contents; only written if there are blobs (since 1.1)
+///   NODE  fixed size records: uuid, model name index, position and the
+///         range of the model's state in MODL
+///   MODL  model states as compact JSON, without the model name
+///   CONN  fixed size records: node indices, ports, the range of turning
+///         points in PNTS and the converter types as string indices
+///   PNTS  turning points as packed pairs of doubles
+///   INDX  table of contents (since 1.2): node uuids in sorted order with
+///         their position in NODE, the nodes bucketed by a grid of square
+///         cells, and the connections into every node, by position in CONN
+///
+/// Reading works in place, typically on a memory mapped file: only the
+/// string table and the model states are decoded into Qt types. The index
+/// lets readRegion() and readUpstream() decode just the part of a flow
+/// they return; for older files it is built in memory from the fixed size
+/// records, still without decoding any model state.
+class NODE_EDITOR_PUBLIC FlowBinaryFormat
+{
+public:
+
+  static constexpr std::uint16_t MajorVersion = 1;
+  static constexpr std::uint16_t MinorVersion = 3;
+
+  /// Whether the data starts with the binary magic.
+  static bool
+  isBinary(char const* data, std::size_t size);
+
+  static QByteArray
+  write(FlowSnapshot const & snapshot);
+
+  /// Throws std::logic_error on malformed or truncated data and on
+  /// unsupported major versions.
+  static FlowSnapshot
+  read(char const* data, std::size_t size);
+
+  /// Reads the HEAD chunk at the start of the device, and nothing past
+  /// it. Returns false if the data is not a binary flow or was written
+  /// without a header, throws std::logic_error if it is malformed.
+  static bool
+  readHeader(QIODevice & device, FlowHeader & header);
+
+  /// The nodes positioned within `region` and the connections between
+  /// them, along with the blobs their models refer to. Throws like read().
+  static FlowSnapshot
+  readRegion(char const* data, std::size_t size, QRectF const & region);
+
+  /// The nodes with the given ids, everything upstream of them and the
+  /// connections between those. Unknown ids are skipped. Throws like
+  /// read().
+  static FlowSnapshot
+  readUpstream(char const* data, std::size_t size, std::vector<QUuid> const & ids);
+
+  /// Converts a JSON flow as written by FlowScene::saveToMemory().
+  static QByteArray
+  fromJson(QByteArray const & json);
+
+  static QByteArray
+  toJson(char const* data, std::size_t size);
+};
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QRectF>
+#include <QtGui/QImage>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+/// Summary saved ahead of the contents of a flow file, so that a file
+/// browser can show a flow without loading it; see FlowScene::readHeader().
+struct NODE_EDITOR_PUBLIC FlowHeader
+{
+  quint64 nodeCount       = 0;
+  quint64 connectionCount = 0;
+
+  /// Scene area covered by the flow.
+  QRectF bounds;
+
+  /// PNG rendering of the flow, empty if none was made.
+  QByteArray thumbnail;
+
+  /// Decodes the thumbnail, a null image if there is none.
+  QImage
+  thumbnailImage() const;
+
+  /// Encodes `image` as the thumbnail.
+  void
+  setThumbnail(QImage const & image);
+
+  QJsonObject
+  toJson() const;
+
+  static FlowHeader
+  fromJson(QJsonObject const & headerJson);
+};
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <QtCore/QFile>
+#include <QtCore/QJsonObject>
+#include <QtCore/QObject>
+#include <QtCore/QPointF>
+#include <QtCore/QString>
+#include <QtCore/QUuid>
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Export.hpp"
+#include "QStringStdHash.hpp"
+#include "QUuidStdHash.hpp"
+
+namespace QtNodes
+{
+
+class Connection;
+class FlowScene;
+class Node;
+
+/// Append-only record of the edits made to a scene, for crash recovery.
+///
+/// Node creation and removal, moves, connection changes and changes of a
+/// model's save() output are appended to a journal file as they happen,
+/// one line of compact JSON per edit, so persisting an edit costs in
+/// proportion to the edit rather than to the scene. Once the journal grows
+/// larger than both the last snapshot and the compaction threshold, it is
+/// folded into a new snapshot, a regular JSON flow file, and started over.
+/// Blobs of the scene's BlobStore are journaled once, before the first
+/// record referring to them.
+class NODE_EDITOR_PUBLIC FlowJournal
+  : public QObject
+{
+  Q_OBJECT
+
+public:
+
+  explicit
+  FlowJournal(FlowScene & scene, QObject * parent = Q_NULLPTR);
+
+  ~FlowJournal();
+
+  /// Writes the scene to `snapshotFile` and starts an empty journal in
+  /// `journalFile`. Returns false if either file can't be written.
+  bool
+  open(QString const & snapshotFile, QString const & journalFile);
+
+  void
+  close();
+
+  bool
+  isOpen() const { return _journal.isOpen(); }
+
+  /// Writes the scene to the snapshot file, replacing it atomically, and
+  /// empties the journal.
+  bool
+  compact();
+
+  /// 1 MiB by default.
+  void
+  setCompactionThreshold(qint64 bytes) { _compactionThreshold = bytes; }
+
+  qint64
+  compactionThreshold() const { return _compactionThreshold; }
+
+  /// Records the changed part of the node's model save() output. Models
+  /// are looked at whenever they emit NodeDataModel::dataUpdated(); call
+  /// this after changes that don't update any output.
+  void
+  recordModel(Node & node);
+
+  /// Loads `snapshotFile` into `scene` and replays `journalFile` on top.
+  ///
+  /// Records are applied idempotently, so a journal left behind by an
+  /// interrupted compaction can be replayed onto the newer snapshot. A
+  /// torn last record is ignored. Returns false if the snapshot can't be
+  /// opened, throws std::logic_error on malformed records. The scene must
+  /// not have an open journal.
+  static bool
+  recover(FlowScene & scene,
+          QString const & snapshotFile,
+          QString const & journalFile);
+
+private Q_SLOTS:
+
+  void flush();
+
+private:
+
+  void append(QJsonObject const & record);
+
+  /// Appends the blobs referred to from `modelJson` that aren't in the
+  /// snapshot or the journal yet.
+  void recordBlobs(QJsonObject const & modelJson);
+
+  void recordCreated(Node & node);
+
+  void recordRemoved(Node & node);
+
+  void recordMoved(Node & node, QPointF const & position);
+
+  void recordConnected(Connection const & connection);
+
+  void recordDisconnected(Connection const & connection);
+
+  void watchModel(Node & node);
+
+  void scheduleFlush();
+
+private:
+
+  FlowScene & _scene;
+
+  QString _snapshotFileName;
+  QFile   _journal;
+
+  qint64 _snapshotSize = 0;
+  qint64 _compactionThreshold = 1 << 20;
+
+  // Last recorded save() output of every model, the base of the next delta.
+  std::unordered_map<QUuid, QJsonObject> _models;
+
+  // Nodes whose model may have changed since the last flush.
+  std::unordered_set<QUuid> _dirty;
+
+  // Ids of the blobs in the snapshot or the journal.
+  std::unordered_set<QString> _blobs;
+
+  bool _flushPending = false;
+};
+}
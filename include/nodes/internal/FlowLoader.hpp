@@ -0,0 +1,133 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Export.hpp"
+#include "FlowSnapshot.hpp"
+#include "QStringStdHash.hpp"
+
+namespace QtNodes
+{
+
+class FlowScene;
+class Node;
+
+/// Loads a JSON or binary flow file into a scene without blocking the
+/// scene's thread.
+///
+/// The file is read and parsed into a FlowSnapshot on a worker thread.
+/// The scene is then built back on the loader's thread, one slice per
+/// event loop turn: nodes are created through FlowScene::createGraph() in
+/// small batches and connections one by one until the slice budget is
+/// spent. A cancelled or failed load removes whatever it already added.
+class NODE_EDITOR_PUBLIC FlowLoader
+  : public QObject
+{
+  Q_OBJECT
+
+public:
+
+  explicit
+  FlowLoader(FlowScene & scene, QObject * parent = Q_NULLPTR);
+
+  /// Cancels a running load and waits for the worker thread.
+  ~FlowLoader();
+
+  FlowLoader(FlowLoader const &) = delete;
+  FlowLoader& operator=(FlowLoader const &) = delete;
+
+  /// Starts loading `fileName`. Returns false if a load is already running.
+  bool
+  start(QString const & fileName);
+
+  /// Stops a running load; cancelled() is emitted once it has stopped.
+  void
+  cancel();
+
+  bool
+  isRunning() const { return _running; }
+
+  /// Time spent building the scene per event loop turn, 8 ms by default.
+  void
+  setSliceBudget(int milliseconds) { _sliceBudget = milliseconds; }
+
+  int
+  sliceBudget() const { return _sliceBudget; }
+
+Q_SIGNALS:
+
+  /// Bytes of the file parsed so far.
+  void parsingProgress(qint64 bytesRead, qint64 bytesTotal);
+
+  /// Nodes and connections added to the scene so far.
+  void buildingProgress(int itemsBuilt, int itemsTotal);
+
+  void finished();
+
+  void failed(QString const & message);
+
+  void cancelled();
+
+private Q_SLOTS:
+
+  void onParsingProgress();
+
+  void onParsed();
+
+  void buildSlice();
+
+private:
+
+  void onNodeDeleted(Node & node);
+
+  void parse(QString const & fileName);
+
+  void buildNodes(std::size_t count);
+
+  void buildConnection(FlowSnapshot::ConnectionRecord const & record);
+
+  /// Removes what the load added and leaves the idle state.
+  void rollBack();
+
+  void stop();
+
+private:
+
+  FlowScene & _scene;
+
+  int _sliceBudget = 8;
+
+  bool _running = false;
+
+  std::thread _worker;
+
+  std::atomic<bool>   _cancelRequested { false };
+  std::atomic<qint64> _bytesRead { 0 };
+  std::atomic<qint64> _bytesTotal { 0 };
+
+  // Written by the worker thread, read once it has been joined.
+  FlowSnapshot _snapshot;
+  bool         _parseFailed = false;
+  QString      _error;
+
+  std::size_t _nextNode = 0;
+  std::size_t _nextConnection = 0;
+
+  // position of the blobs in _snapshot by id
+  std::unordered_map<QString, std::size_t> _blobIndex;
+
+  // Nodes added so far, by snapshot position; null once removed from the
+  // scene while the load is still running.
+  std::vector<Node*>                     _built;
+  std::unordered_map<Node*, std::size_t> _builtIndex;
+
+  QMetaObject::Connection _nodeDeletedConnection;
+};
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+#include <deque>
+#include <thread>
+
+#include "Export.hpp"
+#include "FlowScene.hpp"
+#include "FlowSnapshot.hpp"
+
+namespace QtNodes
+{
+
+/// Saves a scene without blocking the scene's thread.
+///
+/// start() takes a FlowSnapshot of the scene, which only copies
+/// implicitly shared values besides calling the models' save(). Encoding
+/// and writing happen on a worker thread, through a QSaveFile, so the
+/// previous file stays intact until the new one is complete. Saves
+/// started while another one is running are written in turn afterwards,
+/// those waiting for the same file merged into the latest. The thumbnail
+/// of the file's header is drawn from the snapshot by the worker too.
+class NODE_EDITOR_PUBLIC FlowSaver
+  : public QObject
+{
+  Q_OBJECT
+
+public:
+
+  explicit
+  FlowSaver(FlowScene const & scene, QObject * parent = Q_NULLPTR);
+
+  /// Finishes the saves still running or waiting.
+  ~FlowSaver();
+
+  FlowSaver(FlowSaver const &) = delete;
+  FlowSaver& operator=(FlowSaver const &) = delete;
+
+  void
+  start(QString const & fileName,
+        FlowScene::FileFormat format = FlowScene::FileFormat::Json);
+
+  bool
+  isRunning() const { return _worker.joinable(); }
+
+Q_SIGNALS:
+
+  /// Sent for every file write, once it has completed or failed.
+  void finished(QString const & fileName,
+                bool success,
+                QString const & errorString);
+
+private Q_SLOTS:
+
+  void onWritten();
+
+private:
+
+  struct Job
+  {
+    FlowSnapshot          snapshot;
+    QString               fileName;
+    FlowScene::FileFormat format = FlowScene::FileFormat::Json;
+  };
+
+  void write(Job & job);
+
+  void run(Job job);
+
+private:
+
+  FlowScene const & _scene;
+
+  std::thread _worker;
+
+  // Written by the worker thread, read once it has been joined.
+  Job     _running;
+  bool    _success = false;
+  QString _errorString;
+
+  std::deque<Job> _pending;
+};
+}
@@ -1,29 +1,78 @@
 ﻿#pragma once
 
 #include <QtCore/QUuid>
+#include <QtCore/QPointer>
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
 #include <QtWidgets/QGraphicsScene>
 
+#include <cstdint>
 #include <unordered_map>
 #include <tuple>
 #include <functional>
+#include <memory>
+#include <vector>
 
 #include "QUuidStdHash.hpp"
 #include "Export.hpp"
 #include "DataModelRegistry.hpp"
 #include "TypeConverter.hpp"
 #include "memory.hpp"
+#include "SlotMap.hpp"
+#include "TopologicalOrder.hpp"
+#include "ReachabilityIndex.hpp"
+#include "FlowSnapshot.hpp"
+
+class QIODevice;
 
 namespace QtNodes
 {
 
+class BlobStore;
 class NodeDataModel;
 class FlowItemInterface;
+class FlowLoader;
+class FlowSaver;
 class Node;
 class NodeGraphicsObject;
 class Connection;
 class ConnectionGraphicsObject;
 class NodeStyle;
 
+/// Node to be created by FlowScene::createGraph().
+struct NodeDescriptor
+{
+  std::unique_ptr<NodeDataModel> model;
+
+  QPointF position;
+
+  /// Persistent id to restore; a new one is made on demand if null.
+  QUuid id;
+};
+
+/// Connection to be created by FlowScene::createGraph(). Nodes are
+/// referred to by their position in the descriptor array.
+struct EdgeDescriptor
+{
+  std::size_t outNode;
+  PortIndex   outPort;
+
+  std::size_t inNode;
+  PortIndex   inPort;
+
+  TypeConverter converter;
+
+  /// Saved routing of the connection, empty for the default one.
+  QList<QPointF> turningPoints;
+};
+
+/// Items created by FlowScene::createGraph(), in descriptor order.
+struct GraphItems
+{
+  std::vector<Node*>       nodes;
+  std::vector<Connection*> connections;
+};
+
 /// Scene holds connections and nodes.
 class NODE_EDITOR_PUBLIC FlowScene
   : public QGraphicsScene
@@ -45,6 +94,7 @@ public:
                    Node& node,
                    PortIndex portIndex);
 
+  /// Throws std::logic_error if the connection would close a cycle.
   std::shared_ptr<Connection>
   createConnection(Node& nodeIn,
                    PortIndex portIndexIn,
@@ -71,10 +121,61 @@ public:
 
   void removeNode(Node& node);
 
+  /// Removes the nodes and their connections at once. Connections among
+  /// the removed nodes are dropped without propagating data or repainting,
+  /// only the models that stay get notified. connectionDeleted() is still
+  /// sent for every connection; the topology and the reachability index
+  /// are updated once for the whole batch.
+  void removeNodes(std::vector<Node*> const & nodes);
+
+  /// Whether connecting an output of `outNode` to an input of `inNode`
+  /// would close a cycle. Only the nodes between the two in the scene's
+  /// topological order are searched.
+  bool wouldCreateCycle(Node const& outNode, Node const& inNode) const;
+
+  /// Whether data flows from `upstream` into `downstream` along
+  /// connections. Constant time for most graphs, see ReachabilityIndex.
+  bool isUpstream(Node const& upstream, Node const& downstream) const;
+
+  /// Nodes fed directly or indirectly by `node`.
+  std::vector<Node*> downstreamNodes(Node const& node) const;
+
+  /// Nodes feeding `node` directly or indirectly.
+  std::vector<Node*> upstreamNodes(Node const& node) const;
+
+  /// Creates many nodes and connections at once.
+  ///
+  /// Storage is reserved up front, every node's geometry and connection
+  /// routing is computed once, the items enter the QGraphicsScene in a
+  /// single pass and each connected output is delivered once. Once all of
+  /// that is done, nodePlaced() and nodeCreated() are sent for every node
+  /// and connectionCreated() for every connection, as for items made one
+  /// at a time, followed by graphCreated(). Every load path builds the
+  /// scene with these signals, whichever way it creates the items.
+  ///
+  /// Throws std::logic_error, leaving the scene untouched, if a node id is
+  /// already in use, if an edge refers to a missing node or port, if the
+  /// edges form a cycle or if they break the rules connections made in the
+  /// view follow: one connection per input, the output's ConnectionPolicy
+  /// and matching or convertible data types. Edges between different types
+  /// without a converter get the one from the registry.
+  GraphItems createGraph(std::vector<NodeDescriptor> nodes,
+                         std::vector<EdgeDescriptor> const & edges);
+
   DataModelRegistry&registry() const;
 
   void setRegistry(std::shared_ptr<DataModelRegistry> registry);
 
+  /// Large payloads of the models, shared with them through
+  /// NodeDataModel::blobStore(). Only blobs the models refer to are saved.
+  BlobStore& blobStore() const;
+
+  /// Drops the blobs no model refers to from its save() output and no one
+  /// retains. Saving doesn't, as a model may put() a blob before referring
+  /// to it; call this once the models are settled, such as after a
+  /// successful save. clearScene() does.
+  void collectBlobs();
+
   void iterateOverNodes(std::function<void(Node*)> const & visitor);
 
   void iterateOverNodeData(std::function<void(NodeDataModel*)> const & visitor);
@@ -87,11 +188,37 @@ public:
 
   QSizeF getNodeSize(Node const& node) const;
 
+  /// Zoom of the view showing the scene. Node items are cached as device
+  /// pixmaps unless the view magnifies them or they are very tall, where
+  /// repainting is cheaper than the pixmap. Nothing happens until the zoom
+  /// crosses that threshold; then only the nodes within `visibleRect` are
+  /// updated, the others once a later call finds them visible. A node
+  /// growing or shrinking past the height limit is updated right away,
+  /// see NodeGraphicsObject::refreshCacheMode().
+  void setViewScale(double scale, QRectF const & visibleRect);
+
+  /// Cache mode picked by the zoom policy for a node of this size.
+  QGraphicsItem::CacheMode nodeCacheMode(QRectF const & bounds) const;
+
+  /// Changes whenever the zoom policy does.
+  std::uint32_t cachePolicyEpoch() const { return _cachePolicyEpoch; }
+
+  /// Queues nodeMoved() for the node. Moves are coalesced and sent once
+  /// control returns to the event loop, one signal per moved node.
+  void scheduleNodeMoved(Node& node);
+
 public:
 
-  std::unordered_map<QUuid, std::unique_ptr<Node> > const & nodes() const;
+  using NodeMap       = SlotMap<std::unique_ptr<Node>>;
+  using ConnectionMap = SlotMap<std::shared_ptr<Connection>>;
 
-  std::unordered_map<QUuid, std::shared_ptr<Connection> > const & connections() const;
+  /// Nodes in a deterministic order, stored contiguously.
+  NodeMap const & nodes() const;
+
+  ConnectionMap const & connections() const;
+
+  /// Node with the given persistent id, or nullptr.
+  Node* findNode(QUuid const & id) const;
 
   std::vector<Node*> allNodes() const;
 
@@ -104,18 +231,88 @@ public:
 
   void clearScene();
 
+  /// Asks for a file name and saves in the background, see FlowSaver.
   void save() const;
 
   void load();
 
   QByteArray saveToMemory() const;
 
+  /// Accepts JSON as well as the binary format. Connections that would
+  /// close a cycle, which older files may contain, are skipped with a
+  /// warning instead of failing the load; restoreSnapshot() and
+  /// loadFromDevice() do the same.
   void loadFromMemory(const QByteArray& data);
 
+  /// Restores a JSON flow record by record, without reading the whole
+  /// device or building a document; memory use is bounded by the largest
+  /// node. Connections read before both of their nodes, as QJsonDocument
+  /// writes them, are restored by a second pass over the device from its
+  /// current position. A sequential device can't be read twice, so there
+  /// such connections are held in memory until the end. Throws
+  /// std::logic_error on malformed input.
+  void loadFromDevice(QIODevice & device);
+
+  /// Plain copy of everything saveToMemory() writes.
+  FlowSnapshot snapshot() const;
+
+  /// Plain copy of the given nodes and the connections between them.
+  FlowSnapshot snapshot(std::vector<Node*> const & nodes) const;
+
+  /// The selected nodes and the connections between them in
+  /// FlowBinaryFormat, for paste().
+  QByteArray copySelection() const;
+
+  /// Adds the nodes and connections of copySelection() output through
+  /// createGraph(), moved by `offset`. The pasted nodes get new ids and
+  /// become the selection. Throws std::logic_error for malformed data and
+  /// unknown models.
+  GraphItems paste(QByteArray const & data, QPointF const & offset = QPointF());
+
+  /// Adds the blobs, nodes and connections of the snapshot, the latter
+  /// through createGraph(). Blobs already stored are kept, those not
+  /// matching their id are skipped. Throws std::logic_error for unknown
+  /// models and invalid connections.
+  GraphItems restoreSnapshot(FlowSnapshot const & snapshot);
+
+  /// The scene in FlowBinaryFormat.
+  QByteArray saveToBinary() const;
+
+  void loadFromBinary(char const* data, std::size_t size);
+
+  enum class FileFormat
+  {
+    Json,
+    Binary
+  };
+
+  /// Writes the scene with a thumbnail in its header, see
+  /// FlowSnapshot::renderThumbnail().
+  bool saveToFile(QString const & fileName,
+                  FileFormat format = FileFormat::Json) const;
+
+  /// Loads a JSON or binary flow. Binary files are memory mapped and read
+  /// in place, JSON files are streamed, see loadFromDevice().
+  bool loadFromFile(QString const & fileName);
+
+  /// Reads the summary at the start of a flow file and nothing else.
+  /// Returns false if the file can't be opened or has no header, as files
+  /// written by older versions. Throws std::logic_error on malformed data.
+  static bool readHeader(QString const & fileName, FlowHeader & header);
+
+  /// Adds the nodes of a flow file positioned within `region`, with the
+  /// connections between them. Binary files are read through their index,
+  /// decoding only the nodes loaded; JSON files are parsed whole and
+  /// filtered, see FlowSnapshot::within().
+  bool loadRegionFromFile(QString const & fileName, QRectF const & region);
+
+  /// Adds the given nodes of a flow file along with everything upstream of
+  /// them, as for evaluating their outputs. See loadRegionFromFile().
+  bool loadUpstreamFromFile(QString const & fileName,
+                            std::vector<QUuid> const & nodes);
+
 Q_SIGNALS:
 
-  //gzl
-  void scale_param_intern1(float scale_param_height);
   /**
    * @brief Node has been created but not on the scene yet.
    * @see nodePlaced()
@@ -135,6 +332,13 @@ Q_SIGNALS:
   void connectionCreated(Connection const &c);
   void connectionDeleted(Connection const &c);
 
+  /// Sent once by createGraph(), after the signals for each of the items.
+  void graphCreated(GraphItems const &items);
+
+  /// Sent asynchronously: the moves of a node are coalesced and reported
+  /// once control returns to the event loop, with the latest position,
+  /// see scheduleNodeMoved(). Code that expects the signal before
+  /// setNodePosition() or a drag step returns has to process events.
   void nodeMoved(Node& n, const QPointF& newLocation);
 
   void nodeDoubleClicked(Node& n);
@@ -151,6 +355,9 @@ Q_SIGNALS:
 
   void sceneLoadFromMemoryCompleted(bool isCompleted);
 
+  /// Sent before the destructor removes the nodes, which is not an edit.
+  void aboutToBeDestroyed();
+
 private:
 
   using SharedConnection = std::shared_ptr<Connection>;
@@ -162,8 +369,52 @@ private:
   // which is why it comes first in the class.
   std::shared_ptr<DataModelRegistry> _registry;
 
-  std::unordered_map<QUuid, SharedConnection> _connections;
-  std::unordered_map<QUuid, UniqueNode>       _nodes;
+  std::shared_ptr<BlobStore> _blobs;
+
+  ConnectionMap _connections;
+  NodeMap       _nodes;
+
+  // persistent ids of the nodes, needed to resolve connections on load
+  std::unordered_map<QUuid, SlotHandle> _nodeIndex;
+
+  // order of the nodes by slot index, kept acyclic
+  TopologicalOrder _topology;
+
+  // transitive reachability over _topology
+  ReachabilityIndex _reachability;
+
+  // zoom dependent caching of the node items, see setViewScale()
+  bool          _magnified        = false;
+  std::uint32_t _cachePolicyEpoch = 0;
+  std::size_t   _staleCacheModes  = 0;
+
+  // nodes waiting for nodeMoved()
+  std::vector<SlotHandle> _movedNodes;
+
+  // made by the first save()
+  mutable std::unique_ptr<FlowSaver> _saver;
+
+  // the running load(), a later load() or clearScene() cancels it
+  QPointer<FlowLoader> _loader;
+
+private:
+
+  void sendNodeMoved();
+
+  void cancelLoad();
+
+  /// Keeps `node` in _nodeIndex under its current id.
+  void indexNode(Node & node);
+
+  /// `readBinary` picks the part out of a binary file, `pick` out of the
+  /// snapshot of a JSON file.
+  bool loadPartFromFile(QString const & fileName,
+                        std::function<FlowSnapshot(char const*, std::size_t)> const & readBinary,
+                        std::function<FlowSnapshot(FlowSnapshot const &)> const & pick);
+
+  /// Hooks a connection that got both its ends up to the nodes and the
+  /// topology, then sends connectionCreated().
+  void completeConnection(Connection const& c);
 
 private Q_SLOTS:
 
@@ -172,6 +423,9 @@ private Q_SLOTS:
   void sendConnectionCreatedToNodes(Connection const& c);
   void sendConnectionDeletedToNodes(Connection const& c);
 
+  void addConnectionToTopology(Connection const& c);
+  void removeConnectionFromTopology(Connection const& c);
+
 //  //gzl
 //public Q_SLOTS:
 //  void scale_param_intern2(float scale_param_height);
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QList>
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
+#include <QtCore/QSize>
+#include <QtCore/QSizeF>
+#include <QtCore/QUuid>
+#include <QtGui/QImage>
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "Export.hpp"
+#include "FlowHeader.hpp"
+#include "NodeData.hpp"
+#include "PortType.hpp"
+
+class QIODevice;
+
+namespace QtNodes
+{
+
+/// Contents of a saved scene, independent of the file format.
+///
+/// Holds plain values only, so it can be written or converted without a
+/// scene or a model registry. Connections refer to nodes by their position
+/// in `nodes`. The JSON form is the one FlowScene::saveToMemory() writes.
+/// Blobs are those of the scene's BlobStore referred to by the models.
+struct NODE_EDITOR_PUBLIC FlowSnapshot
+{
+  struct NodeRecord
+  {
+    QUuid id;
+
+    /// NodeDataModel::save(), holding the model name under "name".
+    QJsonObject model;
+
+    QPointF position;
+
+    /// Size of the node in the scene, for thumbnails. Not saved, so empty
+    /// unless the record was made by FlowScene::snapshot().
+    QSizeF size;
+  };
+
+  struct ConnectionRecord
+  {
+    std::size_t outNode;
+    PortIndex   outPort;
+
+    std::size_t inNode;
+    PortIndex   inPort;
+
+    QList<QPointF> turningPoints;
+
+    /// Data types at both ends, kept if the connection converts between
+    /// them.
+    bool         hasConverter = false;
+    NodeDataType inType;
+    NodeDataType outType;
+  };
+
+  /// Entry of a BlobStore, in the form it is saved in.
+  struct BlobRecord
+  {
+    /// Hex SHA-256 of the decoded content.
+    QString id;
+
+    /// Decoded size in bytes.
+    quint64 size = 0;
+
+    /// Whether `data` is the output of qCompress().
+    bool       compressed = false;
+    QByteArray data;
+
+    QJsonObject
+    toJson() const;
+
+    static BlobRecord
+    fromJson(QJsonObject const & blobJson);
+  };
+
+  std::vector<NodeRecord>       nodes;
+  std::vector<ConnectionRecord> connections;
+  std::vector<BlobRecord>       blobs;
+
+  /// Written ahead of everything else. The counts are taken from the
+  /// records when writing, see summary().
+  FlowHeader header;
+
+  /// `header` with the node and connection counts of the records.
+  FlowHeader
+  summary() const;
+
+  /// The nodes positioned within `region` and the connections between
+  /// them, along with the blobs their models refer to; what
+  /// FlowBinaryFormat::readRegion() reads of the same flow.
+  FlowSnapshot
+  within(QRectF const & region) const;
+
+  /// The nodes with the given ids, everything upstream of them and the
+  /// connections between those, as FlowBinaryFormat::readUpstream().
+  /// Unknown ids are skipped.
+  FlowSnapshot
+  upstreamOf(std::vector<QUuid> const & ids) const;
+
+  /// The JSON form as writeJson() writes it.
+  QByteArray
+  toJson() const;
+
+  /// Writes the JSON form record by record: the header, as the only
+  /// record of the "header" array, then blobs and nodes, so that a
+  /// streaming reader finds the summary first and has what it needs to
+  /// restore and connect nodes as it goes. QJsonDocument would sort the
+  /// keys and put the connections first.
+  void
+  writeJson(QIODevice & device) const;
+
+  /// Outline of the nodes and connections within `maxSize`, but no larger
+  /// than 1024 x 1024, keeping the aspect ratio of `header.bounds`; a null
+  /// image if there are no nodes. Needs no scene, so it can be drawn on
+  /// any thread. Large flows are thinned out to a bounded number of nodes,
+  /// without connections.
+  QImage
+  renderThumbnail(QSize const & maxSize = QSize(256, 256)) const;
+
+  /// Throws std::logic_error if a connection refers to a missing node.
+  static FlowSnapshot
+  fromJson(QJsonObject const & json);
+
+  /// Reads a JSON flow record by record, see JsonRecordReader. `proceed`
+  /// is asked after every record; if it returns false, reading stops and
+  /// an empty snapshot is returned.
+  static FlowSnapshot
+  readJson(QIODevice & device,
+           std::function<bool()> const & proceed = std::function<bool()>());
+};
+}
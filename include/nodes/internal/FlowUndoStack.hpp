@@ -0,0 +1,202 @@
+#pragma once
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonObject>
+#include <QtCore/QObject>
+#include <QtCore/QPointF>
+#include <QtCore/QString>
+#include <QtCore/QUuid>
+
+#include <cstddef>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Export.hpp"
+#include "QUuidStdHash.hpp"
+
+namespace QtNodes
+{
+
+class Connection;
+class FlowScene;
+class Node;
+
+/// Undo and redo for the edits made to a scene.
+///
+/// Each step holds the operations needed to go back and forth, not copies
+/// of the scene: node creation and removal, connection changes, moves and
+/// the changed keys of a model's save() output. Everything edited within
+/// one event loop turn forms one step. Moves of the nodes touched by the
+/// previous step are merged into it while they keep coming, so a drag is
+/// undone at once. The oldest steps are dropped once the stack holds more
+/// than memoryLimit() bytes. The blobs the steps refer to are retained in
+/// the scene's BlobStore until the steps are dropped.
+class NODE_EDITOR_PUBLIC FlowUndoStack
+  : public QObject
+{
+  Q_OBJECT
+
+public:
+
+  explicit
+  FlowUndoStack(FlowScene & scene, QObject * parent = Q_NULLPTR);
+
+  ~FlowUndoStack();
+
+  bool
+  canUndo() const { return !_undo.empty() || _stepOpen; }
+
+  bool
+  canRedo() const { return !_redo.empty() && !_stepOpen; }
+
+  std::size_t
+  undoCount() const { return _undo.size(); }
+
+  std::size_t
+  redoCount() const { return _redo.size(); }
+
+  /// Estimated size of the recorded steps, in bytes.
+  std::size_t
+  memoryUsage() const { return _memoryUsage; }
+
+  /// 16 MiB by default. A single step larger than that can't be undone.
+  void
+  setMemoryLimit(std::size_t bytes);
+
+  std::size_t
+  memoryLimit() const { return _memoryLimit; }
+
+  /// Longest pause, in milliseconds, between moves merged into one step.
+  void
+  setMoveMergeInterval(int milliseconds) { _moveMergeInterval = milliseconds; }
+
+  /// Records the changed part of the node's model save() output. Models
+  /// are looked at whenever they emit NodeDataModel::dataUpdated(); call
+  /// this after changes that don't update any output.
+  void
+  recordModel(Node & node);
+
+  void
+  clear();
+
+public Q_SLOTS:
+
+  void undo();
+
+  void redo();
+
+Q_SIGNALS:
+
+  /// Sent when steps are added, undone, redone or dropped.
+  void changed();
+
+private Q_SLOTS:
+
+  void closeStep();
+
+private:
+
+  struct Operation
+  {
+    enum class Kind
+    {
+      CreateNode,
+      RemoveNode,
+      Connect,
+      Disconnect,
+      Move,
+      ChangeModel
+    };
+
+    Kind  kind;
+    QUuid node;
+
+    /// Node::save() of a removed node, Connection::save(), or the
+    /// "redo" and "undo" patches of a model change.
+    QJsonObject data;
+
+    QPointF from;
+    QPointF to;
+
+    std::size_t bytes = 0;
+
+    /// Ids of the blobs `data` refers to, retained meanwhile.
+    std::vector<QString> blobs;
+  };
+
+  struct Step
+  {
+    std::vector<Operation> operations;
+
+    std::size_t bytes = 0;
+  };
+
+  /// What is known of a node since the last recorded operation.
+  struct NodeBase
+  {
+    QJsonObject model;
+    QPointF     position;
+  };
+
+  Step& openStep(bool mergeMoves, QUuid const & node);
+
+  void push(Operation operation, bool mergeMoves = false);
+
+  void apply(Step & step, bool forward);
+
+  void apply(Operation & operation, Operation::Kind action, bool forward);
+
+  /// Retains the blobs `operation.data` refers to now in place of those
+  /// it referred to before.
+  void retainBlobs(Operation & operation);
+
+  void releaseBlobs(Step const & step);
+
+  void updateBase(Node & node);
+
+  void watchModel(Node & node);
+
+  void scheduleClose();
+
+  /// Drops the oldest steps while over the memory limit.
+  bool trim();
+
+  void detach();
+
+  void recordCreated(Node & node);
+
+  void recordRemoved(Node & node);
+
+  void recordMoved(Node & node, QPointF const & position);
+
+  void recordConnected(Connection const & connection);
+
+  void recordDisconnected(Connection const & connection);
+
+private:
+
+  FlowScene & _scene;
+
+  std::deque<Step>  _undo;
+  std::vector<Step> _redo;
+
+  bool _stepOpen     = false;
+  bool _closePending = false;
+  bool _applying     = false;
+
+  std::unordered_map<QUuid, NodeBase> _nodes;
+  std::unordered_set<QUuid>           _dirty;
+
+  // Nodes created or moved by the last step, with the position of their
+  // Move operation, or -1 for a creation.
+  std::unordered_map<QUuid, std::ptrdiff_t> _mergeable;
+  QElapsedTimer                             _sinceLastStep;
+
+  int _moveMergeInterval = 500;
+
+  std::size_t _memoryUsage = 0;
+  std::size_t _memoryLimit = 16 * 1024 * 1024;
+};
+}
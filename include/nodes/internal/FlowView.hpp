@@ -29,15 +29,19 @@ public:
 
   QAction* deleteSelectionAction() const;
 
+  QAction* copySelectionAction() const;
+
+  QAction* pasteAction() const;
+
+  /// MIME type of the copied nodes on the clipboard, holding
+  /// FlowScene::copySelection() output.
+  static QString clipboardMimeType();
+
   void setScene(FlowScene *scene);
 
   //gzl
   float tm11() const;
 
-  //gzl
-Q_SIGNALS:
-  void signal_scale_param(float scale_param_height);
-
 public Q_SLOTS:
 
   void scaleUp();
@@ -46,6 +50,14 @@ public Q_SLOTS:
 
   void deleteSelectedNodes();
 
+  /// Puts the selected nodes and the connections between them on the
+  /// clipboard.
+  void copySelection();
+
+  /// Adds the nodes on the clipboard to the scene, under the mouse
+  /// cursor when it is over the view.
+  void paste();
+
 protected:
 
   void contextMenuEvent(QContextMenuEvent *event) override;
@@ -64,16 +76,27 @@ protected:
 
   void showEvent(QShowEvent *event) override;
 
+  void resizeEvent(QResizeEvent *event) override;
+
+  void scrollContentsBy(int dx, int dy) override;
+
 
 
 protected:
 
   FlowScene * scene();
 
+private:
+
+  /// Passes the zoom and the visible area to the scene.
+  void updateViewScale();
+
 private:
 
   QAction* _clearSelectionAction;
   QAction* _deleteSelectionAction;
+  QAction* _copySelectionAction;
+  QAction* _pasteAction;
   //gzl
 //  float _scale_param;
 
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+
+#include <cstddef>
+
+#include "Export.hpp"
+
+class QIODevice;
+
+namespace QtNodes
+{
+
+/// Reads a JSON document of the form {"key": [record, ...], ...} from a
+/// device block by block and hands out the elements of the top level
+/// arrays one at a time.
+///
+/// Only the current record is held in memory; other top level values are
+/// skipped without being stored. Records are not validated beyond their
+/// nesting until record() parses them.
+class NODE_EDITOR_PUBLIC JsonRecordReader
+{
+public:
+
+  explicit
+  JsonRecordReader(QIODevice & device,
+                   std::size_t blockSize = 64 * 1024);
+
+  /// Advances to the next record. Returns false at the end of the
+  /// document, or right away for an empty device. Throws std::logic_error
+  /// on malformed or truncated input.
+  bool
+  next();
+
+  /// Key of the array holding the current record.
+  QString const &
+  key() const { return _key; }
+
+  /// Source text of the current record.
+  QByteArray const &
+  text() const { return _text; }
+
+  /// The current record parsed. Throws std::logic_error if it is not a
+  /// valid JSON object.
+  QJsonObject
+  record() const;
+
+private:
+
+  bool
+  fill();
+
+  char
+  peek();
+
+  char
+  get();
+
+  void
+  skipWhitespace();
+
+  void
+  expect(char c);
+
+  // Reads a string whose opening quote was consumed, appending the raw
+  // bytes up to and including the closing quote to `out` if given.
+  void
+  scanString(QByteArray* out);
+
+  // Reads any value, appending its text to `out` if given.
+  void
+  scanValue(QByteArray* out);
+
+private:
+
+  enum class State { Start, Members, Records, End };
+
+  QIODevice & _device;
+
+  std::size_t _blockSize;
+
+  QByteArray _block;
+  int        _pos = 0;
+
+  State _state = State::Start;
+
+  QString    _key;
+  QByteArray _text;
+};
+}
@@ -3,12 +3,17 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QUuid>
+#include <QtCore/QElapsedTimer>
 
 #include <QtCore/QJsonObject>
 
+#include <vector>
+
 #include "PortType.hpp"
 
 #include "Export.hpp"
+#include "ObjectPool.hpp"
+#include "SlotMap.hpp"
 #include "NodeState.hpp"
 #include "NodeGeometry.hpp"
 #include "NodeData.hpp"
@@ -28,6 +33,7 @@ class NodeDataModel;
 class NODE_EDITOR_PUBLIC Node
   : public QObject
   , public Serializable
+  , public PoolAllocated
 {
   Q_OBJECT
 
@@ -49,8 +55,36 @@ public:
 
 public:
 
+  /// Persistent id, written to and read from files. New nodes count up
+  /// from one random id drawn per process rather than drawing each.
   QUuid
-  id() const;
+  id() const { return _uid; }
+
+  /// Sets the persistent id of a node that is not indexed by a scene yet.
+  void
+  setId(QUuid const & id) { _uid = id; }
+
+  /// Set while the scene removes the node. Connections between doomed
+  /// nodes skip data propagation and repaints when they go away.
+  bool
+  isDoomed() const { return _doomed; }
+
+  void
+  setDoomed(bool doomed) { _doomed = doomed; }
+
+  /// Set while a FlowScene::nodeMoved() notification is queued.
+  bool
+  isMovePending() const { return _movePending; }
+
+  void
+  setMovePending(bool pending) { _movePending = pending; }
+
+  /// Handle of the node in the FlowScene owning it.
+  SlotHandle
+  sceneHandle() const { return _sceneHandle; }
+
+  void
+  setSceneHandle(SlotHandle handle) { _sceneHandle = handle; }
 
   void reactToPossibleConnection(PortType,
                                  NodeDataType const &,
@@ -93,20 +127,41 @@ public Q_SLOTS: // data propagation
                 PortIndex inPortIndex) const;
 
   /// Fetches data from model's OUT #index port
-  /// and propagates it to the connection
+  /// and propagates it to the connection, honouring the
+  /// port's NodeDataModel::DeliveryPolicy
   void
   onDataUpdated(PortIndex index);
 
+  /// Sends the current data of OUT #index to the connections of the port
+  /// after one was made. The delivery does not count against the port's
+  /// rate limit, so the next update is not held back by it.
+  void
+  onOutputConnected(PortIndex index);
+
   /// update the graphic part if the size of the embeddedwidget changes
   void
   onNodeSizeUpdated();
 
+private:
+
+  void
+  deliverData(PortIndex index);
+
+  void
+  onDeliveryTimeout(PortIndex index);
+
 private:
 
   // addressing
 
   QUuid _uid;
 
+  SlotHandle _sceneHandle;
+
+  bool _doomed = false;
+
+  bool _movePending = false;
+
   // data
 
   std::unique_ptr<NodeDataModel> _nodeDataModel;
@@ -118,5 +173,17 @@ private:
   NodeGeometry _nodeGeometry;
 
   std::unique_ptr<NodeGraphicsObject> _nodeGraphicsObject;
+
+  // deferred delivery, per OUT port
+
+  struct PendingDelivery
+  {
+    bool pending   = false;
+    bool scheduled = false;
+
+    QElapsedTimer lastDelivery;
+  };
+
+  std::vector<PendingDelivery> _deliveries;
 };
 }
@@ -3,6 +3,8 @@
 
 #include <QtWidgets/QWidget>
 
+#include <memory>
+
 #include "PortType.hpp"
 #include "NodeData.hpp"
 #include "Serializable.hpp"
@@ -22,6 +24,8 @@ enum class NodeValidationState
   Error
 };
 
+class BlobStore;
+
 class Connection;
 
 class StyleCollection;
@@ -87,12 +91,53 @@ public:
     return ConnectionPolicy::Many;
   }
 
+  /// How dataUpdated() of an output port reaches the connected nodes.
+  /// Deferred modes always deliver the value returned by outData() at
+  /// the time of delivery, so intermediate values are dropped.
+  struct DeliveryPolicy
+  {
+    enum class Mode
+    {
+      Immediate,   ///< propagate every update synchronously
+      Coalesce,    ///< propagate once per event loop iteration
+      RateLimited, ///< propagate at most `maxRate` times per second
+    };
+
+    Mode   mode    = Mode::Immediate;
+    double maxRate = 0.0;
+
+    static DeliveryPolicy
+    immediate() { return DeliveryPolicy{}; }
+
+    static DeliveryPolicy
+    coalesce() { return DeliveryPolicy{Mode::Coalesce, 0.0}; }
+
+    static DeliveryPolicy
+    rateLimited(double hz) { return DeliveryPolicy{Mode::RateLimited, hz}; }
+  };
+
+  virtual
+  DeliveryPolicy
+  portOutDeliveryPolicy(PortIndex) const
+  {
+    return DeliveryPolicy::immediate();
+  }
+
   NodeStyle const&
   nodeStyle() const;
 
   void
   setNodeStyle(NodeStyle const& style);
 
+  /// Store of the scene for payloads too large to inline in save(). Set
+  /// before restore() is called on a node being loaded, and when the node
+  /// is added to the scene otherwise; null before that.
+  BlobStore*
+  blobStore() const { return _blobStore.get(); }
+
+  void
+  setBlobStore(std::shared_ptr<BlobStore> blobStore);
+
 public:
 
   /// Triggers the algorithm
@@ -165,5 +210,7 @@ Q_SIGNALS:
 private:
 
   NodeStyle _nodeStyle;
+
+  std::shared_ptr<BlobStore> _blobStore;
 };
 }
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstdint>
+
 #include <QtCore/QUuid>
 #include <QtWidgets/QGraphicsObject>
 
 #include "Connection.hpp"
+#include "ObjectPool.hpp"
 
 #include "NodeGeometry.hpp"
 #include "NodeState.hpp"
@@ -19,7 +22,9 @@ class FlowItemEntry;
 
 /// Class reacts on GUI events, mouse clicks and
 /// forwards painting operation.
-class NodeGraphicsObject : public QGraphicsObject
+class NodeGraphicsObject
+  : public QGraphicsObject
+  , public PoolAllocated
 {
   Q_OBJECT
 
@@ -55,6 +60,20 @@ public:
   void
   lock(bool locked);
 
+  /// Applies the scene's zoom dependent cache policy if it changed since
+  /// the last call. Returns whether it did.
+  bool
+  updateCacheMode();
+
+  /// Whether the cache mode follows the scene's current policy.
+  bool
+  cacheModeCurrent() const;
+
+  /// Applies the current policy again after the node changed size, which
+  /// it depends on. A node whose policy is stale gets it once shown.
+  void
+  refreshCacheMode();
+
 protected:
   void
   paint(QPainter*                       painter,
@@ -103,8 +122,7 @@ private:
   // either nullptr or owned by parent QGraphicsItem
   QGraphicsProxyWidget * _proxyWidget;
 
-  //gzl
-public Q_SLOTS:
-  void reset_cache_mode(float scale_param_height);
+  // FlowScene::cachePolicyEpoch() of the applied cache mode
+  std::uint32_t _cachePolicyEpoch;
 };
 }
@@ -1,13 +1,14 @@
 #pragma once
 
-#include <vector>
 #include <unordered_map>
+#include <vector>
 
 #include <QtCore/QUuid>
 #include <QPointF>
 #include "Export.hpp"
 
 #include "PortType.hpp"
+#include "SmallVector.hpp"
 #include "NodeData.hpp"
 #include "memory.hpp"
 
@@ -33,18 +34,27 @@ public:
 
 public:
 
+  /// Connections of one port, in the order they were made. Most ports
+  /// have at most a couple, which are stored without allocating.
   using ConnectionPtrSet =
-          std::unordered_map<QUuid, Connection*>;
+          SmallVector<Connection*, 2>;
+
+  using ConnectionSpan = Span<Connection* const>;
 
-  /// Returns vector of connections ID.
-  /// Some of them can be empty (null)
+  /// Returns vector of connections per port.
+  /// Some of them can be empty
   std::vector<ConnectionPtrSet> const&
   getEntries(PortType) const;
 
+  /// Mutable access. Connect and disconnect through setConnection(),
+  /// eraseConnection() and clearConnections(), which keep the routing
+  /// ordinals up to date.
   std::vector<ConnectionPtrSet> &
   getEntries(PortType);
 
-  ConnectionPtrSet
+  /// View of the connections of a port, without copying them.
+  /// Connecting or disconnecting that port invalidates the view.
+  ConnectionSpan
   connections(PortType portType, PortIndex portIndex) const;
 
   void
@@ -55,7 +65,11 @@ public:
   void
   eraseConnection(PortType portType,
                   PortIndex portIndex,
-                  QUuid id);
+                  Connection const& connection);
+
+  void
+  clearConnections(PortType portType,
+                   PortIndex portIndex);
 
   ReactToConnectionState
   reaction() const;
@@ -85,13 +99,28 @@ public:
   void
   layoutConnections(Connection &con, const QPointF &outp,const QPointF &inp);
 
+  /// 1-based position of `con` among the connections of the side used
+  /// for routing, 0 if it is not attached there. O(1) between changes.
   int
-  connectionIndex(Connection &con);
+  connectionIndex(Connection const &con) const;
+
+private:
+
+  /// Side whose connections are numbered for routing: the one with more ports.
+  PortType
+  routingPortType() const;
+
+  void
+  updateOrdinals() const;
 
 private:
   std::vector<ConnectionPtrSet> _inConnections;
   std::vector<ConnectionPtrSet> _outConnections;
 
+  // routing ordinals, rebuilt lazily after the connections change
+  mutable std::unordered_map<Connection const*, int> _ordinals;
+  mutable bool _ordinalsDirty = true;
+
   ReactToConnectionState _reaction;
   PortType     _reactingPortType;
   NodeDataType _reactingDataType;
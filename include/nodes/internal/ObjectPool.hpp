@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+/// Size-classed pool for small, frequently created framework objects.
+///
+/// Blocks are carved out of larger chunks and recycled through per-class
+/// free lists, so creating thousands of nodes and connections costs a
+/// handful of system allocations instead of one per object and keeps
+/// them close together in memory. Chunks are retained for the lifetime
+/// of the pool. The pool is thread safe.
+class NODE_EDITOR_PUBLIC ObjectPool
+{
+public:
+
+  struct Statistics
+  {
+    std::size_t allocations       = 0; ///< blocks handed out
+    std::size_t deallocations     = 0; ///< blocks given back
+    std::size_t systemAllocations = 0; ///< chunks and oversized requests
+    std::size_t blocksInUse       = 0;
+    std::size_t bytesReserved     = 0; ///< total size of all chunks
+  };
+
+public:
+
+  ObjectPool();
+
+  ~ObjectPool();
+
+  ObjectPool(ObjectPool const &) = delete;
+  ObjectPool& operator=(ObjectPool const &) = delete;
+
+public:
+
+  /// Returns `size` bytes aligned for any fundamental type.
+  void*
+  allocate(std::size_t size);
+
+  /// `size` must be the one passed to allocate().
+  void
+  deallocate(void* p, std::size_t size) noexcept;
+
+  Statistics
+  statistics() const;
+
+  /// Process-wide pool backing PoolAllocated and PoolAllocator. It is
+  /// never destroyed, so objects may outlive static destruction.
+  static
+  ObjectPool&
+  instance();
+
+  /// Requests above this size go straight to the system allocator.
+  static constexpr std::size_t MaxPooledSize = 1024;
+
+  /// Granularity of the size classes.
+  static constexpr std::size_t Alignment = 16;
+
+private:
+
+  struct State;
+
+  std::unique_ptr<State> _state;
+};
+
+
+/// Base class routing `new` and `delete` of the derived class through
+/// ObjectPool::instance().
+struct PoolAllocated
+{
+  static void*
+  operator new(std::size_t size)
+  {
+    return ObjectPool::instance().allocate(size);
+  }
+
+  static void
+  operator delete(void* p, std::size_t size) noexcept
+  {
+    ObjectPool::instance().deallocate(p, size);
+  }
+};
+
+
+/// Standard allocator over ObjectPool::instance(), e.g. for
+/// std::allocate_shared.
+template <typename T>
+class PoolAllocator
+{
+public:
+
+  using value_type = T;
+
+  PoolAllocator() = default;
+
+  template <typename U>
+  PoolAllocator(PoolAllocator<U> const &) {}
+
+  T*
+  allocate(std::size_t n)
+  {
+    return static_cast<T*>(ObjectPool::instance().allocate(n * sizeof(T)));
+  }
+
+  void
+  deallocate(T* p, std::size_t n) noexcept
+  {
+    ObjectPool::instance().deallocate(p, n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(PoolAllocator<U> const &) const { return true; }
+
+  template <typename U>
+  bool operator!=(PoolAllocator<U> const &) const { return false; }
+};
+}
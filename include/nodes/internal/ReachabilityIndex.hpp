@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Export.hpp"
+#include "TopologicalOrder.hpp"
+
+namespace QtNodes
+{
+
+/// Answers "is `to` downstream of `from`" over the edges of a
+/// TopologicalOrder.
+///
+/// Graphs up to ClosureLimit vertices keep their full transitive closure
+/// as bitsets: queries are a single bit test and edge insertions update
+/// the closure in place. Larger graphs get two interval labels per vertex
+/// (GRAIL): a label not containing the other one rules reachability out
+/// immediately, otherwise a search pruned by the labels and by the
+/// topological order decides. Added vertices are appended in both modes.
+///
+/// A removed edge only changes what its source and the vertices upstream
+/// of it reach: their closure rows are recomputed from their successors,
+/// and the ancestor rows of the target and the vertices downstream of it
+/// from their predecessors, unless the source still reaches the target
+/// some other way. Labels stay sound when edges go, as they only rule out
+/// pairs that were never connected, and are kept as they are; the search
+/// behind them sees the current edges. Short of a large batch of
+/// removals, neither mode is rebuilt.
+class NODE_EDITOR_PUBLIC ReachabilityIndex
+{
+public:
+
+  using Vertex = TopologicalOrder::Vertex;
+
+  explicit
+  ReachabilityIndex(TopologicalOrder const & graph);
+
+  /// Keeps the index current after `v` was added to the graph.
+  void
+  vertexAdded(Vertex v);
+
+  /// Keeps the index current after `from -> to` was added to the graph.
+  void
+  edgeAdded(Vertex from, Vertex to);
+
+  /// Same for many edges added at once. Batches larger than
+  /// IncrementalEdgeLimit invalidate the index instead, rebuilding it is
+  /// cheaper than that many updates.
+  void
+  edgesAdded(std::vector<std::pair<Vertex, Vertex>> const & edges);
+
+  /// Keeps the index current after one edge `from -> to` was removed from
+  /// the graph.
+  void
+  edgeRemoved(Vertex from, Vertex to);
+
+  /// Same for many edges removed at once, such as those of removed
+  /// vertices, in a single update. Batches larger than
+  /// IncrementalEdgeLimit invalidate the index instead.
+  void
+  edgesRemoved(std::vector<std::pair<Vertex, Vertex>> const & edges);
+
+  /// Keeps the index current after `v` was removed from the graph, its
+  /// edges having been reported as removed before.
+  void
+  vertexRemoved(Vertex v);
+
+  /// Drops the index, it is rebuilt in O(V + E) on the next query.
+  void
+  invalidate();
+
+  /// Whether there is a path from `from` to `to`. A vertex reaches itself.
+  bool
+  reaches(Vertex from, Vertex to) const;
+
+  /// Vertices reachable from `v`, excluding `v`.
+  std::vector<Vertex>
+  descendants(Vertex v) const;
+
+  /// Vertices reaching `v`, excluding `v`.
+  std::vector<Vertex>
+  ancestors(Vertex v) const;
+
+  /// Whether the index currently stores the full closure.
+  bool
+  usesClosure() const;
+
+  /// Number of times the index was built from scratch.
+  std::size_t
+  buildCount() const { return _buildCount; }
+
+  /// Largest graph kept as a transitive closure; the closure takes
+  /// 2 * n * n bits.
+  static constexpr std::size_t ClosureLimit = 4096;
+
+  static constexpr std::size_t IncrementalEdgeLimit = 32;
+
+private:
+
+  struct Label
+  {
+    std::uint32_t low;
+    std::uint32_t post;
+  };
+
+  static constexpr int LabelCount = 2;
+
+  void
+  ensureBuilt() const;
+
+  void
+  buildClosure() const;
+
+  void
+  buildLabels() const;
+
+  bool
+  labelsContain(Vertex outer, Vertex inner) const;
+
+  /// Recomputes the closure rows that removing edges from `sources` to
+  /// `targets` can change.
+  void
+  recomputeAround(std::vector<Vertex> const & sources,
+                  std::vector<Vertex> const & targets);
+
+  /// Makes room for rows up to the graph's vertex bound.
+  void
+  growClosure();
+
+  std::size_t
+  closureRows() const
+  {
+    return _words ? _descendants.size() / _words : 0;
+  }
+
+  std::uint64_t*
+  row(std::vector<std::uint64_t> & rows, Vertex v) const
+  {
+    return rows.data() + v * _words;
+  }
+
+  std::uint64_t const*
+  row(std::vector<std::uint64_t> const & rows, Vertex v) const
+  {
+    return rows.data() + v * _words;
+  }
+
+  static bool
+  testBit(std::uint64_t const* bits, Vertex v)
+  {
+    return (bits[v / 64] >> (v % 64)) & 1u;
+  }
+
+  static void
+  setBit(std::uint64_t* bits, Vertex v)
+  {
+    bits[v / 64] |= std::uint64_t(1) << (v % 64);
+  }
+
+  std::vector<Vertex>
+  collect(Vertex v, bool forward) const;
+
+private:
+
+  TopologicalOrder const & _graph;
+
+  enum class Mode { Invalid, Closure, Labels };
+
+  mutable Mode _mode = Mode::Invalid;
+
+  // closure: one row of _words words per vertex
+  mutable std::size_t _words = 0;
+  mutable std::vector<std::uint64_t> _descendants;
+  mutable std::vector<std::uint64_t> _ancestors;
+
+  // interval labels, LabelCount per vertex
+  mutable std::vector<Label> _labels;
+  mutable std::uint32_t      _postCount = 0;
+
+  mutable std::vector<std::uint32_t> _visitMark;
+  mutable std::uint32_t              _searchEpoch = 0;
+
+  mutable std::size_t _buildCount = 0;
+};
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace QtNodes
+{
+
+/// Stable reference to an element of a SlotMap. A handle whose element
+/// was erased never matches again, even if its slot gets reused.
+struct SlotHandle
+{
+  static constexpr std::uint32_t InvalidIndex =
+    std::numeric_limits<std::uint32_t>::max();
+
+  std::uint32_t index      = InvalidIndex;
+  std::uint32_t generation = 0;
+
+  bool
+  isValid() const { return index != InvalidIndex; }
+
+  friend bool
+  operator==(SlotHandle const & a, SlotHandle const & b)
+  {
+    return a.index == b.index && a.generation == b.generation;
+  }
+
+  friend bool
+  operator!=(SlotHandle const & a, SlotHandle const & b)
+  {
+    return !(a == b);
+  }
+};
+
+
+/// Generational slot map.
+///
+/// Values are kept contiguous, so iterating over them touches one array
+/// in a deterministic order: insertion order, except that erasing moves
+/// the last value into the hole. Lookup by handle is O(1) through an
+/// indirection table of slots.
+template <typename T>
+class SlotMap
+{
+public:
+
+  using iterator       = typename std::vector<T>::iterator;
+  using const_iterator = typename std::vector<T>::const_iterator;
+
+public:
+
+  SlotHandle
+  insert(T value)
+  {
+    std::uint32_t slotIndex;
+
+    if (_freeHead != SlotHandle::InvalidIndex)
+    {
+      slotIndex = _freeHead;
+      _freeHead = _slots[slotIndex].target;
+    }
+    else
+    {
+      slotIndex = static_cast<std::uint32_t>(_slots.size());
+      _slots.push_back(Slot{});
+    }
+
+    Slot & slot = _slots[slotIndex];
+    slot.target = static_cast<std::uint32_t>(_values.size());
+
+    _values.push_back(std::move(value));
+    _valueSlots.push_back(slotIndex);
+
+    return SlotHandle{slotIndex, slot.generation};
+  }
+
+  /// Returns false if the handle is stale. The erased value is destroyed
+  /// after the map is consistent again, so its destructor may safely
+  /// access the map.
+  bool
+  erase(SlotHandle handle)
+  {
+    if (!contains(handle))
+      return false;
+
+    Slot & slot = _slots[handle.index];
+
+    std::uint32_t const position = slot.target;
+    std::uint32_t const last     = static_cast<std::uint32_t>(_values.size() - 1);
+
+    T removed = std::move(_values[position]);
+
+    if (position != last)
+    {
+      _values[position]     = std::move(_values[last]);
+      _valueSlots[position] = _valueSlots[last];
+
+      _slots[_valueSlots[position]].target = position;
+    }
+
+    _values.pop_back();
+    _valueSlots.pop_back();
+
+    ++slot.generation;
+    slot.target = _freeHead;
+    _freeHead   = handle.index;
+
+    // `removed` goes away here
+    static_cast<void>(removed);
+
+    return true;
+  }
+
+  bool
+  contains(SlotHandle handle) const
+  {
+    return handle.index < _slots.size() &&
+           _slots[handle.index].generation == handle.generation;
+  }
+
+  T*
+  find(SlotHandle handle)
+  {
+    return contains(handle) ? &_values[_slots[handle.index].target] : nullptr;
+  }
+
+  T const*
+  find(SlotHandle handle) const
+  {
+    return contains(handle) ? &_values[_slots[handle.index].target] : nullptr;
+  }
+
+  /// Handle of the value at `position` in iteration order.
+  SlotHandle
+  handleAt(std::size_t position) const
+  {
+    std::uint32_t const slotIndex = _valueSlots[position];
+
+    return SlotHandle{slotIndex, _slots[slotIndex].generation};
+  }
+
+  /// Current handle of an occupied slot.
+  SlotHandle
+  handleOfSlot(std::uint32_t slotIndex) const
+  {
+    return SlotHandle{slotIndex, _slots[slotIndex].generation};
+  }
+
+  std::size_t
+  size() const { return _values.size(); }
+
+  bool
+  empty() const { return _values.empty(); }
+
+  /// Upper bound of SlotHandle::index, for side tables indexed by slot.
+  std::size_t
+  slotCount() const { return _slots.size(); }
+
+  void
+  reserve(std::size_t n)
+  {
+    _values.reserve(n);
+    _valueSlots.reserve(n);
+    _slots.reserve(n);
+  }
+
+  void
+  clear()
+  {
+    while (!_values.empty())
+      erase(handleAt(_values.size() - 1));
+  }
+
+  iterator begin() { return _values.begin(); }
+  iterator end()   { return _values.end(); }
+
+  const_iterator begin() const { return _values.begin(); }
+  const_iterator end() const   { return _values.end(); }
+
+private:
+
+  struct Slot
+  {
+    // position in _values while occupied, next free slot otherwise
+    std::uint32_t target     = SlotHandle::InvalidIndex;
+    std::uint32_t generation = 0;
+  };
+
+  std::vector<T> _values;
+
+  // slot of every value, parallel to _values
+  std::vector<std::uint32_t> _valueSlots;
+
+  std::vector<Slot> _slots;
+
+  std::uint32_t _freeHead = SlotHandle::InvalidIndex;
+};
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+namespace QtNodes
+{
+
+/// Read-only view over a contiguous range.
+template <typename T>
+class Span
+{
+public:
+
+  using value_type     = typename std::remove_cv<T>::type;
+  using iterator       = T*;
+  using const_iterator = T*;
+
+  Span() = default;
+
+  Span(T* begin, T* end)
+    : _begin(begin)
+    , _end(end)
+  {}
+
+  T* begin() const { return _begin; }
+  T* end() const   { return _end; }
+
+  std::size_t
+  size() const { return static_cast<std::size_t>(_end - _begin); }
+
+  bool
+  empty() const { return _begin == _end; }
+
+  T &
+  operator[](std::size_t i) const { return _begin[i]; }
+
+  T &
+  front() const { return *_begin; }
+
+private:
+
+  T* _begin = nullptr;
+  T* _end   = nullptr;
+};
+
+
+/// Vector of trivially copyable values keeping the first `N` of them
+/// inline, so that short lists cost no allocation.
+template <typename T, std::size_t N>
+class SmallVector
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SmallVector only holds trivially copyable values");
+
+public:
+
+  using value_type     = T;
+  using iterator       = T*;
+  using const_iterator = T const*;
+
+  SmallVector() = default;
+
+  SmallVector(std::initializer_list<T> values)
+  {
+    reserve(values.size());
+    for (T const & value : values)
+      push_back(value);
+  }
+
+  SmallVector(SmallVector const & other)
+  {
+    reserve(other._size);
+    copyFrom(other);
+  }
+
+  SmallVector(SmallVector && other) noexcept
+  {
+    moveFrom(other);
+  }
+
+  SmallVector &
+  operator=(SmallVector const & other)
+  {
+    if (this != &other)
+    {
+      _size = 0;
+      reserve(other._size);
+      copyFrom(other);
+    }
+
+    return *this;
+  }
+
+  SmallVector &
+  operator=(SmallVector && other) noexcept
+  {
+    if (this != &other)
+    {
+      release();
+      moveFrom(other);
+    }
+
+    return *this;
+  }
+
+  ~SmallVector() { release(); }
+
+public:
+
+  T*       begin()       { return data(); }
+  T*       end()         { return data() + _size; }
+  T const* begin() const { return data(); }
+  T const* end() const   { return data() + _size; }
+
+  T*
+  data() { return isInline() ? _storage.values : _storage.heap; }
+
+  T const*
+  data() const { return isInline() ? _storage.values : _storage.heap; }
+
+  std::size_t
+  size() const { return _size; }
+
+  bool
+  empty() const { return _size == 0; }
+
+  std::size_t
+  capacity() const { return _capacity; }
+
+  T &       operator[](std::size_t i)       { return data()[i]; }
+  T const & operator[](std::size_t i) const { return data()[i]; }
+
+  T &       front()       { return data()[0]; }
+  T const & front() const { return data()[0]; }
+
+  T &       back()       { return data()[_size - 1]; }
+  T const & back() const { return data()[_size - 1]; }
+
+  void
+  push_back(T const & value)
+  {
+    if (_size == _capacity)
+      reserve(_capacity * 2);
+
+    data()[_size++] = value;
+  }
+
+  void
+  pop_back() { --_size; }
+
+  /// Removes the element at `position`, keeping the order of the others.
+  iterator
+  erase(const_iterator position)
+  {
+    T* p = begin() + (position - begin());
+
+    std::memmove(p, p + 1, (end() - p - 1) * sizeof(T));
+    --_size;
+
+    return p;
+  }
+
+  /// Keeps the allocated capacity.
+  void
+  clear() { _size = 0; }
+
+  void
+  reserve(std::size_t capacity)
+  {
+    if (capacity <= _capacity)
+      return;
+
+    T* heap = new T[capacity];
+    std::memcpy(heap, data(), _size * sizeof(T));
+
+    release();
+
+    _storage.heap = heap;
+    _capacity     = static_cast<std::uint32_t>(capacity);
+  }
+
+  Span<T const>
+  view() const { return Span<T const>(begin(), end()); }
+
+private:
+
+  bool
+  isInline() const { return _capacity == N; }
+
+  void
+  release()
+  {
+    if (!isInline())
+      delete[] _storage.heap;
+
+    _capacity = N;
+  }
+
+  void
+  copyFrom(SmallVector const & other)
+  {
+    std::memcpy(data(), other.data(), other._size * sizeof(T));
+    _size = other._size;
+  }
+
+  void
+  moveFrom(SmallVector & other)
+  {
+    _storage  = other._storage;
+    _size     = other._size;
+    _capacity = other._capacity;
+
+    other._size     = 0;
+    other._capacity = N;
+  }
+
+private:
+
+  union Storage
+  {
+    T  values[N];
+    T* heap;
+  };
+
+  Storage _storage;
+
+  std::uint32_t _size     = 0;
+  std::uint32_t _capacity = N;
+};
+}
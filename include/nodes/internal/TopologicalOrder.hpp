@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+/// Dynamic topological order of a directed acyclic graph.
+///
+/// Vertices are small integers, in FlowScene the slot index of a node.
+/// Every vertex has a position and every edge goes from a lower to a
+/// higher position. Inserting an edge that agrees with the order is O(1);
+/// otherwise only the vertices positioned between its ends are searched
+/// and reordered (Pearce and Kelly, 2006). The same bounded search tells
+/// whether an edge would close a cycle. Parallel edges are allowed.
+class NODE_EDITOR_PUBLIC TopologicalOrder
+{
+public:
+
+  using Vertex = std::uint32_t;
+
+  /// Adds an isolated vertex at the end of the order.
+  void
+  addVertex(Vertex v);
+
+  /// Removes the vertex together with its edges.
+  void
+  removeVertex(Vertex v);
+
+  bool
+  contains(Vertex v) const;
+
+  /// Whether adding the edge `from -> to` would close a cycle.
+  bool
+  wouldCreateCycle(Vertex from, Vertex to) const;
+
+  /// Adds the edge and restores the order. Returns false, leaving the
+  /// graph unchanged, if the edge would close a cycle.
+  bool
+  addEdge(Vertex from, Vertex to);
+
+  /// Removes one edge `from -> to`, if there is one.
+  void
+  removeEdge(Vertex from, Vertex to);
+
+  /// Position of the vertex; a lower position never depends on a higher one.
+  std::size_t
+  position(Vertex v) const { return _position[v]; }
+
+  /// Whether `a` comes before `b` in the order.
+  bool
+  precedes(Vertex a, Vertex b) const { return _position[a] < _position[b]; }
+
+  /// Vertices in topological order.
+  std::vector<Vertex>
+  order() const;
+
+  /// Targets of the outgoing edges, one entry per edge.
+  std::vector<Vertex> const &
+  successors(Vertex v) const { return _out[v]; }
+
+  /// Sources of the incoming edges, one entry per edge.
+  std::vector<Vertex> const &
+  predecessors(Vertex v) const { return _in[v]; }
+
+  std::size_t
+  vertexCount() const { return _vertexCount; }
+
+  /// Upper bound of the vertex values, for side tables indexed by vertex.
+  std::size_t
+  vertexBound() const { return _present.size(); }
+
+  void
+  clear();
+
+private:
+
+  static constexpr Vertex None = ~Vertex(0);
+
+  // Depth-first search from `start` over vertices positioned in
+  // [lower, upper], following outgoing or incoming edges. Returns false
+  // if `stop` was reached. Visited vertices are appended to `visited`.
+  bool
+  search(Vertex start,
+         Vertex stop,
+         std::size_t lower,
+         std::size_t upper,
+         bool forward,
+         std::vector<Vertex> & visited) const;
+
+  void
+  reorder(std::vector<Vertex> & forward,
+          std::vector<Vertex> & backward);
+
+  // drops the holes left by removed vertices
+  void
+  compact();
+
+private:
+
+  std::vector<std::vector<Vertex>> _out;
+  std::vector<std::vector<Vertex>> _in;
+
+  // vertex -> position, and position -> vertex (None for holes)
+  std::vector<std::size_t> _position;
+  std::vector<Vertex>      _vertexAt;
+
+  std::vector<char> _present;
+  std::size_t       _vertexCount = 0;
+
+  // visit marks of the current search, compared against _searchEpoch
+  mutable std::vector<std::uint32_t> _visitMark;
+  mutable std::uint32_t              _searchEpoch = 0;
+  mutable std::vector<Vertex>        _stack;
+};
+}
@@ -0,0 +1,247 @@
+#include "BlobStore.hpp"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QJsonArray>
+
+#include <unordered_set>
+#include <utility>
+
+using QtNodes::BlobStore;
+using QtNodes::FlowSnapshot;
+
+namespace
+{
+
+QLatin1String const ReferenceKey("$blob");
+
+QString
+contentId(QByteArray const & data)
+{
+  return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+}
+
+}
+
+
+QString
+BlobStore::
+put(QByteArray const & data)
+{
+  QString const id = contentId(data);
+
+  if (_blobs.find(id) != _blobs.end())
+    return id;
+
+  Blob blob;
+  blob.size    = static_cast<quint64>(data.size());
+  blob.data    = data;
+  blob.decoded = true;
+
+  // qCompress() prepends the decoded size, which qUncompress() relies on
+  QByteArray compressed = qCompress(data);
+
+  if (compressed.size() < data.size())
+  {
+    blob.stored     = std::move(compressed);
+    blob.compressed = true;
+  }
+  else
+  {
+    blob.stored = data;
+  }
+
+  _blobs.emplace(id, std::move(blob));
+
+  return id;
+}
+
+
+QByteArray
+BlobStore::
+get(QString const & id) const
+{
+  auto it = _blobs.find(id);
+
+  if (it == _blobs.end())
+    return QByteArray();
+
+  Blob const & blob = it->second;
+
+  if (!blob.decoded)
+  {
+    blob.data    = blob.compressed ? qUncompress(blob.stored) : blob.stored;
+    blob.decoded = true;
+  }
+
+  return blob.data;
+}
+
+
+bool
+BlobStore::
+contains(QString const & id) const
+{
+  return _blobs.find(id) != _blobs.end();
+}
+
+
+bool
+BlobStore::
+insert(FlowSnapshot::BlobRecord const & record)
+{
+  if (contains(record.id))
+    return true;
+
+  // decoded only to be checked, it is kept in the smaller stored form
+  QByteArray const data = record.compressed ? qUncompress(record.data) : record.data;
+
+  if (static_cast<quint64>(data.size()) != record.size || contentId(data) != record.id)
+    return false;
+
+  Blob blob;
+  blob.stored     = record.data;
+  blob.compressed = record.compressed;
+  blob.size       = record.size;
+
+  _blobs.emplace(record.id, std::move(blob));
+
+  return true;
+}
+
+
+std::vector<FlowSnapshot::BlobRecord>
+BlobStore::
+records(std::vector<FlowSnapshot::NodeRecord> const & nodes) const
+{
+  std::vector<QString> ids;
+
+  for (FlowSnapshot::NodeRecord const & node : nodes)
+    collectReferences(node.model, ids);
+
+  std::vector<FlowSnapshot::BlobRecord> result;
+  std::unordered_set<QString> added;
+
+  for (QString const & id : ids)
+  {
+    auto it = _blobs.find(id);
+
+    if (it == _blobs.end() || !added.insert(id).second)
+      continue;
+
+    FlowSnapshot::BlobRecord record;
+    record.id         = id;
+    record.size       = it->second.size;
+    record.compressed = it->second.compressed;
+    record.data       = it->second.stored;
+
+    result.push_back(std::move(record));
+  }
+
+  return result;
+}
+
+
+void
+BlobStore::
+retain(std::vector<QString> const & ids)
+{
+  for (QString const & id : ids)
+    ++_retained[id];
+}
+
+
+void
+BlobStore::
+release(std::vector<QString> const & ids)
+{
+  for (QString const & id : ids)
+  {
+    auto it = _retained.find(id);
+
+    if (it != _retained.end() && --it->second == 0)
+      _retained.erase(it);
+  }
+}
+
+
+std::size_t
+BlobStore::
+collect(std::vector<FlowSnapshot::NodeRecord> const & nodes)
+{
+  std::vector<QString> ids;
+
+  for (FlowSnapshot::NodeRecord const & node : nodes)
+    collectReferences(node.model, ids);
+
+  std::unordered_set<QString> const referenced(ids.begin(), ids.end());
+
+  std::size_t dropped = 0;
+
+  for (auto it = _blobs.begin(); it != _blobs.end();)
+  {
+    if (referenced.count(it->first) == 0 && _retained.count(it->first) == 0)
+    {
+      it = _blobs.erase(it);
+      ++dropped;
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  return dropped;
+}
+
+
+QJsonObject
+BlobStore::
+reference(QString const & id)
+{
+  QJsonObject referenceJson;
+
+  referenceJson[ReferenceKey] = id;
+
+  return referenceJson;
+}
+
+
+QString
+BlobStore::
+referencedId(QJsonValue const & value)
+{
+  if (!value.isObject())
+    return QString();
+
+  QJsonObject const object = value.toObject();
+
+  if (object.size() != 1)
+    return QString();
+
+  return object.value(ReferenceKey).toString();
+}
+
+
+void
+BlobStore::
+collectReferences(QJsonValue const & value, std::vector<QString> & ids)
+{
+  QString const id = referencedId(value);
+
+  if (!id.isEmpty())
+  {
+    ids.push_back(id);
+  }
+  else if (value.isObject())
+  {
+    QJsonObject const object = value.toObject();
+
+    for (auto it = object.begin(); it != object.end(); ++it)
+      collectReferences(it.value(), ids);
+  }
+  else if (value.isArray())
+  {
+    for (QJsonValue const & element : value.toArray())
+      collectReferences(element, ids);
+  }
+}
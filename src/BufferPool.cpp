@@ -0,0 +1,273 @@
+#include "BufferPool.hpp"
+
+#include <mutex>
+#include <new>
+#include <vector>
+
+using QtNodes::BufferPool;
+using QtNodes::PooledBuffer;
+using QtNodes::SharedBuffer;
+
+constexpr std::size_t BufferPool::MinimumClassSize;
+
+namespace
+{
+
+std::size_t
+classIndex(std::size_t size)
+{
+  std::size_t index    = 0;
+  std::size_t capacity = BufferPool::MinimumClassSize;
+
+  while (capacity < size)
+  {
+    capacity <<= 1;
+    ++index;
+  }
+
+  return index;
+}
+
+
+std::size_t
+classCapacity(std::size_t index)
+{
+  return BufferPool::MinimumClassSize << index;
+}
+
+}
+
+
+struct BufferPool::State
+{
+  mutable std::mutex mutex;
+
+  Limits     limits;
+  Statistics statistics;
+
+  // idle buffers, one list per size class
+  std::vector<std::vector<unsigned char*>> idle;
+
+  ~State()
+  {
+    for (auto & list : idle)
+      for (unsigned char* p : list)
+        ::operator delete(p);
+  }
+
+  void
+  release(unsigned char* data, std::size_t capacity, bool pooled)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    ++statistics.releases;
+    statistics.bytesInUse -= capacity;
+
+    if (pooled)
+    {
+      std::size_t const index = classIndex(capacity);
+
+      if (index >= idle.size())
+        idle.resize(index + 1);
+
+      auto & list = idle[index];
+
+      if (list.size() < limits.maxBuffersPerClass &&
+          statistics.bytesRetained + capacity <= limits.maxRetainedBytes)
+      {
+        list.push_back(data);
+        statistics.bytesRetained += capacity;
+        return;
+      }
+    }
+
+    ++statistics.discards;
+    lock.unlock();
+
+    ::operator delete(data);
+  }
+
+  // Must be called with the mutex held. Returns the freed blocks so that
+  // they can be deleted outside of the lock.
+  std::vector<unsigned char*>
+  shrink(std::size_t maxRetainedBytes, std::size_t maxBuffersPerClass)
+  {
+    std::vector<unsigned char*> freed;
+
+    // Give up the largest buffers first, they are the most expensive to keep.
+    for (std::size_t i = idle.size(); i-- > 0; )
+    {
+      auto & list = idle[i];
+
+      while (!list.empty() &&
+             (list.size() > maxBuffersPerClass ||
+              statistics.bytesRetained > maxRetainedBytes))
+      {
+        freed.push_back(list.back());
+        list.pop_back();
+        statistics.bytesRetained -= classCapacity(i);
+        ++statistics.discards;
+      }
+    }
+
+    return freed;
+  }
+};
+
+
+BufferPool::
+BufferPool()
+  : BufferPool(Limits())
+{}
+
+
+BufferPool::
+BufferPool(Limits const & limits)
+  : _state(std::make_shared<State>())
+{
+  _state->limits = limits;
+}
+
+
+BufferPool::
+~BufferPool() = default;
+
+
+SharedBuffer
+BufferPool::
+acquire(std::size_t size)
+{
+  State & state = *_state;
+
+  bool        pooled   = false;
+  std::size_t capacity = size;
+
+  unsigned char* data = nullptr;
+
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    pooled = (size <= state.limits.maxPooledSize);
+
+    std::size_t const index = pooled ? classIndex(size) : 0;
+
+    if (pooled)
+      capacity = classCapacity(index);
+
+    ++state.statistics.acquisitions;
+    state.statistics.bytesInUse += capacity;
+
+    if (pooled && index < state.idle.size() && !state.idle[index].empty())
+    {
+      data = state.idle[index].back();
+      state.idle[index].pop_back();
+
+      state.statistics.bytesRetained -= capacity;
+      ++state.statistics.reuses;
+    }
+    else
+    {
+      ++state.statistics.allocations;
+    }
+  }
+
+  if (!data)
+  {
+    try
+    {
+      data = static_cast<unsigned char*>(::operator new(capacity));
+    }
+    catch (std::bad_alloc const &)
+    {
+      std::lock_guard<std::mutex> lock(state.mutex);
+      state.statistics.bytesInUse -= capacity;
+      throw;
+    }
+  }
+
+  std::shared_ptr<State> owner = _state;
+
+  return SharedBuffer(new PooledBuffer(data, size, capacity),
+                      [owner, pooled](PooledBuffer* buffer)
+                      {
+                        owner->release(buffer->data(),
+                                       buffer->capacity(),
+                                       pooled);
+                        delete buffer;
+                      });
+}
+
+
+BufferPool::Statistics
+BufferPool::
+statistics() const
+{
+  std::lock_guard<std::mutex> lock(_state->mutex);
+
+  return _state->statistics;
+}
+
+
+BufferPool::Limits
+BufferPool::
+limits() const
+{
+  std::lock_guard<std::mutex> lock(_state->mutex);
+
+  return _state->limits;
+}
+
+
+void
+BufferPool::
+setLimits(Limits const & limits)
+{
+  std::lock_guard<std::mutex> lock(_state->mutex);
+
+  _state->limits = limits;
+}
+
+
+void
+BufferPool::
+trim()
+{
+  std::vector<unsigned char*> freed;
+
+  {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+
+    freed = _state->shrink(_state->limits.maxRetainedBytes,
+                           _state->limits.maxBuffersPerClass);
+  }
+
+  for (unsigned char* p : freed)
+    ::operator delete(p);
+}
+
+
+void
+BufferPool::
+clear()
+{
+  std::vector<unsigned char*> freed;
+
+  {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+
+    freed = _state->shrink(0, 0);
+  }
+
+  for (unsigned char* p : freed)
+    ::operator delete(p);
+}
+
+
+BufferPool&
+BufferPool::
+instance()
+{
+  static BufferPool pool;
+
+  return pool;
+}
@@ -33,8 +33,7 @@ Connection::
 Connection(PortType portType,
            Node& node,
            PortIndex portIndex)
-  : _uid(QUuid::createUuid())
-  , _outPortIndex(INVALID)
+  : _outPortIndex(INVALID)
   , _inPortIndex(INVALID)
   , _connectionState()
 {
@@ -49,8 +48,7 @@ Connection(Node& nodeIn,
            Node& nodeOut,
            PortIndex portIndexOut,
            TypeConverter typeConverter)
-  : _uid(QUuid::createUuid())
-  , _outNode(&nodeOut)
+  : _outNode(&nodeOut)
   , _inNode(&nodeIn)
   , _outPortIndex(portIndexOut)
   , _inPortIndex(portIndexIn)
@@ -71,14 +69,16 @@ Connection::
     connectionMadeIncomplete(*this);
   }
 
-  propagateEmptyData();
-
-  if (_inNode)
+  // Nodes going away together with this connection need neither the
+  // empty data nor a repaint.
+  if (_inNode && !_inNode->isDoomed())
   {
+    propagateEmptyData();
+
     _inNode->nodeGraphicsObject().update();
   }
 
-  if (_outNode)
+  if (_outNode && !_outNode->isDoomed())
   {
     _outNode->nodeGraphicsObject().update();
   }
@@ -143,6 +143,9 @@ QUuid
 Connection::
 id() const
 {
+  if (_uid.isNull())
+    _uid = QUuid::createUuid();
+
   return _uid;
 }
 
@@ -280,10 +283,10 @@ Connection::
 removeFromNodes() const
 {
   if (_inNode)
-    _inNode->nodeState().eraseConnection(PortType::In, _inPortIndex, id());
+    _inNode->nodeState().eraseConnection(PortType::In, _inPortIndex, *this);
 
   if (_outNode)
-    _outNode->nodeState().eraseConnection(PortType::Out, _outPortIndex, id());
+    _outNode->nodeState().eraseConnection(PortType::Out, _outPortIndex, *this);
 }
 
 
@@ -30,7 +30,7 @@ ConnectionGraphicsObject(FlowScene &scene,
     : _scene(scene)
     , _connection(connection)
 {
-    _scene.addItem(this);
+    // FlowScene adds the item once the connection is set up.
 
     setFlag(QGraphicsItem::ItemIsMovable, true);
     setFlag(QGraphicsItem::ItemIsFocusable, true);
@@ -48,7 +48,8 @@ ConnectionGraphicsObject(FlowScene &scene,
 ConnectionGraphicsObject::
 ~ConnectionGraphicsObject()
 {
-    _scene.removeItem(this);
+    if (scene())
+        _scene.removeItem(this);
 }
 
 
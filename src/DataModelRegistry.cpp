@@ -2,6 +2,8 @@
 
 #include <QtCore/QFile>
 #include <QtWidgets/QMessageBox>
+#include <mutex>
+#include <stdexcept>
 #include <stdio.h>
 
 using QtNodes::DataModelRegistry;
@@ -9,15 +11,117 @@ using QtNodes::NodeDataModel;
 using QtNodes::NodeDataType;
 using QtNodes::TypeConverter;
 
+DataModelRegistry::
+DataModelRegistry(DataModelRegistry &&other)
+{
+    *this = std::move(other);
+}
+
+
+DataModelRegistry &
+DataModelRegistry::
+operator=(DataModelRegistry &&other)
+{
+    if (this != &other)
+    {
+        std::unique_lock<std::shared_timed_mutex> lock(_mutex, std::defer_lock);
+        std::unique_lock<std::shared_timed_mutex> otherLock(other._mutex, std::defer_lock);
+        std::lock(lock, otherLock);
+
+        _registeredModelsCategory = std::move(other._registeredModelsCategory);
+        _categories               = std::move(other._categories);
+        _registeredItemCreators   = std::move(other._registeredItemCreators);
+        _registeredTypeConverters = std::move(other._registeredTypeConverters);
+
+        _frozen = other._frozen.load();
+    }
+
+    return *this;
+}
+
+
+void
+DataModelRegistry::
+registerCreator(QString const &name,
+                RegistryItemCreator creator,
+                QString const &category)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(_mutex);
+
+    if (_frozen)
+        throw std::logic_error("Registering model " + name.toStdString() +
+                               " in a frozen DataModelRegistry");
+
+    // Creators are never replaced nor removed, which keeps the pointers
+    // handed out by findCreator() valid.
+    if (!_registeredItemCreators.count(name))
+    {
+        _registeredItemCreators[name] = std::move(creator);
+        _categories.insert(category);
+        _registeredModelsCategory[name] = category;
+    }
+}
+
+
+void
+DataModelRegistry::
+registerTypeConverter(TypeConverterId const & id,
+                      TypeConverter typeConverter)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(_mutex);
+
+    if (_frozen)
+        throw std::logic_error("Registering a type converter in a frozen DataModelRegistry");
+
+    _registeredTypeConverters[id] = std::move(typeConverter);
+}
+
+
+void
+DataModelRegistry::
+freeze()
+{
+    // Waits for registrations in flight; readers that see the flag set
+    // also see everything registered before.
+    std::unique_lock<std::shared_timed_mutex> lock(_mutex);
+
+    _frozen.store(true, std::memory_order_release);
+}
+
+
+bool
+DataModelRegistry::
+isFrozen() const
+{
+    return _frozen.load(std::memory_order_acquire);
+}
+
+
+DataModelRegistry::RegistryItemCreator const *
+DataModelRegistry::
+findCreator(QString const &modelName) const
+{
+    std::shared_lock<std::shared_timed_mutex> lock(_mutex, std::defer_lock);
+
+    if (!isFrozen())
+        lock.lock();
+
+    auto it = _registeredItemCreators.find(modelName);
+
+    return (it != _registeredItemCreators.end()) ? &it->second : nullptr;
+}
+
+
 std::unique_ptr<NodeDataModel>
 DataModelRegistry::
 create(QString const &modelName)
 {
-    auto it = _registeredItemCreators.find(modelName);
+    // The model is constructed outside of the lock.
+    RegistryItemCreator const * creator = findCreator(modelName);
 
-    if (it != _registeredItemCreators.end())
+    if (creator)
     {
-        return it->second();
+        return (*creator)();
     }
 
     return nullptr;
@@ -53,9 +157,14 @@ DataModelRegistry::
 getTypeConverter(NodeDataType const & d1,
                  NodeDataType const & d2) const
 {
-    TypeConverterId converterId = std::make_pair(d1, d2);
+    // Until the registry is frozen the converter could be replaced while
+    // it is being copied, so the copy is made under the lock.
+    std::shared_lock<std::shared_timed_mutex> lock(_mutex, std::defer_lock);
 
-    auto it = _registeredTypeConverters.find(converterId);
+    if (!isFrozen())
+        lock.lock();
+
+    auto it = _registeredTypeConverters.find(std::make_pair(d1, d2));
 
     if (it != _registeredTypeConverters.end())
     {
@@ -64,3 +173,19 @@ getTypeConverter(NodeDataType const & d1,
 
     return TypeConverter{};
 }
+
+
+TypeConverter const *
+DataModelRegistry::
+findTypeConverter(NodeDataType const & d1,
+                  NodeDataType const & d2) const
+{
+    std::shared_lock<std::shared_timed_mutex> lock(_mutex, std::defer_lock);
+
+    if (!isFrozen())
+        lock.lock();
+
+    auto it = _registeredTypeConverters.find(std::make_pair(d1, d2));
+
+    return (it != _registeredTypeConverters.end()) ? &it->second : nullptr;
+}
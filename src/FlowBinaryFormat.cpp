@@ -0,0 +1,1430 @@
+#include "FlowBinaryFormat.hpp"
+
+#include <QtCore/QHash>
+#include <QtCore/QIODevice>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QtEndian>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "BlobStore.hpp"
+
+using QtNodes::BlobStore;
+using QtNodes::FlowBinaryFormat;
+using QtNodes::FlowHeader;
+using QtNodes::FlowSnapshot;
+using QtNodes::NodeDataType;
+using QtNodes::PortIndex;
+
+constexpr std::uint16_t FlowBinaryFormat::MajorVersion;
+constexpr std::uint16_t FlowBinaryFormat::MinorVersion;
+
+namespace
+{
+
+char const Magic[8] = { 'Q', 'N', 'F', 'L', 'O', 'W', 'B', '\0' };
+
+std::size_t const HeaderSize = 16;
+std::size_t const ChunkHeaderSize = 16;
+
+std::size_t const NodeRecordSize       = 56;
+std::size_t const ConnectionRecordSize = 40;
+std::size_t const PointSize            = 16;
+std::size_t const BlobRecordSize       = 64;
+std::size_t const SummarySize          = 56;
+
+int const BlobIdSize = 32;
+
+// blob record flag
+std::uint32_t const BlobCompressed = 0x1;
+
+std::size_t const IndexIdSize     = 24;
+std::size_t const IndexBucketSize = 16;
+
+// nodes per spatial bucket the index aims at
+std::uint32_t const NodesPerBucket = 16;
+
+// string index of a connection without converter
+std::uint32_t const NoString = 0xffffffffu;
+
+// node position of an id missing from the index
+std::uint32_t const NoNode = 0xffffffffu;
+
+
+class Writer
+{
+public:
+
+  template <typename T>
+  void
+  put(T value)
+  {
+    T const le = qToLittleEndian(value);
+    _data.append(reinterpret_cast<char const*>(&le), sizeof(T));
+  }
+
+  void
+  putDouble(double value)
+  {
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put(bits);
+  }
+
+  void
+  putBytes(char const* bytes, std::size_t size)
+  {
+    _data.append(bytes, static_cast<int>(size));
+  }
+
+  /// Returns the offset of the payload, to be passed to endChunk().
+  int
+  beginChunk(char const (&tag)[5])
+  {
+    putBytes(tag, 4);
+    put<std::uint32_t>(0);
+    put<quint64>(0);
+
+    return _data.size();
+  }
+
+  void
+  endChunk(int payload)
+  {
+    auto const size = static_cast<quint64>(_data.size() - payload);
+
+    qToLittleEndian(size, reinterpret_cast<uchar*>(_data.data() + payload - 8));
+
+    while (_data.size() % 8 != 0)
+      _data.append('\0');
+  }
+
+  QByteArray &
+  data() { return _data; }
+
+private:
+
+  QByteArray _data;
+};
+
+
+class Reader
+{
+public:
+
+  Reader(char const* data, std::size_t size)
+    : _data(data)
+    , _size(size)
+  {}
+
+  bool
+  atEnd() const { return _pos == _size; }
+
+  std::size_t
+  remaining() const { return _size - _pos; }
+
+  template <typename T>
+  T
+  get()
+  {
+    return qFromLittleEndian<T>(reinterpret_cast<uchar const*>(take(sizeof(T))));
+  }
+
+  double
+  getDouble()
+  {
+    quint64 const bits = get<quint64>();
+
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+
+    return value;
+  }
+
+  char const*
+  take(quint64 size)
+  {
+    if (size > remaining())
+      throw std::logic_error("Truncated binary flow");
+
+    char const* bytes = _data + _pos;
+    _pos += static_cast<std::size_t>(size);
+
+    return bytes;
+  }
+
+  /// Start of `count` records of `recordSize` bytes each.
+  char const*
+  takeArray(quint64 count, std::size_t recordSize)
+  {
+    if (count > remaining() / recordSize)
+      throw std::logic_error("Truncated binary flow");
+
+    return take(count * recordSize);
+  }
+
+private:
+
+  char const* _data;
+  std::size_t _size;
+  std::size_t _pos = 0;
+};
+
+
+struct Chunk
+{
+  char const* data = nullptr;
+  std::size_t size = 0;
+};
+
+
+std::uint32_t
+readU32(char const* p)
+{
+  return qFromLittleEndian<std::uint32_t>(reinterpret_cast<uchar const*>(p));
+}
+
+
+quint64
+readU64(char const* p)
+{
+  return qFromLittleEndian<quint64>(reinterpret_cast<uchar const*>(p));
+}
+
+
+double
+readDouble(char const* p)
+{
+  quint64 const bits = readU64(p);
+
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+
+  return value;
+}
+
+
+struct Layout
+{
+  Chunk head, strs, blob, node, modl, conn, pnts, indx;
+};
+
+
+FlowHeader
+decodeHeader(char const* data, std::size_t size)
+{
+  Reader r(data, size);
+
+  FlowHeader header;
+
+  header.nodeCount       = r.get<quint64>();
+  header.connectionCount = r.get<quint64>();
+
+  double const x      = r.getDouble();
+  double const y      = r.getDouble();
+  double const width  = r.getDouble();
+  double const height = r.getDouble();
+
+  header.bounds = QRectF(x, y, width, height);
+
+  quint64 const thumbnailSize = r.get<quint64>();
+  char const*   thumbnail     = r.take(thumbnailSize);
+
+  header.thumbnail = QByteArray(thumbnail, static_cast<int>(thumbnailSize));
+
+  return header;
+}
+
+
+// Locates the chunks of a file, checking the header and the chunk sizes.
+Layout
+parseChunks(char const* data, std::size_t size)
+{
+  if (!FlowBinaryFormat::isBinary(data, size))
+    throw std::logic_error("Not a binary flow");
+
+  Reader file(data, size);
+
+  file.take(sizeof(Magic));
+
+  std::uint16_t const major = file.get<std::uint16_t>();
+  file.get<std::uint16_t>();
+  file.get<std::uint32_t>();
+
+  if (major != FlowBinaryFormat::MajorVersion)
+    throw std::logic_error("Unsupported binary flow version");
+
+  Layout layout;
+
+  while (!file.atEnd())
+  {
+    char const* tag = file.take(4);
+    file.get<std::uint32_t>();
+
+    quint64 const payloadSize = file.get<quint64>();
+
+    Chunk chunk;
+    chunk.data = file.take(payloadSize);
+    chunk.size = static_cast<std::size_t>(payloadSize);
+
+    // the last chunk may come without padding
+    file.take(std::min<quint64>((8 - payloadSize % 8) % 8, file.remaining()));
+
+    if (std::memcmp(tag, "HEAD", 4) == 0)
+      layout.head = chunk;
+    else if (std::memcmp(tag, "STRS", 4) == 0)
+      layout.strs = chunk;
+    else if (std::memcmp(tag, "BLOB", 4) == 0)
+      layout.blob = chunk;
+    else if (std::memcmp(tag, "NODE", 4) == 0)
+      layout.node = chunk;
+    else if (std::memcmp(tag, "MODL", 4) == 0)
+      layout.modl = chunk;
+    else if (std::memcmp(tag, "CONN", 4) == 0)
+      layout.conn = chunk;
+    else if (std::memcmp(tag, "PNTS", 4) == 0)
+      layout.pnts = chunk;
+    else if (std::memcmp(tag, "INDX", 4) == 0)
+      layout.indx = chunk;
+  }
+
+  return layout;
+}
+
+
+// Decodes single records of a file, so that reading part of it costs in
+// proportion to that part. Only the string table is decoded up front.
+class Decoder
+{
+public:
+
+  explicit
+  Decoder(Layout const & layout)
+    : _modl(layout.modl)
+  {
+    if (layout.strs.data)
+    {
+      Reader r(layout.strs.data, layout.strs.size);
+
+      std::uint32_t const count = r.get<std::uint32_t>();
+      char const* table = r.takeArray(count, 8);
+      char const* text  = r.take(r.remaining());
+
+      std::size_t const textSize =
+        layout.strs.size - static_cast<std::size_t>(text - layout.strs.data);
+
+      _strings.reserve(count);
+
+      for (std::uint32_t i = 0; i < count; ++i)
+      {
+        quint64 const offset = readU32(table + 8 * i);
+        quint64 const length = readU32(table + 8 * i + 4);
+
+        if (offset + length > textSize)
+          throw std::logic_error("Malformed string table in binary flow");
+
+        _strings.push_back(QString::fromUtf8(text + offset, static_cast<int>(length)));
+      }
+    }
+
+    if (layout.blob.data)
+    {
+      Reader r(layout.blob.data, layout.blob.size);
+
+      _blobCount = r.get<std::uint32_t>();
+      r.get<std::uint32_t>();
+
+      _blobs       = r.takeArray(_blobCount, BlobRecordSize);
+      _blobContent = r.take(r.remaining());
+
+      _blobContentSize =
+        layout.blob.size - static_cast<std::size_t>(_blobContent - layout.blob.data);
+    }
+
+    if (layout.node.data)
+    {
+      Reader r(layout.node.data, layout.node.size);
+
+      _nodeCount = r.get<std::uint32_t>();
+      r.get<std::uint32_t>();
+
+      _nodes = r.takeArray(_nodeCount, NodeRecordSize);
+    }
+
+    if (layout.pnts.data)
+    {
+      Reader r(layout.pnts.data, layout.pnts.size);
+
+      _pointCount = r.get<quint64>();
+      _points     = r.takeArray(_pointCount, PointSize);
+    }
+
+    if (layout.conn.data)
+    {
+      Reader r(layout.conn.data, layout.conn.size);
+
+      _connectionCount = r.get<std::uint32_t>();
+      r.get<std::uint32_t>();
+
+      _connections = r.takeArray(_connectionCount, ConnectionRecordSize);
+    }
+  }
+
+  std::uint32_t
+  nodeCount() const { return _nodeCount; }
+
+  std::uint32_t
+  connectionCount() const { return _connectionCount; }
+
+  std::uint32_t
+  blobCount() const { return _blobCount; }
+
+  /// Raw RFC 4122 bytes of the node's uuid.
+  QByteArray
+  nodeId(std::uint32_t i) const
+  {
+    return QByteArray::fromRawData(_nodes + i * NodeRecordSize, 16);
+  }
+
+  QPointF
+  position(std::uint32_t i) const
+  {
+    char const* p = _nodes + i * NodeRecordSize;
+
+    return QPointF(readDouble(p + 24), readDouble(p + 32));
+  }
+
+  FlowSnapshot::NodeRecord
+  node(std::uint32_t i) const
+  {
+    char const* p = _nodes + i * NodeRecordSize;
+
+    FlowSnapshot::NodeRecord record;
+
+    record.id       = QUuid::fromRfc4122(nodeId(i));
+    record.position = position(i);
+
+    quint64 const offset = readU64(p + 40);
+    quint64 const length = readU64(p + 48);
+
+    if (offset > _modl.size || length > _modl.size - offset)
+      throw std::logic_error("Malformed model reference in binary flow");
+
+    if (length > 0)
+    {
+      QJsonParseError error;
+      QJsonDocument const state =
+        QJsonDocument::fromJson(QByteArray::fromRawData(_modl.data + offset,
+                                                        static_cast<int>(length)),
+                                &error);
+
+      if (error.error != QJsonParseError::NoError)
+        throw std::logic_error("Malformed model state in binary flow");
+
+      record.model = state.object();
+    }
+
+    record.model["name"] = string(readU32(p + 16));
+
+    return record;
+  }
+
+  /// Position in NODE of the connection's output end.
+  std::uint32_t
+  outNode(std::uint32_t i) const
+  {
+    return checkedNode(readU32(_connections + i * ConnectionRecordSize));
+  }
+
+  /// Position in NODE of the connection's input end.
+  std::uint32_t
+  inNode(std::uint32_t i) const
+  {
+    return checkedNode(readU32(_connections + i * ConnectionRecordSize + 8));
+  }
+
+  FlowSnapshot::ConnectionRecord
+  connection(std::uint32_t i) const
+  {
+    char const* p = _connections + i * ConnectionRecordSize;
+
+    FlowSnapshot::ConnectionRecord record;
+
+    record.outNode = checkedNode(readU32(p));
+    record.outPort = static_cast<PortIndex>(static_cast<std::int32_t>(readU32(p + 4)));
+    record.inNode  = checkedNode(readU32(p + 8));
+    record.inPort  = static_cast<PortIndex>(static_cast<std::int32_t>(readU32(p + 12)));
+
+    quint64 const first  = readU32(p + 16);
+    quint64 const length = readU32(p + 20);
+
+    if (first + length > _pointCount)
+      throw std::logic_error("Malformed turning points in binary flow");
+
+    record.turningPoints.reserve(static_cast<int>(length));
+
+    for (quint64 k = first; k < first + length; ++k)
+    {
+      char const* point = _points + k * PointSize;
+      record.turningPoints.append(QPointF(readDouble(point),
+                                          readDouble(point + 8)));
+    }
+
+    if (readU32(p + 24) != NoString)
+    {
+      record.hasConverter = true;
+      record.inType  = NodeDataType{ string(readU32(p + 24)), string(readU32(p + 28)) };
+      record.outType = NodeDataType{ string(readU32(p + 32)), string(readU32(p + 36)) };
+    }
+
+    return record;
+  }
+
+  QString
+  blobId(std::uint32_t i) const
+  {
+    return QString::fromLatin1(QByteArray::fromRawData(_blobs + i * BlobRecordSize,
+                                                       BlobIdSize).toHex());
+  }
+
+  FlowSnapshot::BlobRecord
+  blob(std::uint32_t i) const
+  {
+    char const* p = _blobs + i * BlobRecordSize;
+
+    quint64 const offset = readU64(p + 48);
+    quint64 const length = readU64(p + 56);
+
+    if (offset > _blobContentSize || length > _blobContentSize - offset)
+      throw std::logic_error("Malformed blob in binary flow");
+
+    FlowSnapshot::BlobRecord record;
+
+    record.id         = blobId(i);
+    record.compressed = (readU32(p + 32) & BlobCompressed) != 0;
+    record.size       = readU64(p + 40);
+
+    // copied, the blob outlives a mapping of the file
+    record.data = QByteArray(_blobContent + offset, static_cast<int>(length));
+
+    return record;
+  }
+
+private:
+
+  QString const &
+  string(std::uint32_t index) const
+  {
+    if (index >= _strings.size())
+      throw std::logic_error("Malformed string reference in binary flow");
+
+    return _strings[index];
+  }
+
+  std::uint32_t
+  checkedNode(std::uint32_t index) const
+  {
+    if (index >= _nodeCount)
+      throw std::logic_error("Connection refers to a node missing from the flow");
+
+    return index;
+  }
+
+private:
+
+  Chunk _modl;
+
+  std::vector<QString> _strings;
+
+  char const*   _nodes     = nullptr;
+  std::uint32_t _nodeCount = 0;
+
+  char const*   _connections     = nullptr;
+  std::uint32_t _connectionCount = 0;
+
+  char const* _points     = nullptr;
+  quint64     _pointCount = 0;
+
+  char const*   _blobs           = nullptr;
+  std::uint32_t _blobCount       = 0;
+  char const*   _blobContent     = nullptr;
+  std::size_t   _blobContentSize = 0;
+};
+
+
+std::int32_t
+cellOf(double coordinate, double cellSize)
+{
+  double const cell = std::floor(coordinate / cellSize);
+
+  // NaN lands in the first cell
+  if (!(cell >= std::numeric_limits<std::int32_t>::min()))
+    return std::numeric_limits<std::int32_t>::min();
+
+  if (cell > std::numeric_limits<std::int32_t>::max())
+    return std::numeric_limits<std::int32_t>::max();
+
+  return static_cast<std::int32_t>(cell);
+}
+
+
+// Side of square cells holding NodesPerBucket nodes if the nodes were
+// spread evenly over their bounds. The bounds leave out the outermost
+// tenth of the coordinates on every side, so that a few nodes far away
+// from the others don't make every cell huge; they get cells of their own.
+double
+cellSizeOf(std::vector<QPointF> const & positions)
+{
+  std::vector<double> xs;
+  std::vector<double> ys;
+
+  xs.reserve(positions.size());
+  ys.reserve(positions.size());
+
+  for (QPointF const & p : positions)
+  {
+    // NaN would break the ordering
+    if (std::isfinite(p.x()) && std::isfinite(p.y()))
+    {
+      xs.push_back(p.x());
+      ys.push_back(p.y());
+    }
+  }
+
+  if (xs.empty())
+    return 1.0;
+
+  std::size_t const low  = xs.size() / 10;
+  std::size_t const high = xs.size() - 1 - low;
+
+  auto quantile = [](std::vector<double> & values, std::size_t k)
+  {
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+  };
+
+  double const minX = quantile(xs, low);
+  double const maxX = quantile(xs, high);
+  double const minY = quantile(ys, low);
+  double const maxY = quantile(ys, high);
+
+  std::size_t inside = 0;
+
+  for (QPointF const & p : positions)
+  {
+    if (p.x() >= minX && p.x() <= maxX && p.y() >= minY && p.y() <= maxY)
+      ++inside;
+  }
+
+  double const area = std::max(maxX - minX, 1.0) * std::max(maxY - minY, 1.0);
+
+  return std::max(1.0, std::sqrt(area * NodesPerBucket / std::max<std::size_t>(inside, 1)));
+}
+
+
+// Payload of an INDX chunk. `ids` are RFC 4122 bytes, `inNodes` the
+// input end of every connection.
+QByteArray
+buildIndex(std::vector<QByteArray> const & ids,
+           std::vector<QPointF> const & positions,
+           std::vector<std::uint32_t> const & inNodes)
+{
+  auto const count           = static_cast<std::uint32_t>(ids.size());
+  auto const connectionCount = static_cast<std::uint32_t>(inNodes.size());
+
+  double const cellSize = cellSizeOf(positions);
+
+  struct Placement
+  {
+    std::int32_t  cellY;
+    std::int32_t  cellX;
+    std::uint32_t node;
+
+    bool
+    operator<(Placement const & other) const
+    {
+      return std::tie(cellY, cellX, node) <
+             std::tie(other.cellY, other.cellX, other.node);
+    }
+  };
+
+  std::vector<Placement> placements;
+  placements.reserve(count);
+
+  std::vector<std::uint32_t> byId(count);
+
+  for (std::uint32_t i = 0; i < count; ++i)
+  {
+    QPointF const p = positions[i];
+    placements.push_back({ cellOf(p.y(), cellSize), cellOf(p.x(), cellSize), i });
+
+    byId[i] = i;
+  }
+
+  std::sort(placements.begin(), placements.end());
+
+  std::sort(byId.begin(), byId.end(), [&](std::uint32_t a, std::uint32_t b)
+  {
+    return std::memcmp(ids[a].constData(), ids[b].constData(), 16) < 0;
+  });
+
+  // incoming connections of every node, by connection position
+  std::vector<std::uint32_t> offsets(count + 1, 0);
+
+  for (std::uint32_t c = 0; c < connectionCount; ++c)
+    ++offsets[inNodes[c] + 1];
+
+  for (std::uint32_t i = 0; i < count; ++i)
+    offsets[i + 1] += offsets[i];
+
+  std::vector<std::uint32_t> incoming(connectionCount);
+  std::vector<std::uint32_t> filled(offsets.begin(), offsets.end() - 1);
+
+  for (std::uint32_t c = 0; c < connectionCount; ++c)
+    incoming[filled[inNodes[c]]++] = c;
+
+  Writer writer;
+
+  std::uint32_t bucketCount = 0;
+
+  for (std::size_t i = 0; i < placements.size(); ++i)
+  {
+    if (i == 0 ||
+        placements[i].cellY != placements[i - 1].cellY ||
+        placements[i].cellX != placements[i - 1].cellX)
+      ++bucketCount;
+  }
+
+  writer.put(count);
+  writer.put(bucketCount);
+  writer.putDouble(cellSize);
+
+  for (std::uint32_t node : byId)
+  {
+    writer.putBytes(ids[node].constData(), 16);
+    writer.put(node);
+    writer.put<std::uint32_t>(0);
+  }
+
+  for (std::size_t first = 0; first < placements.size();)
+  {
+    std::size_t last = first + 1;
+
+    while (last < placements.size() &&
+           placements[last].cellY == placements[first].cellY &&
+           placements[last].cellX == placements[first].cellX)
+      ++last;
+
+    writer.put(placements[first].cellX);
+    writer.put(placements[first].cellY);
+    writer.put(static_cast<std::uint32_t>(first));
+    writer.put(static_cast<std::uint32_t>(last - first));
+
+    first = last;
+  }
+
+  for (Placement const & placement : placements)
+    writer.put(placement.node);
+
+  for (std::uint32_t offset : offsets)
+    writer.put(offset);
+
+  for (std::uint32_t connection : incoming)
+    writer.put(connection);
+
+  return std::move(writer.data());
+}
+
+
+// Index of a file written without one.
+QByteArray
+buildIndex(Decoder const & decoder)
+{
+  std::vector<QByteArray> ids;
+  std::vector<QPointF>    positions;
+
+  ids.reserve(decoder.nodeCount());
+  positions.reserve(decoder.nodeCount());
+
+  for (std::uint32_t i = 0; i < decoder.nodeCount(); ++i)
+  {
+    ids.push_back(decoder.nodeId(i));
+    positions.push_back(decoder.position(i));
+  }
+
+  std::vector<std::uint32_t> inNodes;
+  inNodes.reserve(decoder.connectionCount());
+
+  for (std::uint32_t c = 0; c < decoder.connectionCount(); ++c)
+    inNodes.push_back(decoder.inNode(c));
+
+  return buildIndex(ids, positions, inNodes);
+}
+
+
+// Lookups in the INDX chunk of a file, or in an index built in memory
+// for files written before there was one.
+class Index
+{
+public:
+
+  Index(Layout const & layout, Decoder const & decoder)
+    : _decoder(decoder)
+  {
+    if (!layout.indx.data)
+      _built = buildIndex(decoder);
+
+    Reader r(layout.indx.data ? layout.indx.data : _built.constData(),
+             layout.indx.data ? layout.indx.size : static_cast<std::size_t>(_built.size()));
+
+    _count = r.get<std::uint32_t>();
+
+    std::uint32_t const bucketCount = r.get<std::uint32_t>();
+
+    _cellSize = r.getDouble();
+
+    if (_count != decoder.nodeCount() || !(_cellSize > 0))
+      throw std::logic_error("Malformed index in binary flow");
+
+    _ids         = r.takeArray(_count, IndexIdSize);
+    _buckets     = r.takeArray(bucketCount, IndexBucketSize);
+    _bucketCount = bucketCount;
+    _members     = r.takeArray(_count, 4);
+    _offsets     = r.takeArray(quint64(_count) + 1, 4);
+
+    _incomingCount = readU32(_offsets + 4 * _count);
+    _incoming      = r.takeArray(_incomingCount, 4);
+  }
+
+  /// Position in NODE of the node, or NoNode.
+  std::uint32_t
+  find(QUuid const & id) const
+  {
+    QByteArray const key = id.toRfc4122();
+
+    std::uint32_t low = 0, high = _count;
+
+    while (low < high)
+    {
+      std::uint32_t const middle = low + (high - low) / 2;
+
+      if (std::memcmp(_ids + middle * IndexIdSize, key.constData(), 16) < 0)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+
+    if (low == _count || std::memcmp(_ids + low * IndexIdSize, key.constData(), 16) != 0)
+      return NoNode;
+
+    return node(readU32(_ids + low * IndexIdSize + 16));
+  }
+
+  /// Calls `visit` with the nodes of the cells `region` overlaps.
+  template <typename Visit>
+  void
+  forEachNear(QRectF const & region, Visit visit) const
+  {
+    std::int32_t const x0 = cellOf(region.left(), _cellSize);
+    std::int32_t const x1 = cellOf(region.right(), _cellSize);
+    std::int32_t const y0 = cellOf(region.top(), _cellSize);
+    std::int32_t const y1 = cellOf(region.bottom(), _cellSize);
+
+    auto visitBucket = [&](std::uint32_t bucket)
+    {
+      char const* p = _buckets + bucket * IndexBucketSize;
+
+      quint64 const first  = readU32(p + 8);
+      quint64 const length = readU32(p + 12);
+
+      if (first + length > _count)
+        throw std::logic_error("Malformed index in binary flow");
+
+      for (quint64 k = first; k < first + length; ++k)
+        visit(node(readU32(_members + 4 * k)));
+    };
+
+    // a region spanning more rows than there are buckets is cheaper to
+    // test bucket by bucket
+    if (std::int64_t(y1) - y0 >= _bucketCount)
+    {
+      for (std::uint32_t bucket = 0; bucket < _bucketCount; ++bucket)
+      {
+        std::int32_t const x = cellX(bucket), y = cellY(bucket);
+
+        if (x >= x0 && x <= x1 && y >= y0 && y <= y1)
+          visitBucket(bucket);
+      }
+
+      return;
+    }
+
+    for (std::int64_t y = y0; y <= y1; ++y)
+    {
+      // first bucket at or after (y, x0), the buckets are sorted by row
+      std::uint32_t low = 0, high = _bucketCount;
+
+      while (low < high)
+      {
+        std::uint32_t const middle = low + (high - low) / 2;
+
+        if (std::make_pair(std::int64_t(cellY(middle)), cellX(middle)) <
+            std::make_pair(y, x0))
+          low = middle + 1;
+        else
+          high = middle;
+      }
+
+      for (std::uint32_t bucket = low;
+           bucket < _bucketCount && cellY(bucket) == y && cellX(bucket) <= x1;
+           ++bucket)
+        visitBucket(bucket);
+    }
+  }
+
+  /// Calls `visit` with the position in CONN of every connection ending
+  /// at an input of `node`.
+  template <typename Visit>
+  void
+  forEachIncoming(std::uint32_t node, Visit visit) const
+  {
+    std::uint32_t const first = readU32(_offsets + 4 * node);
+    std::uint32_t const last  = readU32(_offsets + 4 * (node + 1));
+
+    if (first > last || last > _incomingCount)
+      throw std::logic_error("Malformed index in binary flow");
+
+    for (std::uint32_t k = first; k < last; ++k)
+    {
+      std::uint32_t const connection = readU32(_incoming + 4 * k);
+
+      if (connection >= _decoder.connectionCount())
+        throw std::logic_error("Malformed index in binary flow");
+
+      visit(connection);
+    }
+  }
+
+private:
+
+  std::int32_t
+  cellX(std::uint32_t bucket) const
+  {
+    return static_cast<std::int32_t>(readU32(_buckets + bucket * IndexBucketSize));
+  }
+
+  std::int32_t
+  cellY(std::uint32_t bucket) const
+  {
+    return static_cast<std::int32_t>(readU32(_buckets + bucket * IndexBucketSize + 4));
+  }
+
+  std::uint32_t
+  node(std::uint32_t index) const
+  {
+    if (index >= _count)
+      throw std::logic_error("Malformed index in binary flow");
+
+    return index;
+  }
+
+private:
+
+  Decoder const & _decoder;
+
+  QByteArray _built;
+
+  std::uint32_t _count = 0;
+  double        _cellSize = 1;
+
+  char const*   _ids = nullptr;
+  char const*   _buckets = nullptr;
+  std::uint32_t _bucketCount = 0;
+  char const*   _members = nullptr;
+  char const*   _offsets = nullptr;
+  char const*   _incoming = nullptr;
+  std::uint32_t _incomingCount = 0;
+};
+
+
+// The given nodes and connections of a file, in file order, with the
+// connections renumbered and the blobs the models refer to.
+FlowSnapshot
+extract(Decoder const & decoder,
+        std::vector<std::uint32_t> nodes,
+        std::vector<std::uint32_t> connections)
+{
+  std::sort(nodes.begin(), nodes.end());
+  std::sort(connections.begin(), connections.end());
+
+  FlowSnapshot snapshot;
+  snapshot.nodes.reserve(nodes.size());
+  snapshot.connections.reserve(connections.size());
+
+  std::unordered_map<std::uint32_t, std::size_t> position;
+  position.reserve(nodes.size());
+
+  std::vector<QString> blobIds;
+
+  for (std::uint32_t node : nodes)
+  {
+    position[node] = snapshot.nodes.size();
+    snapshot.nodes.push_back(decoder.node(node));
+
+    BlobStore::collectReferences(snapshot.nodes.back().model, blobIds);
+  }
+
+  for (std::uint32_t connection : connections)
+  {
+    FlowSnapshot::ConnectionRecord record = decoder.connection(connection);
+
+    record.outNode = position.at(static_cast<std::uint32_t>(record.outNode));
+    record.inNode  = position.at(static_cast<std::uint32_t>(record.inNode));
+
+    snapshot.connections.push_back(std::move(record));
+  }
+
+  if (!blobIds.empty())
+  {
+    std::unordered_set<QString> const wanted(blobIds.begin(), blobIds.end());
+
+    for (std::uint32_t i = 0; i < decoder.blobCount(); ++i)
+    {
+      if (wanted.count(decoder.blobId(i)) != 0)
+        snapshot.blobs.push_back(decoder.blob(i));
+    }
+  }
+
+  return snapshot;
+}
+
+}
+
+
+bool
+FlowBinaryFormat::
+isBinary(char const* data, std::size_t size)
+{
+  return size >= sizeof(Magic) &&
+         std::memcmp(data, Magic, sizeof(Magic)) == 0;
+}
+
+
+QByteArray
+FlowBinaryFormat::
+write(FlowSnapshot const & snapshot)
+{
+  // Gather the strings first, the table precedes everything using it.
+  std::vector<QString>          strings;
+  QHash<QString, std::uint32_t> stringIndex;
+
+  auto intern = [&](QString const & s)
+  {
+    auto it = stringIndex.find(s);
+    if (it != stringIndex.end())
+      return it.value();
+
+    auto const index = static_cast<std::uint32_t>(strings.size());
+    stringIndex.insert(s, index);
+    strings.push_back(s);
+
+    return index;
+  };
+
+  std::vector<std::uint32_t> modelNames;
+  std::vector<std::pair<quint64, quint64>> modelRanges;
+  QByteArray models;
+
+  modelNames.reserve(snapshot.nodes.size());
+  modelRanges.reserve(snapshot.nodes.size());
+
+  for (FlowSnapshot::NodeRecord const & node : snapshot.nodes)
+  {
+    QJsonObject state = node.model;
+    modelNames.push_back(intern(state.take("name").toString()));
+
+    QByteArray const json = QJsonDocument(state).toJson(QJsonDocument::Compact);
+    modelRanges.emplace_back(models.size(), json.size());
+    models.append(json);
+  }
+
+  std::vector<std::array<std::uint32_t, 4>> converterTypes;
+  converterTypes.reserve(snapshot.connections.size());
+
+  for (FlowSnapshot::ConnectionRecord const & connection : snapshot.connections)
+  {
+    if (connection.hasConverter)
+    {
+      converterTypes.push_back({ intern(connection.inType.id),
+                                 intern(connection.inType.name),
+                                 intern(connection.outType.id),
+                                 intern(connection.outType.name) });
+    }
+    else
+    {
+      converterTypes.push_back({ NoString, NoString, NoString, NoString });
+    }
+  }
+
+  Writer writer;
+
+  writer.data().reserve(static_cast<int>(HeaderSize +
+                                         snapshot.nodes.size() * NodeRecordSize +
+                                         snapshot.connections.size() * ConnectionRecordSize) +
+                        models.size());
+
+  writer.putBytes(Magic, sizeof(Magic));
+  writer.put<std::uint16_t>(MajorVersion);
+  writer.put<std::uint16_t>(MinorVersion);
+  writer.put<std::uint32_t>(0);
+
+  {
+    FlowHeader const header = snapshot.summary();
+
+    int const chunk = writer.beginChunk("HEAD");
+
+    writer.put(header.nodeCount);
+    writer.put(header.connectionCount);
+
+    writer.putDouble(header.bounds.x());
+    writer.putDouble(header.bounds.y());
+    writer.putDouble(header.bounds.width());
+    writer.putDouble(header.bounds.height());
+
+    writer.put(static_cast<quint64>(header.thumbnail.size()));
+    writer.putBytes(header.thumbnail.constData(), header.thumbnail.size());
+
+    writer.endChunk(chunk);
+  }
+
+  {
+    int const chunk = writer.beginChunk("STRS");
+
+    std::vector<QByteArray> utf8;
+    utf8.reserve(strings.size());
+    for (QString const & s : strings)
+      utf8.push_back(s.toUtf8());
+
+    writer.put(static_cast<std::uint32_t>(utf8.size()));
+
+    std::uint32_t offset = 0;
+    for (QByteArray const & s : utf8)
+    {
+      writer.put(offset);
+      writer.put(static_cast<std::uint32_t>(s.size()));
+      offset += static_cast<std::uint32_t>(s.size());
+    }
+
+    for (QByteArray const & s : utf8)
+      writer.putBytes(s.constData(), s.size());
+
+    writer.endChunk(chunk);
+  }
+
+  if (!snapshot.blobs.empty())
+  {
+    int const chunk = writer.beginChunk("BLOB");
+
+    writer.put(static_cast<std::uint32_t>(snapshot.blobs.size()));
+    writer.put<std::uint32_t>(0);
+
+    quint64 offset = 0;
+
+    for (FlowSnapshot::BlobRecord const & blob : snapshot.blobs)
+    {
+      QByteArray const id = QByteArray::fromHex(blob.id.toLatin1());
+
+      if (blob.id.size() != 2 * BlobIdSize || id.size() != BlobIdSize)
+        throw std::logic_error("Blob id is not a SHA-256 digest");
+
+      writer.putBytes(id.constData(), id.size());
+
+      writer.put(blob.compressed ? BlobCompressed : std::uint32_t(0));
+      writer.put<std::uint32_t>(0);
+
+      writer.put(blob.size);
+      writer.put(offset);
+      writer.put(static_cast<quint64>(blob.data.size()));
+
+      offset += static_cast<quint64>(blob.data.size());
+    }
+
+    for (FlowSnapshot::BlobRecord const & blob : snapshot.blobs)
+      writer.putBytes(blob.data.constData(), blob.data.size());
+
+    writer.endChunk(chunk);
+  }
+
+  {
+    int const chunk = writer.beginChunk("NODE");
+
+    writer.put(static_cast<std::uint32_t>(snapshot.nodes.size()));
+    writer.put<std::uint32_t>(0);
+
+    for (std::size_t i = 0; i < snapshot.nodes.size(); ++i)
+    {
+      FlowSnapshot::NodeRecord const & node = snapshot.nodes[i];
+
+      QByteArray const uuid = node.id.toRfc4122();
+      writer.putBytes(uuid.constData(), 16);
+
+      writer.put(modelNames[i]);
+      writer.put<std::uint32_t>(0);
+
+      writer.putDouble(node.position.x());
+      writer.putDouble(node.position.y());
+
+      writer.put(modelRanges[i].first);
+      writer.put(modelRanges[i].second);
+    }
+
+    writer.endChunk(chunk);
+  }
+
+  {
+    int const chunk = writer.beginChunk("MODL");
+    writer.putBytes(models.constData(), models.size());
+    writer.endChunk(chunk);
+  }
+
+  std::uint32_t pointCount = 0;
+
+  {
+    int const chunk = writer.beginChunk("CONN");
+
+    writer.put(static_cast<std::uint32_t>(snapshot.connections.size()));
+    writer.put<std::uint32_t>(0);
+
+    for (std::size_t i = 0; i < snapshot.connections.size(); ++i)
+    {
+      FlowSnapshot::ConnectionRecord const & connection = snapshot.connections[i];
+
+      writer.put(static_cast<std::uint32_t>(connection.outNode));
+      writer.put(static_cast<std::int32_t>(connection.outPort));
+      writer.put(static_cast<std::uint32_t>(connection.inNode));
+      writer.put(static_cast<std::int32_t>(connection.inPort));
+
+      writer.put(pointCount);
+      writer.put(static_cast<std::uint32_t>(connection.turningPoints.size()));
+      pointCount += static_cast<std::uint32_t>(connection.turningPoints.size());
+
+      for (std::uint32_t type : converterTypes[i])
+        writer.put(type);
+    }
+
+    writer.endChunk(chunk);
+  }
+
+  {
+    int const chunk = writer.beginChunk("PNTS");
+
+    writer.put(static_cast<quint64>(pointCount));
+
+    for (FlowSnapshot::ConnectionRecord const & connection : snapshot.connections)
+    {
+      for (QPointF const & p : connection.turningPoints)
+      {
+        writer.putDouble(p.x());
+        writer.putDouble(p.y());
+      }
+    }
+
+    writer.endChunk(chunk);
+  }
+
+  {
+    std::vector<QByteArray>    ids;
+    std::vector<QPointF>       positions;
+    std::vector<std::uint32_t> inNodes;
+
+    ids.reserve(snapshot.nodes.size());
+    positions.reserve(snapshot.nodes.size());
+    inNodes.reserve(snapshot.connections.size());
+
+    for (FlowSnapshot::NodeRecord const & node : snapshot.nodes)
+    {
+      ids.push_back(node.id.toRfc4122());
+      positions.push_back(node.position);
+    }
+
+    for (FlowSnapshot::ConnectionRecord const & connection : snapshot.connections)
+      inNodes.push_back(static_cast<std::uint32_t>(connection.inNode));
+
+    QByteArray const index = buildIndex(ids, positions, inNodes);
+
+    int const chunk = writer.beginChunk("INDX");
+    writer.putBytes(index.constData(), index.size());
+    writer.endChunk(chunk);
+  }
+
+  return std::move(writer.data());
+}
+
+
+FlowSnapshot
+FlowBinaryFormat::
+read(char const* data, std::size_t size)
+{
+  Layout const layout = parseChunks(data, size);
+  Decoder const decoder(layout);
+
+  FlowSnapshot snapshot;
+
+  if (layout.head.data)
+    snapshot.header = decodeHeader(layout.head.data, layout.head.size);
+
+  snapshot.blobs.reserve(decoder.blobCount());
+
+  for (std::uint32_t i = 0; i < decoder.blobCount(); ++i)
+    snapshot.blobs.push_back(decoder.blob(i));
+
+  snapshot.nodes.reserve(decoder.nodeCount());
+
+  for (std::uint32_t i = 0; i < decoder.nodeCount(); ++i)
+    snapshot.nodes.push_back(decoder.node(i));
+
+  snapshot.connections.reserve(decoder.connectionCount());
+
+  for (std::uint32_t i = 0; i < decoder.connectionCount(); ++i)
+    snapshot.connections.push_back(decoder.connection(i));
+
+  return snapshot;
+}
+
+
+bool
+FlowBinaryFormat::
+readHeader(QIODevice & device, FlowHeader & header)
+{
+  QByteArray const start = device.read(HeaderSize + ChunkHeaderSize);
+
+  if (!isBinary(start.constData(), start.size()))
+    return false;
+
+  if (static_cast<std::size_t>(start.size()) < HeaderSize + ChunkHeaderSize)
+    throw std::logic_error("Truncated binary flow");
+
+  if (qFromLittleEndian<std::uint16_t>(reinterpret_cast<uchar const*>(start.constData() + 8)) !=
+      MajorVersion)
+    throw std::logic_error("Unsupported binary flow version");
+
+  // written first, if at all
+  if (std::memcmp(start.constData() + HeaderSize, "HEAD", 4) != 0)
+    return false;
+
+  quint64 const payloadSize = readU64(start.constData() + HeaderSize + 8);
+
+  if (payloadSize < SummarySize ||
+      payloadSize > static_cast<quint64>(device.bytesAvailable()))
+    throw std::logic_error("Truncated binary flow");
+
+  QByteArray const payload = device.read(static_cast<qint64>(payloadSize));
+
+  header = decodeHeader(payload.constData(), static_cast<std::size_t>(payload.size()));
+
+  return true;
+}
+
+
+FlowSnapshot
+FlowBinaryFormat::
+readRegion(char const* data, std::size_t size, QRectF const & region)
+{
+  Layout const layout = parseChunks(data, size);
+  Decoder const decoder(layout);
+
+  Index const index(layout, decoder);
+
+  QRectF const bounds = region.normalized();
+
+  std::vector<std::uint32_t> nodes;
+  std::unordered_set<std::uint32_t> selected;
+
+  index.forEachNear(bounds, [&](std::uint32_t node)
+  {
+    if (bounds.contains(decoder.position(node)))
+    {
+      nodes.push_back(node);
+      selected.insert(node);
+    }
+  });
+
+  std::vector<std::uint32_t> connections;
+
+  for (std::uint32_t node : nodes)
+  {
+    index.forEachIncoming(node, [&](std::uint32_t connection)
+    {
+      if (selected.count(decoder.outNode(connection)) != 0)
+        connections.push_back(connection);
+    });
+  }
+
+  return extract(decoder, std::move(nodes), std::move(connections));
+}
+
+
+FlowSnapshot
+FlowBinaryFormat::
+readUpstream(char const* data, std::size_t size, std::vector<QUuid> const & ids)
+{
+  Layout const layout = parseChunks(data, size);
+  Decoder const decoder(layout);
+
+  Index const index(layout, decoder);
+
+  std::vector<std::uint32_t> nodes;
+  std::unordered_set<std::uint32_t> visited;
+
+  for (QUuid const & id : ids)
+  {
+    std::uint32_t const node = index.find(id);
+
+    if (node != NoNode && visited.insert(node).second)
+      nodes.push_back(node);
+  }
+
+  // every connection into the closure starts within it
+  std::vector<std::uint32_t> connections;
+
+  for (std::size_t next = 0; next < nodes.size(); ++next)
+  {
+    index.forEachIncoming(nodes[next], [&](std::uint32_t connection)
+    {
+      connections.push_back(connection);
+
+      std::uint32_t const source = decoder.outNode(connection);
+
+      if (visited.insert(source).second)
+        nodes.push_back(source);
+    });
+  }
+
+  return extract(decoder, std::move(nodes), std::move(connections));
+}
+
+
+QByteArray
+FlowBinaryFormat::
+fromJson(QByteArray const & json)
+{
+  return write(FlowSnapshot::fromJson(QJsonDocument::fromJson(json).object()));
+}
+
+
+QByteArray
+FlowBinaryFormat::
+toJson(char const* data, std::size_t size)
+{
+  return read(data, size).toJson();
+}
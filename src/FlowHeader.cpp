@@ -0,0 +1,73 @@
+#include "FlowHeader.hpp"
+
+#include <QtCore/QBuffer>
+
+using QtNodes::FlowHeader;
+
+QImage
+FlowHeader::
+thumbnailImage() const
+{
+  if (thumbnail.isEmpty())
+    return QImage();
+
+  return QImage::fromData(thumbnail, "PNG");
+}
+
+
+void
+FlowHeader::
+setThumbnail(QImage const & image)
+{
+  thumbnail.clear();
+
+  if (image.isNull())
+    return;
+
+  QBuffer buffer(&thumbnail);
+  buffer.open(QIODevice::WriteOnly);
+
+  image.save(&buffer, "PNG");
+}
+
+
+QJsonObject
+FlowHeader::
+toJson() const
+{
+  QJsonObject headerJson;
+
+  headerJson["nodes"]       = static_cast<double>(nodeCount);
+  headerJson["connections"] = static_cast<double>(connectionCount);
+
+  QJsonObject boundsJson;
+  boundsJson["x"]      = bounds.x();
+  boundsJson["y"]      = bounds.y();
+  boundsJson["width"]  = bounds.width();
+  boundsJson["height"] = bounds.height();
+  headerJson["bounds"] = boundsJson;
+
+  if (!thumbnail.isEmpty())
+    headerJson["thumbnail"] = QString::fromLatin1(thumbnail.toBase64());
+
+  return headerJson;
+}
+
+
+FlowHeader
+FlowHeader::
+fromJson(QJsonObject const & headerJson)
+{
+  QJsonObject const boundsJson = headerJson["bounds"].toObject();
+
+  FlowHeader header;
+  header.nodeCount       = static_cast<quint64>(headerJson["nodes"].toDouble());
+  header.connectionCount = static_cast<quint64>(headerJson["connections"].toDouble());
+  header.bounds          = QRectF(boundsJson["x"].toDouble(),
+                                  boundsJson["y"].toDouble(),
+                                  boundsJson["width"].toDouble(),
+                                  boundsJson["height"].toDouble());
+  header.thumbnail = QByteArray::fromBase64(headerJson["thumbnail"].toString().toLatin1());
+
+  return header;
+}
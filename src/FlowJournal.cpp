@@ -0,0 +1,524 @@
+#include "FlowJournal.hpp"
+
+#include <QtCore/QDebug>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QSaveFile>
+#include <QtCore/QTimer>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "BlobStore.hpp"
+#include "Connection.hpp"
+#include "FlowScene.hpp"
+#include "FlowSnapshot.hpp"
+#include "Node.hpp"
+#include "NodeDataModel.hpp"
+#include "NodeState.hpp"
+
+using QtNodes::Connection;
+using QtNodes::FlowJournal;
+using QtNodes::FlowScene;
+using QtNodes::FlowSnapshot;
+using QtNodes::Node;
+using QtNodes::NodeDataModel;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+
+namespace
+{
+
+using NodesById = std::unordered_map<QUuid, Node*>;
+
+Node*
+findNode(NodesById const & nodes, QJsonValue const & id)
+{
+  auto it = nodes.find(QUuid(id.toString()));
+
+  return it != nodes.end() ? it->second : nullptr;
+}
+
+
+QJsonObject
+connectionEnds(Connection const & connection)
+{
+  QJsonObject ends;
+
+  ends["in_id"]     = connection.getNode(PortType::In)->id().toString();
+  ends["in_index"]  = connection.getPortIndex(PortType::In);
+  ends["out_id"]    = connection.getNode(PortType::Out)->id().toString();
+  ends["out_index"] = connection.getPortIndex(PortType::Out);
+
+  return ends;
+}
+
+
+// Connection between the ends named in `record`, or nullptr.
+Connection*
+findConnection(NodesById const & nodes, QJsonObject const & record)
+{
+  Node* in  = findNode(nodes, record["in_id"]);
+  Node* out = findNode(nodes, record["out_id"]);
+
+  PortIndex const inIndex  = record["in_index"].toInt();
+  PortIndex const outIndex = record["out_index"].toInt();
+
+  if (!in || !out || inIndex < 0 ||
+      static_cast<unsigned int>(inIndex) >= in->nodeDataModel()->nPorts(PortType::In))
+    return nullptr;
+
+  for (Connection* connection : in->nodeState().connections(PortType::In, inIndex))
+  {
+    if (connection->getNode(PortType::Out) == out &&
+        connection->getPortIndex(PortType::Out) == outIndex)
+      return connection;
+  }
+
+  return nullptr;
+}
+
+
+void
+replay(FlowScene & scene, NodesById & nodes, QJsonObject const & record)
+{
+  QString const op = record["op"].toString();
+
+  if (op == QLatin1String("create"))
+  {
+    QJsonObject const nodeJson = record["node"].toObject();
+    QUuid const id(nodeJson["id"].toString());
+
+    if (nodes.find(id) == nodes.end())
+      nodes[id] = &scene.restoreNode(nodeJson);
+  }
+  else if (op == QLatin1String("blob"))
+  {
+    auto const blob = FlowSnapshot::BlobRecord::fromJson(record["blob"].toObject());
+
+    if (!scene.blobStore().insert(blob))
+      qWarning() << "Skipped a blob not matching its id:" << blob.id;
+  }
+  else if (op == QLatin1String("remove"))
+  {
+    auto it = nodes.find(QUuid(record["id"].toString()));
+
+    if (it != nodes.end())
+    {
+      scene.removeNode(*it->second);
+      nodes.erase(it);
+    }
+  }
+  else if (op == QLatin1String("move"))
+  {
+    if (Node* node = findNode(nodes, record["id"]))
+      scene.setNodePosition(*node, QPointF(record["x"].toDouble(),
+                                           record["y"].toDouble()));
+  }
+  else if (op == QLatin1String("connect"))
+  {
+    QJsonObject const connectionJson = record["connection"].toObject();
+
+    // ends that were removed later on are skipped along with the connection
+    if (findNode(nodes, connectionJson["in_id"]) &&
+        findNode(nodes, connectionJson["out_id"]) &&
+        !findConnection(nodes, connectionJson))
+      scene.restoreConnection(connectionJson);
+  }
+  else if (op == QLatin1String("disconnect"))
+  {
+    if (Connection* connection = findConnection(nodes, record))
+      scene.deleteConnection(*connection);
+  }
+  else if (op == QLatin1String("model"))
+  {
+    if (Node* node = findNode(nodes, record["id"]))
+    {
+      NodeDataModel* model = node->nodeDataModel();
+
+      QJsonObject modelJson = model->save();
+
+      QJsonObject const set = record["set"].toObject();
+      for (auto it = set.begin(); it != set.end(); ++it)
+        modelJson[it.key()] = it.value();
+
+      for (QJsonValue const & key : record["unset"].toArray())
+        modelJson.remove(key.toString());
+
+      model->restore(modelJson);
+    }
+  }
+
+  // Records of unknown kinds come from newer versions and are skipped.
+}
+
+}
+
+
+FlowJournal::
+FlowJournal(FlowScene & scene, QObject * parent)
+  : QObject(parent)
+  , _scene(scene)
+{}
+
+
+FlowJournal::
+~FlowJournal()
+{
+  close();
+}
+
+
+bool
+FlowJournal::
+open(QString const & snapshotFile, QString const & journalFile)
+{
+  close();
+
+  _snapshotFileName = snapshotFile;
+  _journal.setFileName(journalFile);
+
+  if (!_journal.open(QIODevice::WriteOnly | QIODevice::Append))
+    return false;
+
+  if (!compact())
+  {
+    _journal.close();
+    return false;
+  }
+
+  connect(&_scene, &FlowScene::nodeCreated, this, &FlowJournal::recordCreated);
+  connect(&_scene, &FlowScene::nodeDeleted, this, &FlowJournal::recordRemoved);
+  connect(&_scene, &FlowScene::nodeMoved, this, &FlowJournal::recordMoved);
+
+  connect(&_scene, &FlowScene::connectionCreated,
+          this, &FlowJournal::recordConnected);
+  connect(&_scene, &FlowScene::connectionDeleted,
+          this, &FlowJournal::recordDisconnected);
+
+  connect(&_scene, &FlowScene::aboutToBeDestroyed, this, &FlowJournal::close);
+
+  for (auto const & node : _scene.nodes())
+    watchModel(*node);
+
+  return true;
+}
+
+
+void
+FlowJournal::
+close()
+{
+  if (!isOpen())
+    return;
+
+  disconnect(&_scene, nullptr, this, nullptr);
+
+  for (auto const & node : _scene.nodes())
+    disconnect(node->nodeDataModel(), nullptr, this, nullptr);
+
+  _journal.close();
+
+  _models.clear();
+  _dirty.clear();
+  _blobs.clear();
+}
+
+
+bool
+FlowJournal::
+compact()
+{
+  if (!isOpen())
+    return false;
+
+  FlowSnapshot const snapshot = _scene.snapshot();
+
+  QSaveFile file(_snapshotFileName);
+
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+
+  snapshot.writeJson(file);
+  _snapshotSize = file.size();
+
+  if (!file.commit() || !_journal.resize(0))
+    return false;
+
+  _models.clear();
+  _models.reserve(snapshot.nodes.size());
+
+  for (FlowSnapshot::NodeRecord const & node : snapshot.nodes)
+    _models[node.id] = node.model;
+
+  _dirty.clear();
+
+  _blobs.clear();
+
+  for (FlowSnapshot::BlobRecord const & blob : snapshot.blobs)
+    _blobs.insert(blob.id);
+
+  // the snapshot on disk holds every blob the models can refer to again
+  _scene.collectBlobs();
+
+  return true;
+}
+
+
+void
+FlowJournal::
+recordModel(Node & node)
+{
+  auto last = _models.find(node.id());
+
+  if (!isOpen() || last == _models.end())
+    return;
+
+  QJsonObject const current = node.nodeDataModel()->save();
+
+  QJsonObject set;
+  QJsonArray  unset;
+
+  for (auto it = current.begin(); it != current.end(); ++it)
+  {
+    if (last->second.value(it.key()) != it.value())
+      set[it.key()] = it.value();
+  }
+
+  for (auto it = last->second.begin(); it != last->second.end(); ++it)
+  {
+    if (!current.contains(it.key()))
+      unset.append(it.key());
+  }
+
+  if (set.isEmpty() && unset.isEmpty())
+    return;
+
+  last->second = current;
+
+  recordBlobs(set);
+
+  QJsonObject record;
+  record["op"] = QStringLiteral("model");
+  record["id"] = node.id().toString();
+
+  if (!set.isEmpty())
+    record["set"] = set;
+
+  if (!unset.isEmpty())
+    record["unset"] = unset;
+
+  append(record);
+}
+
+
+bool
+FlowJournal::
+recover(FlowScene & scene,
+        QString const & snapshotFile,
+        QString const & journalFile)
+{
+  if (!scene.loadFromFile(snapshotFile))
+    return false;
+
+  QFile journal(journalFile);
+
+  // nothing was recorded after the snapshot
+  if (!journal.open(QIODevice::ReadOnly))
+    return true;
+
+  NodesById nodes;
+  nodes.reserve(scene.nodes().size());
+
+  for (auto const & node : scene.nodes())
+    nodes[node->id()] = node.get();
+
+  while (!journal.atEnd())
+  {
+    QByteArray const line = journal.readLine();
+
+    QJsonParseError error;
+    QJsonDocument const document = QJsonDocument::fromJson(line, &error);
+
+    if (error.error != QJsonParseError::NoError || !document.isObject())
+    {
+      // the write of the last record was cut short
+      if (!line.endsWith('\n') && journal.atEnd())
+        break;
+
+      throw std::logic_error("Malformed record in flow journal");
+    }
+
+    replay(scene, nodes, document.object());
+  }
+
+  return true;
+}
+
+
+void
+FlowJournal::
+flush()
+{
+  _flushPending = false;
+
+  if (!isOpen())
+    return;
+
+  std::unordered_set<QUuid> dirty;
+  dirty.swap(_dirty);
+
+  for (QUuid const & id : dirty)
+  {
+    if (Node* node = _scene.findNode(id))
+      recordModel(*node);
+  }
+
+  // Compaction rewrites the whole scene; waiting for the journal to outgrow
+  // the snapshot keeps its cost proportional to the edits recorded.
+  if (_journal.size() > std::max(_compactionThreshold, _snapshotSize))
+    compact();
+}
+
+
+void
+FlowJournal::
+append(QJsonObject const & record)
+{
+  QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+  line.append('\n');
+
+  _journal.write(line);
+
+  // hand the record to the system right away, a crash loses nothing after
+  _journal.flush();
+
+  if (_journal.size() > std::max(_compactionThreshold, _snapshotSize))
+    scheduleFlush();
+}
+
+
+void
+FlowJournal::
+recordBlobs(QJsonObject const & modelJson)
+{
+  FlowSnapshot::NodeRecord node;
+  node.model = modelJson;
+
+  for (FlowSnapshot::BlobRecord const & blob : _scene.blobStore().records({ node }))
+  {
+    if (!_blobs.insert(blob.id).second)
+      continue;
+
+    QJsonObject record;
+    record["op"]   = QStringLiteral("blob");
+    record["blob"] = blob.toJson();
+
+    append(record);
+  }
+}
+
+
+void
+FlowJournal::
+recordCreated(Node & node)
+{
+  QJsonObject const nodeJson = node.save();
+
+  _models[node.id()] = nodeJson["model"].toObject();
+
+  watchModel(node);
+
+  recordBlobs(nodeJson["model"].toObject());
+
+  QJsonObject record;
+  record["op"]   = QStringLiteral("create");
+  record["node"] = nodeJson;
+
+  append(record);
+}
+
+
+void
+FlowJournal::
+recordRemoved(Node & node)
+{
+  _models.erase(node.id());
+  _dirty.erase(node.id());
+
+  QJsonObject record;
+  record["op"] = QStringLiteral("remove");
+  record["id"] = node.id().toString();
+
+  append(record);
+}
+
+
+void
+FlowJournal::
+recordMoved(Node & node, QPointF const & position)
+{
+  QJsonObject record;
+  record["op"] = QStringLiteral("move");
+  record["id"] = node.id().toString();
+  record["x"]  = position.x();
+  record["y"]  = position.y();
+
+  append(record);
+}
+
+
+void
+FlowJournal::
+recordConnected(Connection const & connection)
+{
+  QJsonObject record;
+  record["op"]         = QStringLiteral("connect");
+  record["connection"] = connection.save();
+
+  append(record);
+}
+
+
+void
+FlowJournal::
+recordDisconnected(Connection const & connection)
+{
+  // replaying the removal of a node drops its connections as well
+  if (connection.getNode(PortType::In)->isDoomed() ||
+      connection.getNode(PortType::Out)->isDoomed())
+    return;
+
+  QJsonObject record = connectionEnds(connection);
+  record["op"] = QStringLiteral("disconnect");
+
+  append(record);
+}
+
+
+void
+FlowJournal::
+watchModel(Node & node)
+{
+  QUuid const id = node.id();
+
+  connect(node.nodeDataModel(), &NodeDataModel::dataUpdated,
+          this, [this, id]
+  {
+    _dirty.insert(id);
+    scheduleFlush();
+  });
+}
+
+
+void
+FlowJournal::
+scheduleFlush()
+{
+  if (_flushPending)
+    return;
+
+  _flushPending = true;
+
+  QTimer::singleShot(0, this, SLOT(flush()));
+}
@@ -0,0 +1,391 @@
+#include "FlowLoader.hpp"
+
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QTimer>
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+#include "BlobStore.hpp"
+#include "DataModelRegistry.hpp"
+#include "FlowBinaryFormat.hpp"
+#include "FlowScene.hpp"
+#include "Node.hpp"
+#include "NodeDataModel.hpp"
+
+using QtNodes::BlobStore;
+using QtNodes::FlowLoader;
+using QtNodes::FlowBinaryFormat;
+using QtNodes::FlowScene;
+using QtNodes::FlowSnapshot;
+using QtNodes::GraphItems;
+using QtNodes::Node;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+using QtNodes::TypeConverter;
+
+namespace
+{
+
+// Nodes handed to FlowScene::createGraph() between two clock checks.
+std::size_t const NodeBatch = 16;
+
+// Parsed bytes between two parsingProgress() signals.
+qint64 const ProgressStep = 1 << 20;
+
+bool
+hasPort(Node const & node, PortType portType, PortIndex port)
+{
+  return port >= 0 &&
+         static_cast<unsigned int>(port) < node.nodeDataModel()->nPorts(portType);
+}
+
+}
+
+
+FlowLoader::
+FlowLoader(FlowScene & scene, QObject * parent)
+  : QObject(parent)
+  , _scene(scene)
+{}
+
+
+FlowLoader::
+~FlowLoader()
+{
+  _cancelRequested = true;
+
+  // Results posted by the worker are dropped along with this object.
+  if (_worker.joinable())
+    _worker.join();
+}
+
+
+bool
+FlowLoader::
+start(QString const & fileName)
+{
+  if (_running)
+    return false;
+
+  _running         = true;
+  _cancelRequested = false;
+  _bytesRead       = 0;
+  _bytesTotal      = 0;
+
+  _snapshot    = FlowSnapshot();
+  _parseFailed = false;
+  _error.clear();
+
+  _nextNode       = 0;
+  _nextConnection = 0;
+
+  _worker = std::thread([this, fileName] { parse(fileName); });
+
+  return true;
+}
+
+
+void
+FlowLoader::
+cancel()
+{
+  if (_running)
+    _cancelRequested = true;
+}
+
+
+void
+FlowLoader::
+parse(QString const & fileName)
+{
+  try
+  {
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly))
+      throw std::logic_error("Cannot open " + fileName.toStdString());
+
+    _bytesTotal = file.size();
+
+    QByteArray const head = file.peek(8);
+
+    if (FlowBinaryFormat::isBinary(head.constData(), head.size()))
+    {
+      if (uchar* mapped = file.map(0, file.size()))
+      {
+        _snapshot = FlowBinaryFormat::read(reinterpret_cast<char const*>(mapped),
+                                           static_cast<std::size_t>(file.size()));
+      }
+      else
+      {
+        QByteArray const data = file.readAll();
+
+        _snapshot = FlowBinaryFormat::read(data.constData(),
+                                           static_cast<std::size_t>(data.size()));
+      }
+
+      _bytesRead = _bytesTotal.load();
+    }
+    else
+    {
+      qint64 reported = 0;
+
+      _snapshot = FlowSnapshot::readJson(file, [&]
+      {
+        _bytesRead = file.pos();
+
+        if (_bytesRead - reported >= ProgressStep)
+        {
+          reported = _bytesRead;
+          QMetaObject::invokeMethod(this, "onParsingProgress", Qt::QueuedConnection);
+        }
+
+        return !_cancelRequested;
+      });
+    }
+  }
+  catch (std::exception const & e)
+  {
+    _parseFailed = true;
+    _error       = QString::fromLocal8Bit(e.what());
+  }
+
+  QMetaObject::invokeMethod(this, "onParsed", Qt::QueuedConnection);
+}
+
+
+void
+FlowLoader::
+onParsingProgress()
+{
+  Q_EMIT parsingProgress(_bytesRead, _bytesTotal);
+}
+
+
+void
+FlowLoader::
+onParsed()
+{
+  // the worker has nothing left to do but return
+  _worker.join();
+
+  if (_cancelRequested)
+  {
+    rollBack();
+    Q_EMIT cancelled();
+    return;
+  }
+
+  if (_parseFailed)
+  {
+    rollBack();
+    Q_EMIT failed(_error);
+    return;
+  }
+
+  Q_EMIT parsingProgress(_bytesTotal, _bytesTotal);
+
+  _blobIndex.reserve(_snapshot.blobs.size());
+
+  for (std::size_t i = 0; i < _snapshot.blobs.size(); ++i)
+    _blobIndex[_snapshot.blobs[i].id] = i;
+
+  _built.reserve(_snapshot.nodes.size());
+  _builtIndex.reserve(_snapshot.nodes.size());
+
+  _nodeDeletedConnection =
+    connect(&_scene, &FlowScene::nodeDeleted,
+            this, [this](Node & node) { onNodeDeleted(node); });
+
+  buildSlice();
+}
+
+
+void
+FlowLoader::
+buildSlice()
+{
+  if (_cancelRequested)
+  {
+    rollBack();
+    Q_EMIT cancelled();
+    return;
+  }
+
+  int const total = static_cast<int>(_snapshot.nodes.size() +
+                                     _snapshot.connections.size());
+
+  QElapsedTimer clock;
+  clock.start();
+
+  try
+  {
+    do
+    {
+      if (_nextNode < _snapshot.nodes.size())
+      {
+        buildNodes(NodeBatch);
+      }
+      else if (_nextConnection < _snapshot.connections.size())
+      {
+        buildConnection(_snapshot.connections[_nextConnection++]);
+      }
+      else
+      {
+        stop();
+
+        Q_EMIT buildingProgress(total, total);
+        Q_EMIT _scene.sceneLoadFromMemoryCompleted(true);
+        Q_EMIT finished();
+        return;
+      }
+    }
+    while (!clock.hasExpired(_sliceBudget));
+  }
+  catch (std::exception const & e)
+  {
+    rollBack();
+    Q_EMIT failed(QString::fromLocal8Bit(e.what()));
+    return;
+  }
+
+  Q_EMIT buildingProgress(static_cast<int>(_nextNode + _nextConnection), total);
+
+  // leave the rest of this turn to input and painting
+  QTimer::singleShot(0, this, &FlowLoader::buildSlice);
+}
+
+
+void
+FlowLoader::
+buildNodes(std::size_t count)
+{
+  std::size_t const end = std::min(_nextNode + count, _snapshot.nodes.size());
+
+  FlowSnapshot batch;
+  batch.nodes.assign(_snapshot.nodes.begin() + _nextNode,
+                     _snapshot.nodes.begin() + end);
+
+  // The blobs go in with the nodes referring to them, as collectBlobs()
+  // between two slices drops the blobs no node in the scene refers to.
+  std::vector<QString> ids;
+
+  for (FlowSnapshot::NodeRecord const & record : batch.nodes)
+    BlobStore::collectReferences(record.model, ids);
+
+  for (QString const & id : ids)
+  {
+    auto it = _blobIndex.find(id);
+
+    if (it != _blobIndex.end() && !_scene.blobStore().contains(id))
+      batch.blobs.push_back(_snapshot.blobs[it->second]);
+  }
+
+  GraphItems const items = _scene.restoreSnapshot(batch);
+
+  for (Node* node : items.nodes)
+  {
+    _builtIndex[node] = _built.size();
+    _built.push_back(node);
+  }
+
+  _nextNode = end;
+}
+
+
+void
+FlowLoader::
+buildConnection(FlowSnapshot::ConnectionRecord const & record)
+{
+  Node* nodeIn  = _built[record.inNode];
+  Node* nodeOut = _built[record.outNode];
+
+  // one of the ends was deleted while loading
+  if (!nodeIn || !nodeOut)
+    return;
+
+  if (!hasPort(*nodeOut, PortType::Out, record.outPort) ||
+      !hasPort(*nodeIn, PortType::In, record.inPort))
+    throw std::logic_error("Connection refers to a port missing from its node");
+
+  // Files written before cycles were refused may contain some; the
+  // connections closing them are left out rather than failing the load.
+  if (_scene.wouldCreateCycle(*nodeOut, *nodeIn))
+  {
+    qWarning() << "Skipped a connection closing a cycle:"
+               << nodeOut->id() << "->" << nodeIn->id();
+    return;
+  }
+
+  TypeConverter converter;
+
+  if (record.hasConverter)
+    converter = _scene.registry().getTypeConverter(record.outType, record.inType);
+
+  if (record.turningPoints.isEmpty())
+  {
+    _scene.createConnection(*nodeIn, record.inPort,
+                            *nodeOut, record.outPort,
+                            converter);
+  }
+  else
+  {
+    _scene.createConnection(*nodeIn, record.inPort,
+                            *nodeOut, record.outPort,
+                            record.turningPoints,
+                            converter);
+  }
+}
+
+
+void
+FlowLoader::
+onNodeDeleted(Node & node)
+{
+  auto it = _builtIndex.find(&node);
+
+  if (it == _builtIndex.end())
+    return;
+
+  _built[it->second] = nullptr;
+  _builtIndex.erase(it);
+}
+
+
+void
+FlowLoader::
+rollBack()
+{
+  std::vector<Node*> built;
+  built.reserve(_builtIndex.size());
+
+  for (Node* node : _built)
+  {
+    if (node)
+      built.push_back(node);
+  }
+
+  stop();
+
+  _scene.removeNodes(built);
+}
+
+
+void
+FlowLoader::
+stop()
+{
+  disconnect(_nodeDeletedConnection);
+
+  _running         = false;
+  _cancelRequested = false;
+
+  _snapshot = FlowSnapshot();
+  _blobIndex.clear();
+  _built.clear();
+  _builtIndex.clear();
+}
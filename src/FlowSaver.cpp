@@ -0,0 +1,126 @@
+#include "FlowSaver.hpp"
+
+#include <QtCore/QSaveFile>
+
+#include <algorithm>
+#include <utility>
+
+#include "FlowBinaryFormat.hpp"
+
+using QtNodes::FlowBinaryFormat;
+using QtNodes::FlowSaver;
+using QtNodes::FlowScene;
+
+FlowSaver::
+FlowSaver(FlowScene const & scene, QObject * parent)
+  : QObject(parent)
+  , _scene(scene)
+{}
+
+
+FlowSaver::
+~FlowSaver()
+{
+  // Saves are finished rather than dropped; the old files would survive,
+  // but the caller asked for the new ones.
+  if (_worker.joinable())
+    _worker.join();
+
+  for (Job & job : _pending)
+    write(job);
+}
+
+
+void
+FlowSaver::
+start(QString const & fileName, FlowScene::FileFormat format)
+{
+  Job job { _scene.snapshot(), fileName, format };
+
+  if (isRunning())
+  {
+    auto sameFile = std::find_if(_pending.begin(), _pending.end(),
+                                 [&](Job const & pending)
+    {
+      return pending.fileName == job.fileName;
+    });
+
+    if (sameFile != _pending.end())
+      *sameFile = std::move(job);
+    else
+      _pending.push_back(std::move(job));
+
+    return;
+  }
+
+  run(std::move(job));
+}
+
+
+void
+FlowSaver::
+run(Job job)
+{
+  _running = std::move(job);
+
+  _worker = std::thread([this]
+  {
+    write(_running);
+    QMetaObject::invokeMethod(this, "onWritten", Qt::QueuedConnection);
+  });
+}
+
+
+void
+FlowSaver::
+write(Job & job)
+{
+  _success = false;
+  _errorString.clear();
+
+  job.snapshot.header.setThumbnail(job.snapshot.renderThumbnail());
+
+  QSaveFile file(job.fileName);
+
+  if (!file.open(QIODevice::WriteOnly))
+  {
+    _errorString = file.errorString();
+    return;
+  }
+
+  if (job.format == FlowScene::FileFormat::Binary)
+    file.write(FlowBinaryFormat::write(job.snapshot));
+  else
+    job.snapshot.writeJson(file);
+
+  // Nothing replaces the target unless every byte was written.
+  if (!file.commit())
+  {
+    _errorString = file.errorString();
+    return;
+  }
+
+  _success = true;
+}
+
+
+void
+FlowSaver::
+onWritten()
+{
+  _worker.join();
+
+  QString const fileName    = _running.fileName;
+  bool const    success     = _success;
+  QString const errorString = _errorString;
+
+  _running = Job();
+
+  if (!_pending.empty())
+  {
+    run(std::move(_pending.front()));
+    _pending.pop_front();
+  }
+
+  Q_EMIT finished(fileName, success, errorString);
+}
@@ -1,7 +1,11 @@
 ﻿#include "FlowScene.hpp"
 
+#include <algorithm>
+#include <set>
 #include <stdexcept>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <QtWidgets/QGraphicsSceneMoveEvent>
 #include <QtWidgets/QFileDialog>
@@ -15,6 +19,7 @@
 #include <QtCore/QJsonArray>
 #include <QtCore/QtGlobal>
 #include <QtCore/QDebug>
+#include <QtCore/QTimer>
 
 #include "Node.hpp"
 #include "NodeGraphicsObject.hpp"
@@ -25,17 +30,175 @@
 #include "Connection.hpp"
 
 #include "FlowView.hpp"
+#include "BlobStore.hpp"
 #include "DataModelRegistry.hpp"
+#include "FlowBinaryFormat.hpp"
+#include "FlowLoader.hpp"
+#include "FlowSaver.hpp"
+#include "JsonRecordReader.hpp"
 
 using QtNodes::FlowScene;
 using QtNodes::Node;
 using QtNodes::NodeGraphicsObject;
 using QtNodes::Connection;
 using QtNodes::DataModelRegistry;
+using QtNodes::BlobStore;
 using QtNodes::NodeDataModel;
+using QtNodes::NodeDataType;
 using QtNodes::PortType;
 using QtNodes::PortIndex;
 using QtNodes::TypeConverter;
+using QtNodes::PoolAllocator;
+using QtNodes::NodeDescriptor;
+using QtNodes::EdgeDescriptor;
+using QtNodes::GraphItems;
+using QtNodes::FlowSnapshot;
+using QtNodes::FlowHeader;
+using QtNodes::FlowBinaryFormat;
+using QtNodes::FlowLoader;
+using QtNodes::FlowSaver;
+using QtNodes::JsonRecordReader;
+using QtNodes::TopologicalOrder;
+
+
+namespace
+{
+
+FlowSnapshot::NodeRecord
+nodeRecord(Node const & node)
+{
+    FlowSnapshot::NodeRecord record;
+    record.id       = node.id();
+    record.model    = node.nodeDataModel()->save();
+    record.position = node.nodeGraphicsObject().pos();
+    record.size     = QSizeF(node.nodeGeometry().width(), node.nodeGeometry().height());
+
+    return record;
+}
+
+
+FlowSnapshot::ConnectionRecord
+connectionRecord(Connection const & connection,
+                 std::size_t outNode,
+                 std::size_t inNode)
+{
+    FlowSnapshot::ConnectionRecord record;
+    record.outNode = outNode;
+    record.outPort = connection.getPortIndex(PortType::Out);
+    record.inNode  = inNode;
+    record.inPort  = connection.getPortIndex(PortType::In);
+
+    record.turningPoints = connection.connectionGeometry().getPoints();
+
+    if (connection.hasTypeConverter())
+    {
+        record.hasConverter = true;
+        record.inType  = connection.dataType(PortType::In);
+        record.outType = connection.dataType(PortType::Out);
+    }
+
+    return record;
+}
+
+
+// Whether `to` can be reached from `from` along `downstream`.
+bool
+reaches(std::vector<std::vector<std::size_t>> const & downstream,
+        std::size_t from,
+        std::size_t to)
+{
+    std::vector<char> visited(downstream.size(), 0);
+    std::vector<std::size_t> stack(1, from);
+
+    while (!stack.empty())
+    {
+        std::size_t const v = stack.back();
+        stack.pop_back();
+
+        if (v == to)
+            return true;
+
+        if (visited[v])
+            continue;
+
+        visited[v] = 1;
+        stack.insert(stack.end(), downstream[v].begin(), downstream[v].end());
+    }
+
+    return false;
+}
+
+
+// Removes the edges that close a cycle, keeping the earlier of the edges
+// involved, and returns how many were removed. Edges referring to missing
+// nodes are kept for createGraph() to refuse.
+std::size_t
+removeCyclicEdges(std::size_t nodeCount, std::vector<EdgeDescriptor> & edges)
+{
+    std::vector<std::vector<std::size_t>> downstream(nodeCount);
+    std::vector<std::size_t> pendingInputs(nodeCount, 0);
+
+    auto valid = [nodeCount](EdgeDescriptor const & edge)
+    {
+        return edge.outNode < nodeCount && edge.inNode < nodeCount;
+    };
+
+    for (EdgeDescriptor const & edge : edges)
+    {
+        if (!valid(edge))
+            continue;
+
+        downstream[edge.outNode].push_back(edge.inNode);
+        ++pendingInputs[edge.inNode];
+    }
+
+    // the common case: the edges are acyclic, which a topological sort
+    // tells in linear time
+    std::vector<std::size_t> order;
+
+    for (std::size_t i = 0; i < nodeCount; ++i)
+    {
+        if (pendingInputs[i] == 0)
+            order.push_back(i);
+    }
+
+    for (std::size_t next = 0; next < order.size(); ++next)
+    {
+        for (std::size_t target : downstream[order[next]])
+        {
+            if (--pendingInputs[target] == 0)
+                order.push_back(target);
+        }
+    }
+
+    if (order.size() == nodeCount)
+        return 0;
+
+    for (auto & targets : downstream)
+        targets.clear();
+
+    auto const kept =
+        std::remove_if(edges.begin(), edges.end(),
+                       [&](EdgeDescriptor const & edge)
+                       {
+                           if (!valid(edge))
+                               return false;
+
+                           if (reaches(downstream, edge.inNode, edge.outNode))
+                               return true;
+
+                           downstream[edge.outNode].push_back(edge.inNode);
+                           return false;
+                       });
+
+    std::size_t const removed = static_cast<std::size_t>(edges.end() - kept);
+
+    edges.erase(kept, edges.end());
+
+    return removed;
+}
+
+}
 
 
 FlowScene::
@@ -43,13 +206,14 @@ FlowScene(std::shared_ptr<DataModelRegistry> registry,
           QObject * parent)
     : QGraphicsScene(parent)
     , _registry(std::move(registry))
+    , _blobs(std::make_shared<BlobStore>())
+    , _reachability(_topology)
 {
     setItemIndexMethod(QGraphicsScene::NoIndex);
 
     // This connection should come first
-    connect(this, &FlowScene::connectionCreated, this, &FlowScene::setupConnectionSignals);
-    connect(this, &FlowScene::connectionCreated, this, &FlowScene::sendConnectionCreatedToNodes);
     connect(this, &FlowScene::connectionDeleted, this, &FlowScene::sendConnectionDeletedToNodes);
+    connect(this, &FlowScene::connectionDeleted, this, &FlowScene::removeConnectionFromTopology);
 }
 
 
@@ -63,6 +227,8 @@ FlowScene(QObject * parent)
 FlowScene::
 ~FlowScene()
 {
+    aboutToBeDestroyed();
+
     clearScene();
 }
 
@@ -76,14 +242,16 @@ createConnection(PortType connectedPort,
                  Node& node,
                  PortIndex portIndex)
 {
-    auto connection = std::make_shared<Connection>(connectedPort, node, portIndex);
+    auto connection = std::allocate_shared<Connection>(PoolAllocator<Connection>(),
+                                                       connectedPort, node, portIndex);
 
     auto cgo = detail::make_unique<ConnectionGraphicsObject>(*this, *connection);
 
     // after this function connection points are set to node port
     connection->setGraphicsObject(std::move(cgo));
+    addItem(&connection->getConnectionGraphicsObject());
 
-    _connections[connection->id()] = connection;
+    connection->setSceneHandle(_connections.insert(connection));
 
     // Note: this connection isn't truly created yet. It's only partially created.
     // Thus, don't send the connectionCreated(...) signal.
@@ -92,7 +260,7 @@ createConnection(PortType connectedPort,
             &Connection::connectionCompleted,
             this,
             [this](Connection const& c) {
-        connectionCreated(c);
+        completeConnection(c);
     });
 
     return connection;
@@ -107,12 +275,16 @@ createConnection(Node& nodeIn,
                  PortIndex portIndexOut,
                  TypeConverter const &converter)
 {
+    if (wouldCreateCycle(nodeOut, nodeIn))
+        throw std::logic_error("Connection would create a cycle");
+
     auto connection =
-            std::make_shared<Connection>(nodeIn,
-                                         portIndexIn,
-                                         nodeOut,
-                                         portIndexOut,
-                                         converter);
+            std::allocate_shared<Connection>(PoolAllocator<Connection>(),
+                                             nodeIn,
+                                             portIndexIn,
+                                             nodeOut,
+                                             portIndexOut,
+                                             converter);
 
     //必须要做下面三步的操作，模拟线段放下的操作，这样会让线段的状态正常可以拖动
     connection->connectionGeometry().setSelected(true);
@@ -126,13 +298,14 @@ createConnection(Node& nodeIn,
 
     // after this function connection points are set to node port
     connection->setGraphicsObject(std::move(cgo));
+    addItem(&connection->getConnectionGraphicsObject());
 
     // trigger data propagation
-    nodeOut.onDataUpdated(portIndexOut);
+    nodeOut.onOutputConnected(portIndexOut);
 
-    _connections[connection->id()] = connection;
+    connection->setSceneHandle(_connections.insert(connection));
 
-    connectionCreated(*connection);
+    completeConnection(*connection);
 
     return connection;
 }
@@ -161,8 +334,11 @@ restoreConnection(QJsonObject const &connectionJson)
     PortIndex portIndexIn  = connectionJson["in_index"].toInt();
     PortIndex portIndexOut = connectionJson["out_index"].toInt();
 
-    auto nodeIn  = _nodes[nodeInId].get();
-    auto nodeOut = _nodes[nodeOutId].get();
+    auto nodeIn  = findNode(nodeInId);
+    auto nodeOut = findNode(nodeOutId);
+
+    if (!nodeIn || !nodeOut)
+        throw std::logic_error("Connection refers to a node missing from the scene");
 
     //解析所有的拐点信息
 
@@ -241,11 +417,11 @@ void
 FlowScene::
 deleteConnection(Connection& connection)
 {
-    auto it = _connections.find(connection.id());
-    if (it != _connections.end())
+    auto stored = _connections.find(connection.sceneHandle());
+    if (stored && stored->get() == &connection)
     {
         connection.removeFromNodes();
-        _connections.erase(it);
+        _connections.erase(connection.sceneHandle());
     }
 }
 
@@ -254,13 +430,21 @@ Node&
 FlowScene::
 createNode(std::unique_ptr<NodeDataModel> && dataModel)
 {
+    dataModel->setBlobStore(_blobs);
+
     auto node = detail::make_unique<Node>(std::move(dataModel));
     auto ngo  = detail::make_unique<NodeGraphicsObject>(*this, *node);
 
     node->setGraphicsObject(std::move(ngo));
+    addItem(&node->nodeGraphicsObject());
+    node->nodeGraphicsObject().updateCacheMode();
 
     auto nodePtr = node.get();
-    _nodes[node->id()] = std::move(node);
+    nodePtr->setSceneHandle(_nodes.insert(std::move(node)));
+    _topology.addVertex(nodePtr->sceneHandle().index);
+    _reachability.vertexAdded(nodePtr->sceneHandle().index);
+
+    indexNode(*nodePtr);
 
     nodeCreated(*nodePtr);
     return *nodePtr;
@@ -279,14 +463,21 @@ restoreNode(QJsonObject const& nodeJson)
         throw std::logic_error(std::string("No registered model with name ") +
                                modelName.toLocal8Bit().data());
 
+    dataModel->setBlobStore(_blobs);
+
     auto node = detail::make_unique<Node>(std::move(dataModel));
     auto ngo  = detail::make_unique<NodeGraphicsObject>(*this, *node);
     node->setGraphicsObject(std::move(ngo));
 
     node->restore(nodeJson);
+    addItem(&node->nodeGraphicsObject());
+    node->nodeGraphicsObject().updateCacheMode();
 
     auto nodePtr = node.get();
-    _nodes[node->id()] = std::move(node);
+    nodePtr->setSceneHandle(_nodes.insert(std::move(node)));
+    indexNode(*nodePtr);
+    _topology.addVertex(nodePtr->sceneHandle().index);
+    _reachability.vertexAdded(nodePtr->sceneHandle().index);
 
     nodePlaced(*nodePtr);
     nodeCreated(*nodePtr);
@@ -298,27 +489,383 @@ void
 FlowScene::
 removeNode(Node& node)
 {
+    removeNodes({ &node });
+}
+
+
+void
+FlowScene::
+removeNodes(std::vector<Node*> const & nodes)
+{
+    if (nodes.empty())
+        return;
+
+    for (Node* node : nodes)
+        node->setDoomed(true);
 
     // call signal
-    nodeDeleted(node);
+    for (Node* node : nodes)
+        nodeDeleted(*node);
 
-    for(auto portType: {PortType::In,PortType::Out})
-    {
-        auto nodeState = node.nodeState();
-        auto const & nodeEntries = nodeState.getEntries(portType);
+    std::vector<Connection*> connections;
 
-        for (auto &connections : nodeEntries)
+    for (Node* node : nodes)
+    {
+        for (auto portType: {PortType::In, PortType::Out})
         {
-            for (auto const &pair : connections)
-                deleteConnection(*pair.second);
+            for (auto const & entries : node->nodeState().getEntries(portType))
+                connections.insert(connections.end(), entries.begin(), entries.end());
         }
     }
 
-    _nodes.erase(node.id());
+    // Connections between two removed nodes are listed twice.
+    std::sort(connections.begin(), connections.end());
+    connections.erase(std::unique(connections.begin(), connections.end()),
+                      connections.end());
+
+    // Drop the connections leading into removed nodes first: they propagate
+    // nothing. Once they are gone, the empty data sent to the remaining
+    // nodes can no longer flow back into the removed ones.
+    auto const intoRemoved =
+            std::stable_partition(connections.begin(), connections.end(),
+                                  [](Connection* c)
+    {
+        Node* in = c->getNode(PortType::In);
+        return !in || in->isDoomed();
+    });
+
+    // Their edges leave the topology with the removed nodes, see
+    // removeConnectionFromTopology(), and the reachability index takes
+    // them in one update.
+    std::vector<std::pair<TopologicalOrder::Vertex, TopologicalOrder::Vertex>> removed;
+
+    for (Connection* c : connections)
+    {
+        Node* from = c->getNode(PortType::Out);
+        Node* to   = c->getNode(PortType::In);
+
+        if (from && to)
+            removed.emplace_back(from->sceneHandle().index, to->sceneHandle().index);
+    }
+
+    std::for_each(connections.begin(), intoRemoved,
+                  [this](Connection* c) { deleteConnection(*c); });
+
+    std::for_each(intoRemoved, connections.end(),
+                  [this](Connection* c) { deleteConnection(*c); });
+
+    for (Node* node : nodes)
+    {
+        auto indexed = _nodeIndex.find(node->id());
+        if (indexed != _nodeIndex.end() && indexed->second == node->sceneHandle())
+            _nodeIndex.erase(indexed);
+
+        if (!node->nodeGraphicsObject().cacheModeCurrent())
+            --_staleCacheModes;
+
+        _topology.removeVertex(node->sceneHandle().index);
+    }
+
+    _reachability.edgesRemoved(removed);
+
+    for (Node* node : nodes)
+    {
+        _reachability.vertexRemoved(node->sceneHandle().index);
+        _nodes.erase(node->sceneHandle());
+    }
 
     // after delete signal
     afterNodeDeleted();
+}
+
+
+bool
+FlowScene::
+wouldCreateCycle(Node const& outNode, Node const& inNode) const
+{
+    return _topology.wouldCreateCycle(outNode.sceneHandle().index,
+                                      inNode.sceneHandle().index);
+}
+
+
+bool
+FlowScene::
+isUpstream(Node const& upstream, Node const& downstream) const
+{
+    return &upstream != &downstream &&
+           _reachability.reaches(upstream.sceneHandle().index,
+                                 downstream.sceneHandle().index);
+}
+
+
+std::vector<Node*>
+FlowScene::
+downstreamNodes(Node const& node) const
+{
+    std::vector<Node*> result;
+
+    for (auto v : _reachability.descendants(node.sceneHandle().index))
+        result.push_back(_nodes.find(_nodes.handleOfSlot(v))->get());
+
+    return result;
+}
+
+
+std::vector<Node*>
+FlowScene::
+upstreamNodes(Node const& node) const
+{
+    std::vector<Node*> result;
+
+    for (auto v : _reachability.ancestors(node.sceneHandle().index))
+        result.push_back(_nodes.find(_nodes.handleOfSlot(v))->get());
+
+    return result;
+}
+
+
+GraphItems
+FlowScene::
+createGraph(std::vector<NodeDescriptor> nodes,
+            std::vector<EdgeDescriptor> const & edges)
+{
+    // Validate everything first, so that a bad edge leaves the scene untouched.
+    for (NodeDescriptor const & descriptor : nodes)
+    {
+        if (!descriptor.model)
+            throw std::logic_error("Node descriptor without a data model");
+    }
+
+    auto hasPort = [&](std::size_t node, PortType portType, PortIndex port)
+    {
+        return node < nodes.size() &&
+               port >= 0 &&
+               static_cast<unsigned int>(port) < nodes[node].model->nPorts(portType);
+    };
+
+    {
+        std::unordered_set<QUuid> ids;
+
+        for (NodeDescriptor const & descriptor : nodes)
+        {
+            if (descriptor.id.isNull())
+                continue;
+
+            if (!ids.insert(descriptor.id).second ||
+                _nodeIndex.find(descriptor.id) != _nodeIndex.end())
+                throw std::logic_error("Node id is already in use");
+        }
+    }
+
+    // The same rules as for connections made in the view: an input takes
+    // one connection, an output as many as its ConnectionPolicy allows, and
+    // the data types match or can be converted.
+    std::vector<TypeConverter> converters(edges.size());
+
+    {
+        std::set<std::pair<std::size_t, PortIndex>> usedInputs;
+        std::set<std::pair<std::size_t, PortIndex>> usedOutputs;
+
+        for (std::size_t i = 0; i < edges.size(); ++i)
+        {
+            EdgeDescriptor const & edge = edges[i];
+
+            if (!hasPort(edge.outNode, PortType::Out, edge.outPort) ||
+                !hasPort(edge.inNode, PortType::In, edge.inPort))
+                throw std::logic_error("Edge refers to a node or port missing from the graph");
+
+            NodeDataModel const & outModel = *nodes[edge.outNode].model;
+            NodeDataModel const & inModel  = *nodes[edge.inNode].model;
+
+            if (!usedInputs.emplace(edge.inNode, edge.inPort).second)
+                throw std::logic_error("Input port is connected more than once");
+
+            if (!usedOutputs.emplace(edge.outNode, edge.outPort).second &&
+                outModel.portOutConnectionPolicy(edge.outPort) ==
+                NodeDataModel::ConnectionPolicy::One)
+                throw std::logic_error("Output port takes a single connection");
+
+            NodeDataType const outType = outModel.dataType(PortType::Out, edge.outPort);
+            NodeDataType const inType  = inModel.dataType(PortType::In, edge.inPort);
+
+            converters[i] = edge.converter;
+
+            if (outType.id != inType.id && !converters[i])
+            {
+                converters[i] = registry().getTypeConverter(outType, inType);
+
+                if (!converters[i])
+                    throw std::logic_error("Edge connects ports of different data types");
+            }
+        }
+    }
+
+    // Topological order of the new nodes, by position in `nodes`.
+    std::vector<std::vector<std::size_t>> downstream(nodes.size());
+    std::vector<std::size_t> pendingInputs(nodes.size(), 0);
+
+    for (EdgeDescriptor const & edge : edges)
+    {
+        downstream[edge.outNode].push_back(edge.inNode);
+        ++pendingInputs[edge.inNode];
+    }
+
+    std::vector<std::size_t> order;
+    order.reserve(nodes.size());
+
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        if (pendingInputs[i] == 0)
+            order.push_back(i);
+    }
+
+    for (std::size_t next = 0; next < order.size(); ++next)
+    {
+        for (std::size_t target : downstream[order[next]])
+        {
+            if (--pendingInputs[target] == 0)
+                order.push_back(target);
+        }
+    }
+
+    if (order.size() != nodes.size())
+        throw std::logic_error("Edges form a cycle");
+
+    GraphItems items;
+    items.nodes.reserve(nodes.size());
+    items.connections.reserve(edges.size());
+
+    _nodes.reserve(_nodes.size() + nodes.size());
+    _connections.reserve(_connections.size() + edges.size());
+
+    for (NodeDescriptor & descriptor : nodes)
+    {
+        descriptor.model->setBlobStore(_blobs);
+
+        auto node = detail::make_unique<Node>(std::move(descriptor.model));
+        auto ngo  = detail::make_unique<NodeGraphicsObject>(*this, *node);
+
+        // not in the scene yet, so this neither moves connections nor
+        // reports a move
+        ngo->setPos(descriptor.position);
+
+        node->setGraphicsObject(std::move(ngo));
+
+        auto nodePtr = node.get();
+        nodePtr->setSceneHandle(_nodes.insert(std::move(node)));
+
+        if (!descriptor.id.isNull())
+            nodePtr->setId(descriptor.id);
+
+        indexNode(*nodePtr);
+
+        items.nodes.push_back(nodePtr);
+    }
+
+    // Attach all connections before routing any of them, so that the
+    // connection ordinals of every node are computed only once.
+    for (std::size_t i = 0; i < edges.size(); ++i)
+    {
+        EdgeDescriptor const & edge = edges[i];
+
+        Node & nodeIn  = *items.nodes[edge.inNode];
+        Node & nodeOut = *items.nodes[edge.outNode];
+
+        auto connection =
+                std::allocate_shared<Connection>(PoolAllocator<Connection>(),
+                                                 nodeIn,
+                                                 edge.inPort,
+                                                 nodeOut,
+                                                 edge.outPort,
+                                                 converters[i]);
+
+        connection->connectionGeometry().setSelected(false);
+
+        nodeIn.nodeState().setConnection(PortType::In, edge.inPort, *connection);
+        nodeOut.nodeState().setConnection(PortType::Out, edge.outPort, *connection);
+
+        connection->setSceneHandle(_connections.insert(connection));
+
+        items.connections.push_back(connection.get());
+    }
+
+    for (std::size_t i = 0; i < edges.size(); ++i)
+    {
+        Connection & connection = *items.connections[i];
+
+        connection.setGraphicsObject(
+                    detail::make_unique<ConnectionGraphicsObject>(*this, connection));
+
+        if (!edges[i].turningPoints.isEmpty())
+            connection.connectionGeometry().setPoints(edges[i].turningPoints);
+    }
+
+    // In this order no edge goes backwards, so the topology never reorders.
+    for (std::size_t i : order)
+    {
+        _topology.addVertex(items.nodes[i]->sceneHandle().index);
+        _reachability.vertexAdded(items.nodes[i]->sceneHandle().index);
+    }
+
+    std::vector<std::pair<TopologicalOrder::Vertex, TopologicalOrder::Vertex>> added;
+    added.reserve(edges.size());
+
+    for (EdgeDescriptor const & edge : edges)
+    {
+        added.emplace_back(items.nodes[edge.outNode]->sceneHandle().index,
+                           items.nodes[edge.inNode]->sceneHandle().index);
+
+        _topology.addEdge(added.back().first, added.back().second);
+    }
+
+    _reachability.edgesAdded(added);
+
+    for (Node* node : items.nodes)
+    {
+        addItem(&node->nodeGraphicsObject());
+        node->nodeGraphicsObject().updateCacheMode();
+    }
+
+    for (Connection* connection : items.connections)
+        addItem(&connection->getConnectionGraphicsObject());
+
+    // What completeConnection() does for a single connection, the
+    // topology being done above.
+    for (Connection* connection : items.connections)
+    {
+        setupConnectionSignals(*connection);
+        sendConnectionCreatedToNodes(*connection);
+    }
+
+    // Deliver every connected output once, upstream nodes first, instead of
+    // once per connection.
+    for (std::size_t i : order)
+    {
+        Node & node = *items.nodes[i];
 
+        unsigned int const nOut = node.nodeDataModel()->nPorts(PortType::Out);
+
+        for (PortIndex port = 0; port < static_cast<PortIndex>(nOut); ++port)
+        {
+            if (!node.nodeState().connections(PortType::Out, port).empty())
+                node.onOutputConnected(port);
+        }
+    }
+
+    // The same signals as restoreNode() and createConnection(), now that
+    // the whole graph is in place.
+    for (Node* node : items.nodes)
+    {
+        nodePlaced(*node);
+        nodeCreated(*node);
+    }
+
+    for (Connection* connection : items.connections)
+        connectionCreated(*connection);
+
+    graphCreated(items);
+
+    return items;
 }
 
 
@@ -338,13 +885,21 @@ setRegistry(std::shared_ptr<DataModelRegistry> registry)
 }
 
 
+BlobStore&
+FlowScene::
+blobStore() const
+{
+    return *_blobs;
+}
+
+
 void
 FlowScene::
 iterateOverNodes(std::function<void(Node*)> const & visitor)
 {
     for (const auto& _node : _nodes)
     {
-        visitor(_node.second.get());
+        visitor(_node.get());
     }
 }
 
@@ -355,7 +910,7 @@ iterateOverNodeData(std::function<void(NodeDataModel*)> const & visitor)
 {
     for (const auto& _node : _nodes)
     {
-        visitor(_node.second->nodeDataModel());
+        visitor(_node->nodeDataModel());
     }
 }
 
@@ -364,7 +919,20 @@ void
 FlowScene::
 iterateOverNodeDataDependentOrder(std::function<void(NodeDataModel*)> const & visitor)
 {
-    std::set<QUuid> visitedNodesSet;
+    // indexed by scene handle
+    std::vector<char> visitedNodes(_nodes.slotCount(), 0);
+    std::size_t visitedCount = 0;
+
+    auto isVisited = [&](Node const &node)
+    {
+        return visitedNodes[node.sceneHandle().index] != 0;
+    };
+
+    auto markVisited = [&](Node const &node)
+    {
+        visitedNodes[node.sceneHandle().index] = 1;
+        ++visitedCount;
+    };
 
     //A leaf node is a node with no input ports, or all possible input ports empty
     auto isNodeLeaf =
@@ -383,15 +951,14 @@ iterateOverNodeDataDependentOrder(std::function<void(NodeDataModel*)> const & vi
     };
 
     //Iterate over "leaf" nodes
-    for (auto const &_node : _nodes)
+    for (auto const &node : _nodes)
     {
-        auto const &node = _node.second;
-        auto model       = node->nodeDataModel();
+        auto model = node->nodeDataModel();
 
         if (isNodeLeaf(*node, *model))
         {
             visitor(model);
-            visitedNodesSet.insert(node->id());
+            markVisited(*node);
         }
     }
 
@@ -404,7 +971,7 @@ iterateOverNodeDataDependentOrder(std::function<void(NodeDataModel*)> const & vi
 
             for (auto& conn : connections)
             {
-                if (visitedNodesSet.find(conn.second->getNode(PortType::Out)->id()) == visitedNodesSet.end())
+                if (!isVisited(*conn->getNode(PortType::Out)))
                 {
                     return false;
                 }
@@ -414,12 +981,11 @@ iterateOverNodeDataDependentOrder(std::function<void(NodeDataModel*)> const & vi
     };
 
     //Iterate over dependent nodes
-    while (_nodes.size() != visitedNodesSet.size())
+    while (_nodes.size() != visitedCount)
     {
-        for (auto const &_node : _nodes)
+        for (auto const &node : _nodes)
         {
-            auto const &node = _node.second;
-            if (visitedNodesSet.find(node->id()) != visitedNodesSet.end())
+            if (isVisited(*node))
                 continue;
 
             auto model = node->nodeDataModel();
@@ -427,7 +993,7 @@ iterateOverNodeDataDependentOrder(std::function<void(NodeDataModel*)> const & vi
             if (areNodeInputsVisitedBefore(*node, *model))
             {
                 visitor(model);
-                visitedNodesSet.insert(node->id());
+                markVisited(*node);
             }
         }
     }
@@ -459,38 +1025,141 @@ getNodeSize(const Node& node) const
 }
 
 
-std::unordered_map<QUuid, std::unique_ptr<Node> > const &
+void
 FlowScene::
-nodes() const
+setViewScale(double scale, QRectF const & visibleRect)
 {
-    return _nodes;
+    bool const magnified = scale > 1.0;
+
+    if (magnified != _magnified)
+    {
+        _magnified = magnified;
+        ++_cachePolicyEpoch;
+        _staleCacheModes = _nodes.size();
+    }
+
+    if (_staleCacheModes == 0)
+        return;
+
+    for (QGraphicsItem * item : items(visibleRect))
+    {
+        if (auto ngo = qgraphicsitem_cast<NodeGraphicsObject*>(item))
+        {
+            if (ngo->updateCacheMode())
+                --_staleCacheModes;
+        }
+    }
 }
 
 
-std::unordered_map<QUuid, std::shared_ptr<Connection> > const &
+QGraphicsItem::CacheMode
 FlowScene::
-connections() const
+nodeCacheMode(QRectF const & bounds) const
 {
-    return _connections;
+    // A device pixmap of a magnified or very tall node is both large and
+    // blurry when the zoom changes; paint those directly.
+    if (_magnified || bounds.height() > 1000)
+        return QGraphicsItem::NoCache;
+
+    return QGraphicsItem::DeviceCoordinateCache;
 }
 
 
-std::vector<Node*>
+void
 FlowScene::
-allNodes() const
+scheduleNodeMoved(Node& node)
 {
-    std::vector<Node*> nodes;
+    // nodes still being set up are not reported
+    if (node.isMovePending() || !_nodes.contains(node.sceneHandle()))
+        return;
 
-    std::transform(_nodes.begin(),
-                   _nodes.end(),
-                   std::back_inserter(nodes),
-                   [](std::pair<QUuid const, std::unique_ptr<Node>> const & p) { return p.second.get(); });
+    node.setMovePending(true);
 
-    return nodes;
+    if (_movedNodes.empty())
+        QTimer::singleShot(0, this, &FlowScene::sendNodeMoved);
+
+    _movedNodes.push_back(node.sceneHandle());
 }
 
 
-std::vector<Node*>
+void
+FlowScene::
+indexNode(Node & node)
+{
+    _nodeIndex[node.id()] = node.sceneHandle();
+}
+
+
+void
+FlowScene::
+sendNodeMoved()
+{
+    std::vector<SlotHandle> moved;
+    moved.swap(_movedNodes);
+
+    // A receiver may remove nodes, so every handle is looked up again.
+    for (SlotHandle handle : moved)
+    {
+        if (auto node = _nodes.find(handle))
+        {
+            (*node)->setMovePending(false);
+            nodeMoved(**node, (*node)->nodeGraphicsObject().pos());
+        }
+    }
+}
+
+
+FlowScene::NodeMap const &
+FlowScene::
+nodes() const
+{
+    return _nodes;
+}
+
+
+FlowScene::ConnectionMap const &
+FlowScene::
+connections() const
+{
+    return _connections;
+}
+
+
+Node*
+FlowScene::
+findNode(QUuid const & id) const
+{
+    auto it = _nodeIndex.find(id);
+
+    if (it == _nodeIndex.end())
+        return nullptr;
+
+    auto node = _nodes.find(it->second);
+
+    if (node && (*node)->id() == id)
+        return node->get();
+
+    return nullptr;
+}
+
+
+std::vector<Node*>
+FlowScene::
+allNodes() const
+{
+    std::vector<Node*> nodes;
+    nodes.reserve(_nodes.size());
+
+    std::transform(_nodes.begin(),
+                   _nodes.end(),
+                   std::back_inserter(nodes),
+                   [](std::unique_ptr<Node> const & p) { return p.get(); });
+
+    return nodes;
+}
+
+
+std::vector<Node*>
 FlowScene::
 selectedNodes() const
 {
@@ -525,18 +1194,38 @@ void
 FlowScene::
 clearScene()
 {
-    //Manual node cleanup. Simply clearing the holding datastructures doesn't work, the code crashes when
-    // there are both nodes and connections in the scene. (The data propagation internal logic tries to propagate
-    // data through already freed connections.)
+    cancelLoad();
+
+    // Every node is doomed, so no data is propagated while the
+    // connections go away.
+    removeNodes(allNodes());
+
+    // whatever is left is not attached to any node
     while (_connections.size() > 0)
     {
-        deleteConnection( *_connections.begin()->second );
+        deleteConnection( **_connections.begin() );
     }
 
-    while (_nodes.size() > 0)
+    collectBlobs();
+}
+
+
+void
+FlowScene::
+collectBlobs()
+{
+    std::vector<FlowSnapshot::NodeRecord> models;
+    models.reserve(_nodes.size());
+
+    for (auto const & node : _nodes)
     {
-        removeNode( *_nodes.begin()->second );
+        FlowSnapshot::NodeRecord record;
+        record.model = node->nodeDataModel()->save();
+
+        models.push_back(std::move(record));
     }
+
+    _blobs->collect(models);
 }
 
 
@@ -544,22 +1233,38 @@ void
 FlowScene::
 save() const
 {
+    QString selectedFilter;
+
     QString fileName =
             QFileDialog::getSaveFileName(nullptr,
                                          tr("Open Flow Scene"),
                                          QDir::homePath(),
-                                         tr("Flow Scene Files (*.flow)"));
+                                         tr("Flow Scene Files (*.flow);;"
+                                            "Binary Flow Scene Files (*.flow)"),
+                                         &selectedFilter);
 
     if (!fileName.isEmpty())
     {
         if (!fileName.endsWith("flow", Qt::CaseInsensitive))
             fileName += ".flow";
 
-        QFile file(fileName);
-        if (file.open(QIODevice::WriteOnly))
+        FileFormat const format =
+                selectedFilter.startsWith(tr("Binary")) ? FileFormat::Binary
+                                                        : FileFormat::Json;
+
+        if (!_saver)
         {
-            file.write(saveToMemory());
+            _saver = detail::make_unique<FlowSaver>(*this);
+
+            connect(_saver.get(), &FlowSaver::finished,
+                    [](QString const & name, bool success, QString const & error)
+            {
+                if (!success)
+                    qWarning() << "Failed to save" << name << ":" << error;
+            });
         }
+
+        _saver->start(fileName, format);
     }
 }
 
@@ -577,18 +1282,39 @@ load()
     if (!QFileInfo::exists(fileName))
         return;
 
-    QFile file(fileName);
+    clearScene();
 
-    if (!file.open(QIODevice::ReadOnly))
-        return;
+    // parsed in the background, the scene is filled in slices
+    auto loader = new FlowLoader(*this, this);
 
-    clearScene();
+    connect(loader, &FlowLoader::finished, loader, &QObject::deleteLater);
+    connect(loader, &FlowLoader::cancelled, loader, &QObject::deleteLater);
+    connect(loader, &FlowLoader::failed,
+            loader, [loader](QString const & message)
+    {
+        qWarning() << "Failed to load flow:" << message;
+        loader->deleteLater();
+    });
 
-    QByteArray wholeFile = file.readAll();
+    _loader = loader;
 
+    loader->start(fileName);
+}
 
-    loadFromMemory(wholeFile);
 
+void
+FlowScene::
+cancelLoad()
+{
+    if (!_loader)
+        return;
+
+    // Nothing more is built once cancelled. The loader may be the sender
+    // of the signal that got us here, so it is deleted later, and the
+    // nodes it already made go with the rest of the scene.
+    _loader->cancel();
+    _loader->deleteLater();
+    _loader.clear();
 }
 
 
@@ -597,61 +1323,512 @@ QByteArray
 FlowScene::
 saveToMemory() const
 {
-    QJsonObject sceneJson;
+    return snapshot().toJson();
+}
+
+
+void
+FlowScene::
+loadFromMemory(const QByteArray& data)
+{
+    if (FlowBinaryFormat::isBinary(data.constData(), data.size()))
+    {
+        loadFromBinary(data.constData(), data.size());
+        return;
+    }
+
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    loadFromDevice(buffer);
+}
+
+
+void
+FlowScene::
+loadFromDevice(QIODevice & device)
+{
+    qint64 const start = device.pos();
+
+    JsonRecordReader reader(device);
+
+    // Documents written by QJsonDocument list the connections first. Those
+    // read before their nodes are picked up by a second pass over the
+    // device, by their position among the connections, or held back when
+    // the device can't seek.
+    bool const rewindable = !device.isSequential();
+
+    std::vector<std::size_t> deferred;
+    std::vector<QJsonObject> heldBack;
+
+    std::size_t connectionCount = 0;
+
+    auto nodesLoaded = [this](QJsonObject const & connectionJson)
+    {
+        return findNode(QUuid(connectionJson["in_id"].toString())) &&
+               findNode(QUuid(connectionJson["out_id"].toString()));
+    };
+
+    // Files written before cycles were refused may contain some; the
+    // connections closing them are left out rather than failing the load.
+    auto restore = [this](QJsonObject const & connectionJson)
+    {
+        Node* nodeIn  = findNode(QUuid(connectionJson["in_id"].toString()));
+        Node* nodeOut = findNode(QUuid(connectionJson["out_id"].toString()));
+
+        if (nodeIn && nodeOut && wouldCreateCycle(*nodeOut, *nodeIn))
+        {
+            qWarning() << "Skipped a connection closing a cycle:"
+                       << nodeOut->id() << "->" << nodeIn->id();
+            return;
+        }
+
+        restoreConnection(connectionJson);
+    };
+
+    while (reader.next())
+    {
+        if (reader.key() == QLatin1String("nodes"))
+        {
+            restoreNode(reader.record());
+        }
+        else if (reader.key() == QLatin1String("blobs"))
+        {
+            auto const blob = FlowSnapshot::BlobRecord::fromJson(reader.record());
+
+            if (!_blobs->insert(blob))
+                qWarning() << "Skipped a blob not matching its id:" << blob.id;
+        }
+        else if (reader.key() == QLatin1String("connections"))
+        {
+            QJsonObject connectionJson = reader.record();
+
+            if (nodesLoaded(connectionJson))
+                restore(connectionJson);
+            else if (rewindable)
+                deferred.push_back(connectionCount);
+            else
+                heldBack.push_back(std::move(connectionJson));
+
+            ++connectionCount;
+        }
+    }
+
+    for (QJsonObject const & connectionJson : heldBack)
+        restore(connectionJson);
+
+    if (!deferred.empty())
+    {
+        if (!device.seek(start))
+            throw std::logic_error("Device cannot be read a second time");
+
+        JsonRecordReader again(device);
+
+        std::size_t index = 0;
+        auto next = deferred.begin();
+
+        while (next != deferred.end() && again.next())
+        {
+            if (again.key() != QLatin1String("connections"))
+                continue;
+
+            if (index++ == *next)
+            {
+                restore(again.record());
+                ++next;
+            }
+        }
+    }
+
+    sceneLoadFromMemoryCompleted(true);
+}
+
+
+FlowSnapshot
+FlowScene::
+snapshot() const
+{
+    FlowSnapshot snapshot;
+    snapshot.nodes.reserve(_nodes.size());
+
+    std::unordered_map<Node const*, std::size_t> nodeIndex;
+    nodeIndex.reserve(_nodes.size());
+
+    for (auto const & node : _nodes)
+    {
+        nodeIndex[node.get()] = snapshot.nodes.size();
+        snapshot.nodes.push_back(nodeRecord(*node));
+
+        // rather than itemsBoundingRect(), which visits every item again
+        snapshot.header.bounds |= node->nodeGraphicsObject().sceneBoundingRect();
+    }
+
+    snapshot.connections.reserve(_connections.size());
+
+    for (auto const & connection : _connections)
+    {
+        Node const* in  = connection->getNode(PortType::In);
+        Node const* out = connection->getNode(PortType::Out);
+
+        // a connection still being drawn is not saved
+        if (!in || !out)
+            continue;
+
+        snapshot.connections.push_back(connectionRecord(*connection,
+                                                        nodeIndex[out],
+                                                        nodeIndex[in]));
+    }
+
+    snapshot.blobs = _blobs->records(snapshot.nodes);
+
+    return snapshot;
+}
+
+
+FlowSnapshot
+FlowScene::
+snapshot(std::vector<Node*> const & nodes) const
+{
+    FlowSnapshot snapshot;
+    snapshot.nodes.reserve(nodes.size());
 
-    QJsonArray nodesJsonArray;
+    std::unordered_map<Node const*, std::size_t> nodeIndex;
+    nodeIndex.reserve(nodes.size());
 
-    for (auto const & pair : _nodes)
+    for (Node* node : nodes)
     {
-        auto const &node = pair.second;
+        nodeIndex[node] = snapshot.nodes.size();
+        snapshot.nodes.push_back(nodeRecord(*node));
 
-        nodesJsonArray.append(node->save());
+        snapshot.header.bounds |= node->nodeGraphicsObject().sceneBoundingRect();
     }
 
-    sceneJson["nodes"] = nodesJsonArray;
+    // Every connection between the nodes ends at an input of one of them,
+    // so only the inputs are looked at.
+    for (Node* node : nodes)
+    {
+        unsigned int const nPorts = node->nodeDataModel()->nPorts(PortType::In);
+
+        for (unsigned int port = 0; port < nPorts; ++port)
+        {
+            for (Connection* connection : node->nodeState().connections(PortType::In, port))
+            {
+                auto out = nodeIndex.find(connection->getNode(PortType::Out));
+
+                if (out == nodeIndex.end())
+                    continue;
+
+                snapshot.connections.push_back(connectionRecord(*connection,
+                                                                out->second,
+                                                                nodeIndex[node]));
+            }
+        }
+    }
+
+    snapshot.blobs = _blobs->records(snapshot.nodes);
+
+    return snapshot;
+}
+
+
+QByteArray
+FlowScene::
+copySelection() const
+{
+    return FlowBinaryFormat::write(snapshot(selectedNodes()));
+}
+
+
+GraphItems
+FlowScene::
+paste(QByteArray const & data, QPointF const & offset)
+{
+    FlowSnapshot snapshot = FlowBinaryFormat::read(data.constData(),
+                                                   static_cast<std::size_t>(data.size()));
 
-    QJsonArray connectionJsonArray;
-    for (auto const & pair : _connections)
+    // Fresh ids, so the copy can go back into the scene it came from,
+    // made here so that createGraph() indexes them with the nodes. The
+    // connections refer to nodes by position and need no remapping.
+    for (FlowSnapshot::NodeRecord & record : snapshot.nodes)
     {
-        auto const &connection = pair.second;
+        record.id        = QUuid::createUuid();
+        record.position += offset;
+    }
 
-        QJsonObject connectionJson = connection->save();
+    for (FlowSnapshot::ConnectionRecord & record : snapshot.connections)
+    {
+        for (QPointF & p : record.turningPoints)
+            p += offset;
+    }
+
+    GraphItems items = restoreSnapshot(snapshot);
+
+    clearSelection();
 
-        if (!connectionJson.isEmpty())
-            connectionJsonArray.append(connectionJson);
+    for (Node* node : items.nodes)
+        node->nodeGraphicsObject().setSelected(true);
+
+    return items;
+}
+
+
+GraphItems
+FlowScene::
+restoreSnapshot(FlowSnapshot const & snapshot)
+{
+    // before the models are restored, which may look them up
+    for (FlowSnapshot::BlobRecord const & blob : snapshot.blobs)
+    {
+        if (!_blobs->insert(blob))
+            qWarning() << "Skipped a blob not matching its id:" << blob.id;
     }
 
-    sceneJson["connections"] = connectionJsonArray;
+    std::vector<NodeDescriptor> nodes;
+    nodes.reserve(snapshot.nodes.size());
+
+    for (FlowSnapshot::NodeRecord const & record : snapshot.nodes)
+    {
+        QString const modelName = record.model["name"].toString();
+
+        auto dataModel = registry().create(modelName);
+
+        if (!dataModel)
+            throw std::logic_error(std::string("No registered model with name ") +
+                                   modelName.toLocal8Bit().data());
+
+        dataModel->setBlobStore(_blobs);
+        dataModel->restore(record.model);
 
-    QJsonDocument document(sceneJson);
+        NodeDescriptor node;
+        node.model    = std::move(dataModel);
+        node.position = record.position;
+        node.id       = record.id;
 
-    return document.toJson();
+        nodes.push_back(std::move(node));
+    }
+
+    std::vector<EdgeDescriptor> edges;
+    edges.reserve(snapshot.connections.size());
+
+    for (FlowSnapshot::ConnectionRecord const & record : snapshot.connections)
+    {
+        EdgeDescriptor edge;
+        edge.outNode = record.outNode;
+        edge.outPort = record.outPort;
+        edge.inNode  = record.inNode;
+        edge.inPort  = record.inPort;
+
+        edge.turningPoints = record.turningPoints;
+
+        if (record.hasConverter)
+            edge.converter = registry().getTypeConverter(record.outType, record.inType);
+
+        edges.push_back(std::move(edge));
+    }
+
+    // Files written before cycles were refused may contain some; the
+    // connections closing them are left out rather than failing the load.
+    if (std::size_t const removed = removeCyclicEdges(nodes.size(), edges))
+        qWarning() << "Skipped" << removed << "connections closing a cycle";
+
+    return createGraph(std::move(nodes), edges);
+}
+
+
+QByteArray
+FlowScene::
+saveToBinary() const
+{
+    return FlowBinaryFormat::write(snapshot());
 }
 
 
 void
 FlowScene::
-loadFromMemory(const QByteArray& data)
+loadFromBinary(char const* data, std::size_t size)
 {
-    QJsonObject const jsonDocument = QJsonDocument::fromJson(data).object();
+    restoreSnapshot(FlowBinaryFormat::read(data, size));
 
-    QJsonArray nodesJsonArray = jsonDocument["nodes"].toArray();
+    sceneLoadFromMemoryCompleted(true);
+}
 
-    for (QJsonValueRef node : nodesJsonArray)
+
+bool
+FlowScene::
+saveToFile(QString const & fileName, FileFormat format) const
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    FlowSnapshot contents = snapshot();
+    contents.header.setThumbnail(contents.renderThumbnail());
+
+    if (format == FileFormat::Binary)
     {
-        restoreNode(node.toObject());
+        QByteArray const data = FlowBinaryFormat::write(contents);
+
+        return file.write(data) == data.size();
     }
 
-    QJsonArray connectionJsonArray = jsonDocument["connections"].toArray();
+    contents.writeJson(file);
+
+    return file.error() == QFileDevice::NoError;
+}
+
+
+bool
+FlowScene::
+loadFromFile(QString const & fileName)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
 
-    for (QJsonValueRef connection : connectionJsonArray)
+    QByteArray const head = file.peek(8);
+
+    if (FlowBinaryFormat::isBinary(head.constData(), head.size()))
     {
-        restoreConnection(connection.toObject());
+        // unmapped when `file` goes away
+        if (uchar* mapped = file.map(0, file.size()))
+        {
+            loadFromBinary(reinterpret_cast<char const*>(mapped),
+                           static_cast<std::size_t>(file.size()));
+            return true;
+        }
 
+        loadFromMemory(file.readAll());
+        return true;
     }
 
+    loadFromDevice(file);
+
+    return true;
+}
+
+
+bool
+FlowScene::
+readHeader(QString const & fileName, FlowHeader & header)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QByteArray const head = file.peek(8);
+
+    if (FlowBinaryFormat::isBinary(head.constData(), head.size()))
+        return FlowBinaryFormat::readHeader(file, header);
+
+    // FlowSnapshot::writeJson() puts it in the first record
+    JsonRecordReader reader(file);
+
+    if (!reader.next() || reader.key() != QLatin1String("header"))
+        return false;
+
+    header = FlowHeader::fromJson(reader.record());
+
+    return true;
+}
+
+
+bool
+FlowScene::
+loadRegionFromFile(QString const & fileName, QRectF const & region)
+{
+    return loadPartFromFile(fileName,
+                            [&](char const* data, std::size_t size)
+                            {
+                                return FlowBinaryFormat::readRegion(data, size, region);
+                            },
+                            [&](FlowSnapshot const & snapshot)
+                            {
+                                return snapshot.within(region);
+                            });
+}
+
+
+bool
+FlowScene::
+loadUpstreamFromFile(QString const & fileName, std::vector<QUuid> const & nodes)
+{
+    return loadPartFromFile(fileName,
+                            [&](char const* data, std::size_t size)
+                            {
+                                return FlowBinaryFormat::readUpstream(data, size, nodes);
+                            },
+                            [&](FlowSnapshot const & snapshot)
+                            {
+                                return snapshot.upstreamOf(nodes);
+                            });
+}
+
+
+bool
+FlowScene::
+loadPartFromFile(QString const & fileName,
+                 std::function<FlowSnapshot(char const*, std::size_t)> const & readBinary,
+                 std::function<FlowSnapshot(FlowSnapshot const &)> const & pick)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QByteArray const head = file.peek(8);
+
+    if (!FlowBinaryFormat::isBinary(head.constData(), head.size()))
+    {
+        // JSON has no index, the part is picked from the whole flow
+        restoreSnapshot(pick(FlowSnapshot::readJson(file)));
+
+        sceneLoadFromMemoryCompleted(true);
+
+        return true;
+    }
+
+    QByteArray  data;
+    char const* begin = nullptr;
+    std::size_t size  = 0;
+
+    if (uchar* mapped = file.map(0, file.size()))
+    {
+        // unmapped when `file` goes away
+        begin = reinterpret_cast<char const*>(mapped);
+        size  = static_cast<std::size_t>(file.size());
+    }
+    else
+    {
+        data = file.readAll();
+    }
+
+    if (!begin)
+    {
+        begin = data.constData();
+        size  = static_cast<std::size_t>(data.size());
+    }
+
+    restoreSnapshot(readBinary(begin, size));
 
     sceneLoadFromMemoryCompleted(true);
+
+    return true;
+}
+
+
+void
+FlowScene::
+completeConnection(Connection const& c)
+{
+    setupConnectionSignals(c);
+    sendConnectionCreatedToNodes(c);
+    addConnectionToTopology(c);
+
+    connectionCreated(c);
 }
 
 
@@ -692,8 +1869,50 @@ sendConnectionDeletedToNodes(Connection const& c)
     Q_ASSERT(from != nullptr);
     Q_ASSERT(to != nullptr);
 
-    from->nodeDataModel()->outputConnectionDeleted(c);
-    to->nodeDataModel()->inputConnectionDeleted(c);
+    // removeNodes() doesn't tell the models going away
+    if (!from->isDoomed())
+        from->nodeDataModel()->outputConnectionDeleted(c);
+
+    if (!to->isDoomed())
+        to->nodeDataModel()->inputConnectionDeleted(c);
+}
+
+
+void
+FlowScene::
+addConnectionToTopology(Connection const& c)
+{
+    Node* from = c.getNode(PortType::Out);
+    Node* to   = c.getNode(PortType::In);
+
+    bool const added = _topology.addEdge(from->sceneHandle().index,
+                                         to->sceneHandle().index);
+
+    // cycles are refused before a connection gets completed
+    Q_ASSERT(added);
+    Q_UNUSED(added);
+
+    _reachability.edgeAdded(from->sceneHandle().index,
+                            to->sceneHandle().index);
+}
+
+
+void
+FlowScene::
+removeConnectionFromTopology(Connection const& c)
+{
+    Node* from = c.getNode(PortType::Out);
+    Node* to   = c.getNode(PortType::In);
+
+    // removeNodes() drops the edges of the removed nodes in one go
+    if (from->isDoomed() || to->isDoomed())
+        return;
+
+    _topology.removeEdge(from->sceneHandle().index,
+                         to->sceneHandle().index);
+
+    _reachability.edgeRemoved(from->sceneHandle().index,
+                              to->sceneHandle().index);
 }
 
 
@@ -736,3 +1955,4 @@ locateNodeAt(QPointF scenePoint, FlowScene &scene,
     return resultNode;
 }
 }
+
@@ -0,0 +1,554 @@
+#include "FlowSnapshot.hpp"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QIODevice>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtGui/QPainter>
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "BlobStore.hpp"
+#include "JsonRecordReader.hpp"
+#include "QStringStdHash.hpp"
+#include "QUuidStdHash.hpp"
+
+using QtNodes::FlowHeader;
+using QtNodes::FlowSnapshot;
+using QtNodes::NodeDataType;
+
+namespace
+{
+
+// Past this many, thumbnails leave out the connections and draw every
+// n-th node only.
+std::size_t const ThumbnailItemLimit = 10000;
+
+int const ThumbnailMaxSide = 1024;
+
+// for records read from a file, which carry no size
+QSizeF const DefaultNodeSize(120, 80);
+
+QJsonObject
+typeToJson(NodeDataType const & type)
+{
+  QJsonObject typeJson;
+
+  typeJson["id"]   = type.id;
+  typeJson["name"] = type.name;
+
+  return typeJson;
+}
+
+
+NodeDataType
+typeFromJson(QJsonObject const & typeJson)
+{
+  return NodeDataType{ typeJson["id"].toString(),
+                       typeJson["name"].toString() };
+}
+
+
+QJsonObject
+nodeToJson(FlowSnapshot const & snapshot, std::size_t index)
+{
+  FlowSnapshot::NodeRecord const & node = snapshot.nodes[index];
+
+  QJsonObject nodeJson;
+
+  nodeJson["id"]    = node.id.toString();
+  nodeJson["model"] = node.model;
+
+  QJsonObject positionJson;
+  positionJson["x"] = node.position.x();
+  positionJson["y"] = node.position.y();
+  nodeJson["position"] = positionJson;
+
+  return nodeJson;
+}
+
+
+QJsonObject
+connectionToJson(FlowSnapshot const & snapshot, std::size_t index)
+{
+  FlowSnapshot::ConnectionRecord const & connection = snapshot.connections[index];
+
+  QJsonObject connectionJson;
+
+  connectionJson["in_id"]    = snapshot.nodes[connection.inNode].id.toString();
+  connectionJson["in_index"] = connection.inPort;
+
+  connectionJson["out_id"]    = snapshot.nodes[connection.outNode].id.toString();
+  connectionJson["out_index"] = connection.outPort;
+
+  QJsonArray turningPointsJsonArray;
+  for (QPointF const & p : connection.turningPoints)
+  {
+    QJsonObject pointJson;
+    pointJson["x"] = p.x();
+    pointJson["y"] = p.y();
+    turningPointsJsonArray.append(pointJson);
+  }
+  connectionJson["turning_points"] = turningPointsJsonArray;
+
+  if (connection.hasConverter)
+  {
+    QJsonObject converterJson;
+
+    converterJson["in"]  = typeToJson(connection.inType);
+    converterJson["out"] = typeToJson(connection.outType);
+
+    connectionJson["converter"] = converterJson;
+  }
+
+  return connectionJson;
+}
+
+
+FlowSnapshot::NodeRecord
+nodeFromJson(QJsonObject const & nodeJson)
+{
+  QJsonObject const positionJson = nodeJson["position"].toObject();
+
+  FlowSnapshot::NodeRecord node;
+  node.id       = QUuid(nodeJson["id"].toString());
+  node.model    = nodeJson["model"].toObject();
+  node.position = QPointF(positionJson["x"].toDouble(),
+                          positionJson["y"].toDouble());
+
+  return node;
+}
+
+
+// Turns connections referring to node ids into records referring to
+// positions in `snapshot.nodes`.
+void
+resolveConnections(FlowSnapshot & snapshot,
+                   std::vector<QJsonObject> const & connections)
+{
+  std::unordered_map<QUuid, std::size_t> nodeIndex;
+  nodeIndex.reserve(snapshot.nodes.size());
+
+  for (std::size_t i = 0; i < snapshot.nodes.size(); ++i)
+    nodeIndex[snapshot.nodes[i].id] = i;
+
+  snapshot.connections.reserve(snapshot.connections.size() + connections.size());
+
+  for (QJsonObject const & connectionJson : connections)
+  {
+    auto in  = nodeIndex.find(QUuid(connectionJson["in_id"].toString()));
+    auto out = nodeIndex.find(QUuid(connectionJson["out_id"].toString()));
+
+    if (in == nodeIndex.end() || out == nodeIndex.end())
+      throw std::logic_error("Connection refers to a node missing from the flow");
+
+    FlowSnapshot::ConnectionRecord connection;
+    connection.inNode  = in->second;
+    connection.inPort  = connectionJson["in_index"].toInt();
+    connection.outNode = out->second;
+    connection.outPort = connectionJson["out_index"].toInt();
+
+    // Files written before turning points were saved get the same four
+    // points FlowScene::restoreConnection() uses.
+    if (connectionJson.contains("turning_points"))
+    {
+      for (QJsonValue const & p : connectionJson["turning_points"].toArray())
+      {
+        QJsonObject const pointJson = p.toObject();
+        connection.turningPoints.append(QPointF(pointJson["x"].toDouble(),
+                                                pointJson["y"].toDouble()));
+      }
+    }
+    else
+    {
+      for (int i = 0; i < 4; ++i)
+        connection.turningPoints.append(QPointF(0, 0));
+    }
+
+    QJsonValue const converterValue = connectionJson["converter"];
+
+    if (!converterValue.isUndefined())
+    {
+      QJsonObject const converterJson = converterValue.toObject();
+
+      connection.hasConverter = true;
+      connection.inType  = typeFromJson(converterJson["in"].toObject());
+      connection.outType = typeFromJson(converterJson["out"].toObject());
+    }
+
+    snapshot.connections.push_back(std::move(connection));
+  }
+}
+
+
+// Writes the records of one top level array, indented the way
+// QJsonDocument::Indented lays out a document.
+template <typename ToJson>
+void
+writeRecords(QIODevice & device,
+             char const* key,
+             std::size_t count,
+             ToJson toJson)
+{
+  device.write("    \"");
+  device.write(key);
+  device.write("\": [\n");
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    QByteArray text = QJsonDocument(toJson(i)).toJson(QJsonDocument::Indented);
+
+    text.chop(1);
+    text.replace('\n', "\n        ");
+
+    device.write("        ");
+    device.write(text);
+    device.write(i + 1 < count ? ",\n" : "\n");
+  }
+
+  device.write("    ]");
+}
+
+
+// The given nodes in snapshot order, the connections between them and
+// the blobs their models refer to.
+FlowSnapshot
+part(FlowSnapshot const & snapshot, std::vector<std::size_t> nodes)
+{
+  std::sort(nodes.begin(), nodes.end());
+
+  FlowSnapshot result;
+  result.nodes.reserve(nodes.size());
+
+  std::vector<std::size_t> position(snapshot.nodes.size(), snapshot.nodes.size());
+
+  std::vector<QString> blobIds;
+
+  for (std::size_t node : nodes)
+  {
+    position[node] = result.nodes.size();
+    result.nodes.push_back(snapshot.nodes[node]);
+
+    QtNodes::BlobStore::collectReferences(result.nodes.back().model, blobIds);
+  }
+
+  for (FlowSnapshot::ConnectionRecord const & connection : snapshot.connections)
+  {
+    std::size_t const out = position[connection.outNode];
+    std::size_t const in  = position[connection.inNode];
+
+    if (out == snapshot.nodes.size() || in == snapshot.nodes.size())
+      continue;
+
+    FlowSnapshot::ConnectionRecord record = connection;
+    record.outNode = out;
+    record.inNode  = in;
+
+    result.connections.push_back(std::move(record));
+  }
+
+  if (!blobIds.empty())
+  {
+    std::unordered_set<QString> const wanted(blobIds.begin(), blobIds.end());
+
+    for (FlowSnapshot::BlobRecord const & blob : snapshot.blobs)
+    {
+      if (wanted.count(blob.id) != 0)
+        result.blobs.push_back(blob);
+    }
+  }
+
+  return result;
+}
+
+}
+
+
+QJsonObject
+FlowSnapshot::BlobRecord::
+toJson() const
+{
+  QJsonObject blobJson;
+
+  blobJson["id"]   = id;
+  blobJson["size"] = static_cast<double>(size);
+
+  if (compressed)
+    blobJson["compression"] = QStringLiteral("zlib");
+
+  blobJson["data"] = QString::fromLatin1(data.toBase64());
+
+  return blobJson;
+}
+
+
+FlowSnapshot::BlobRecord
+FlowSnapshot::BlobRecord::
+fromJson(QJsonObject const & blobJson)
+{
+  QString const compression = blobJson["compression"].toString();
+
+  if (!compression.isEmpty() && compression != QLatin1String("zlib"))
+    throw std::logic_error("Unsupported blob compression");
+
+  BlobRecord blob;
+  blob.id         = blobJson["id"].toString();
+  blob.size       = static_cast<quint64>(blobJson["size"].toDouble());
+  blob.compressed = !compression.isEmpty();
+  blob.data       = QByteArray::fromBase64(blobJson["data"].toString().toLatin1());
+
+  return blob;
+}
+
+
+FlowHeader
+FlowSnapshot::
+summary() const
+{
+  FlowHeader result = header;
+
+  result.nodeCount       = nodes.size();
+  result.connectionCount = connections.size();
+
+  return result;
+}
+
+
+FlowSnapshot
+FlowSnapshot::
+within(QRectF const & region) const
+{
+  QRectF const bounds = region.normalized();
+
+  std::vector<std::size_t> selected;
+
+  for (std::size_t i = 0; i < nodes.size(); ++i)
+  {
+    if (bounds.contains(nodes[i].position))
+      selected.push_back(i);
+  }
+
+  return part(*this, std::move(selected));
+}
+
+
+FlowSnapshot
+FlowSnapshot::
+upstreamOf(std::vector<QUuid> const & ids) const
+{
+  std::unordered_map<QUuid, std::size_t> nodeIndex;
+  nodeIndex.reserve(nodes.size());
+
+  for (std::size_t i = 0; i < nodes.size(); ++i)
+    nodeIndex[nodes[i].id] = i;
+
+  // sources of the connections into every node
+  std::vector<std::vector<std::size_t>> sources(nodes.size());
+
+  for (ConnectionRecord const & connection : connections)
+    sources[connection.inNode].push_back(connection.outNode);
+
+  std::vector<std::size_t> selected;
+  std::vector<bool>        visited(nodes.size(), false);
+
+  for (QUuid const & id : ids)
+  {
+    auto it = nodeIndex.find(id);
+
+    if (it != nodeIndex.end() && !visited[it->second])
+    {
+      visited[it->second] = true;
+      selected.push_back(it->second);
+    }
+  }
+
+  for (std::size_t next = 0; next < selected.size(); ++next)
+  {
+    for (std::size_t source : sources[selected[next]])
+    {
+      if (!visited[source])
+      {
+        visited[source] = true;
+        selected.push_back(source);
+      }
+    }
+  }
+
+  return part(*this, std::move(selected));
+}
+
+
+QByteArray
+FlowSnapshot::
+toJson() const
+{
+  QByteArray json;
+
+  QBuffer buffer(&json);
+  buffer.open(QIODevice::WriteOnly);
+
+  writeJson(buffer);
+
+  return json;
+}
+
+
+void
+FlowSnapshot::
+writeJson(QIODevice & device) const
+{
+  device.write("{\n");
+
+  writeRecords(device, "header", 1,
+               [this](std::size_t) { return summary().toJson(); });
+
+  device.write(",\n");
+
+  // files without blobs stay readable by older versions
+  if (!blobs.empty())
+  {
+    writeRecords(device, "blobs", blobs.size(),
+                 [this](std::size_t i) { return blobs[i].toJson(); });
+
+    device.write(",\n");
+  }
+
+  writeRecords(device, "nodes", nodes.size(),
+               [this](std::size_t i) { return nodeToJson(*this, i); });
+
+  device.write(",\n");
+
+  writeRecords(device, "connections", connections.size(),
+               [this](std::size_t i) { return connectionToJson(*this, i); });
+
+  device.write("\n}\n");
+}
+
+
+QImage
+FlowSnapshot::
+renderThumbnail(QSize const & maxSize) const
+{
+  auto nodeRect = [](NodeRecord const & node)
+  {
+    return QRectF(node.position, node.size.isEmpty() ? DefaultNodeSize : node.size);
+  };
+
+  QRectF source = header.bounds;
+
+  if (source.isEmpty())
+  {
+    for (NodeRecord const & node : nodes)
+      source |= nodeRect(node);
+  }
+
+  if (nodes.empty() || source.isEmpty())
+    return QImage();
+
+  QSize const size =
+    source.size().scaled(QSizeF(maxSize.boundedTo(QSize(ThumbnailMaxSide, ThumbnailMaxSide))),
+                         Qt::KeepAspectRatio).toSize().expandedTo(QSize(1, 1));
+
+  QImage image(size, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+
+  QPainter painter(&image);
+  painter.setRenderHint(QPainter::Antialiasing);
+
+  painter.scale(size.width() / source.width(), size.height() / source.height());
+  painter.translate(-source.topLeft());
+
+  if (connections.size() <= ThumbnailItemLimit)
+  {
+    // cosmetic, one pixel wide at any scale
+    painter.setPen(QPen(QColor(Qt::darkCyan), 0));
+
+    for (ConnectionRecord const & connection : connections)
+    {
+      QRectF const out = nodeRect(nodes[connection.outNode]);
+      QRectF const in  = nodeRect(nodes[connection.inNode]);
+
+      painter.drawLine(QPointF(out.right(), out.center().y()),
+                       QPointF(in.left(), in.center().y()));
+    }
+  }
+
+  painter.setPen(QPen(QColor(Qt::white), 0));
+  painter.setBrush(QColor(80, 80, 80));
+
+  std::size_t const step = nodes.size() / ThumbnailItemLimit + 1;
+
+  for (std::size_t i = 0; i < nodes.size(); i += step)
+    painter.drawRect(nodeRect(nodes[i]));
+
+  return image;
+}
+
+
+FlowSnapshot
+FlowSnapshot::
+fromJson(QJsonObject const & json)
+{
+  FlowSnapshot snapshot;
+
+  QJsonArray const headerJsonArray = json["header"].toArray();
+
+  if (!headerJsonArray.isEmpty())
+    snapshot.header = FlowHeader::fromJson(headerJsonArray.first().toObject());
+
+  for (QJsonValue const & value : json["blobs"].toArray())
+    snapshot.blobs.push_back(BlobRecord::fromJson(value.toObject()));
+
+  QJsonArray const nodesJsonArray = json["nodes"].toArray();
+  snapshot.nodes.reserve(nodesJsonArray.size());
+
+  for (QJsonValue const & value : nodesJsonArray)
+    snapshot.nodes.push_back(nodeFromJson(value.toObject()));
+
+  QJsonArray const connectionJsonArray = json["connections"].toArray();
+
+  std::vector<QJsonObject> connections;
+  connections.reserve(connectionJsonArray.size());
+
+  for (QJsonValue const & value : connectionJsonArray)
+    connections.push_back(value.toObject());
+
+  resolveConnections(snapshot, connections);
+
+  return snapshot;
+}
+
+
+FlowSnapshot
+FlowSnapshot::
+readJson(QIODevice & device, std::function<bool()> const & proceed)
+{
+  FlowSnapshot snapshot;
+
+  // resolved once all nodes are known, the document may list them last
+  std::vector<QJsonObject> connections;
+
+  JsonRecordReader reader(device);
+
+  while (reader.next())
+  {
+    if (reader.key() == QLatin1String("nodes"))
+      snapshot.nodes.push_back(nodeFromJson(reader.record()));
+    else if (reader.key() == QLatin1String("connections"))
+      connections.push_back(reader.record());
+    else if (reader.key() == QLatin1String("blobs"))
+      snapshot.blobs.push_back(BlobRecord::fromJson(reader.record()));
+    else if (reader.key() == QLatin1String("header"))
+      snapshot.header = FlowHeader::fromJson(reader.record());
+
+    if (proceed && !proceed())
+      return FlowSnapshot();
+  }
+
+  resolveConnections(snapshot, connections);
+
+  return snapshot;
+}
@@ -0,0 +1,716 @@
+#include "FlowUndoStack.hpp"
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QTimer>
+
+#include <algorithm>
+#include <utility>
+
+#include "BlobStore.hpp"
+#include "Connection.hpp"
+#include "FlowScene.hpp"
+#include "Node.hpp"
+#include "NodeDataModel.hpp"
+#include "NodeGraphicsObject.hpp"
+#include "NodeState.hpp"
+
+using QtNodes::BlobStore;
+using QtNodes::Connection;
+using QtNodes::FlowScene;
+using QtNodes::FlowUndoStack;
+using QtNodes::Node;
+using QtNodes::NodeDataModel;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+
+namespace
+{
+
+std::size_t
+jsonBytes(QJsonObject const & json)
+{
+  if (json.isEmpty())
+    return 0;
+
+  return static_cast<std::size_t>(QJsonDocument(json).toJson(QJsonDocument::Compact).size());
+}
+
+
+// Keys to set and unset to turn `from` into `to`; empty if they are equal.
+QJsonObject
+patchBetween(QJsonObject const & from, QJsonObject const & to)
+{
+  QJsonObject set;
+  QJsonArray  unset;
+
+  for (auto it = to.begin(); it != to.end(); ++it)
+  {
+    if (from.value(it.key()) != it.value())
+      set[it.key()] = it.value();
+  }
+
+  for (auto it = from.begin(); it != from.end(); ++it)
+  {
+    if (!to.contains(it.key()))
+      unset.append(it.key());
+  }
+
+  QJsonObject patch;
+
+  if (!set.isEmpty())
+    patch["set"] = set;
+
+  if (!unset.isEmpty())
+    patch["unset"] = unset;
+
+  return patch;
+}
+
+
+QJsonObject
+patched(QJsonObject json, QJsonObject const & patch)
+{
+  QJsonObject const set = patch["set"].toObject();
+  for (auto it = set.begin(); it != set.end(); ++it)
+    json[it.key()] = it.value();
+
+  for (QJsonValue const & key : patch["unset"].toArray())
+    json.remove(key.toString());
+
+  return json;
+}
+
+
+Connection*
+findConnection(FlowScene const & scene, QJsonObject const & connectionJson)
+{
+  Node* in  = scene.findNode(QUuid(connectionJson["in_id"].toString()));
+  Node* out = scene.findNode(QUuid(connectionJson["out_id"].toString()));
+
+  PortIndex const inIndex  = connectionJson["in_index"].toInt();
+  PortIndex const outIndex = connectionJson["out_index"].toInt();
+
+  if (!in || !out)
+    return nullptr;
+
+  for (Connection* connection : in->nodeState().connections(PortType::In, inIndex))
+  {
+    if (connection->getNode(PortType::Out) == out &&
+        connection->getPortIndex(PortType::Out) == outIndex)
+      return connection;
+  }
+
+  return nullptr;
+}
+
+}
+
+
+FlowUndoStack::
+FlowUndoStack(FlowScene & scene, QObject * parent)
+  : QObject(parent)
+  , _scene(scene)
+{
+  _nodes.reserve(_scene.nodes().size());
+
+  for (auto const & node : _scene.nodes())
+  {
+    updateBase(*node);
+    watchModel(*node);
+  }
+
+  connect(&_scene, &FlowScene::nodeCreated, this, &FlowUndoStack::recordCreated);
+  connect(&_scene, &FlowScene::nodeDeleted, this, &FlowUndoStack::recordRemoved);
+  connect(&_scene, &FlowScene::nodeMoved, this, &FlowUndoStack::recordMoved);
+
+  connect(&_scene, &FlowScene::connectionCreated,
+          this, &FlowUndoStack::recordConnected);
+  connect(&_scene, &FlowScene::connectionDeleted,
+          this, &FlowUndoStack::recordDisconnected);
+
+  connect(&_scene, &FlowScene::aboutToBeDestroyed, this, &FlowUndoStack::detach);
+
+  _sinceLastStep.start();
+}
+
+
+FlowUndoStack::
+~FlowUndoStack()
+{
+  // empty if the scene went first, see detach()
+  for (Step const & step : _undo)
+    releaseBlobs(step);
+
+  for (Step const & step : _redo)
+    releaseBlobs(step);
+}
+
+
+void
+FlowUndoStack::
+setMemoryLimit(std::size_t bytes)
+{
+  _memoryLimit = bytes;
+
+  // The step being recorded is trimmed as a whole, not under its feet.
+  if (_stepOpen || !_dirty.empty())
+    closeStep();
+
+  if (trim())
+    Q_EMIT changed();
+}
+
+
+void
+FlowUndoStack::
+recordModel(Node & node)
+{
+  auto base = _nodes.find(node.id());
+
+  if (_applying || base == _nodes.end())
+    return;
+
+  QJsonObject const current = node.nodeDataModel()->save();
+  QJsonObject const redo    = patchBetween(base->second.model, current);
+
+  if (redo.isEmpty())
+    return;
+
+  Operation operation;
+  operation.kind = Operation::Kind::ChangeModel;
+  operation.node = node.id();
+  operation.data["redo"] = redo;
+  operation.data["undo"] = patchBetween(current, base->second.model);
+
+  base->second.model = current;
+
+  push(std::move(operation));
+}
+
+
+void
+FlowUndoStack::
+clear()
+{
+  for (Step const & step : _undo)
+    releaseBlobs(step);
+
+  for (Step const & step : _redo)
+    releaseBlobs(step);
+
+  _undo.clear();
+  _redo.clear();
+  _mergeable.clear();
+
+  _stepOpen    = false;
+  _memoryUsage = 0;
+
+  Q_EMIT changed();
+}
+
+
+void
+FlowUndoStack::
+undo()
+{
+  if (_stepOpen || !_dirty.empty())
+    closeStep();
+
+  if (_undo.empty())
+    return;
+
+  Step step = std::move(_undo.back());
+  _undo.pop_back();
+
+  _memoryUsage -= step.bytes;
+  apply(step, false);
+  _memoryUsage += step.bytes;
+
+  _redo.push_back(std::move(step));
+  _mergeable.clear();
+
+  trim();
+  Q_EMIT changed();
+}
+
+
+void
+FlowUndoStack::
+redo()
+{
+  if (_stepOpen || !_dirty.empty())
+    closeStep();
+
+  if (_redo.empty())
+    return;
+
+  Step step = std::move(_redo.back());
+  _redo.pop_back();
+
+  _memoryUsage -= step.bytes;
+  apply(step, true);
+  _memoryUsage += step.bytes;
+
+  _undo.push_back(std::move(step));
+  _mergeable.clear();
+
+  trim();
+  Q_EMIT changed();
+}
+
+
+void
+FlowUndoStack::
+closeStep()
+{
+  // model changes made during this turn belong to its step
+  std::unordered_set<QUuid> dirty;
+  dirty.swap(_dirty);
+
+  for (QUuid const & id : dirty)
+  {
+    if (Node* node = _scene.findNode(id))
+      recordModel(*node);
+  }
+
+  _closePending = false;
+
+  if (!_stepOpen)
+    return;
+
+  _stepOpen = false;
+  _sinceLastStep.restart();
+
+  trim();
+  Q_EMIT changed();
+}
+
+
+FlowUndoStack::Step&
+FlowUndoStack::
+openStep(bool mergeMoves, QUuid const & node)
+{
+  if (!_stepOpen)
+  {
+    bool const merge = mergeMoves && !_undo.empty() &&
+                       _mergeable.count(node) != 0 &&
+                       !_sinceLastStep.hasExpired(_moveMergeInterval);
+
+    if (!merge)
+    {
+      for (Step const & step : _redo)
+      {
+        _memoryUsage -= step.bytes;
+        releaseBlobs(step);
+      }
+
+      _redo.clear();
+      _mergeable.clear();
+      _undo.emplace_back();
+    }
+
+    _stepOpen = true;
+    scheduleClose();
+  }
+
+  return _undo.back();
+}
+
+
+void
+FlowUndoStack::
+push(Operation operation, bool mergeMoves)
+{
+  Step & step = openStep(mergeMoves, operation.node);
+
+  operation.bytes = sizeof(Operation) + jsonBytes(operation.data);
+
+  step.bytes   += operation.bytes;
+  _memoryUsage += operation.bytes;
+
+  retainBlobs(operation);
+
+  step.operations.push_back(std::move(operation));
+}
+
+
+void
+FlowUndoStack::
+apply(Step & step, bool forward)
+{
+  using Kind = Operation::Kind;
+
+  auto action = [forward](Operation const & operation)
+  {
+    if (forward)
+      return operation.kind;
+
+    switch (operation.kind)
+    {
+      case Kind::CreateNode: return Kind::RemoveNode;
+      case Kind::RemoveNode: return Kind::CreateNode;
+      case Kind::Connect:    return Kind::Disconnect;
+      case Kind::Disconnect: return Kind::Connect;
+      default:               return operation.kind;
+    }
+  };
+
+  _applying = true;
+
+  try
+  {
+    // Nodes come first, so that the other operations find them, and go
+    // last, after the connections recorded with their removal.
+    for (Operation & operation : step.operations)
+    {
+      if (action(operation) == Kind::CreateNode)
+        apply(operation, Kind::CreateNode, forward);
+    }
+
+    auto applyOthers = [&](Operation & operation)
+    {
+      Kind const kind = action(operation);
+
+      if (kind != Kind::CreateNode && kind != Kind::RemoveNode)
+        apply(operation, kind, forward);
+    };
+
+    if (forward)
+      std::for_each(step.operations.begin(), step.operations.end(), applyOthers);
+    else
+      std::for_each(step.operations.rbegin(), step.operations.rend(), applyOthers);
+
+    for (Operation & operation : step.operations)
+    {
+      if (action(operation) == Kind::RemoveNode)
+        apply(operation, Kind::RemoveNode, forward);
+    }
+  }
+  catch (...)
+  {
+    _applying = false;
+    throw;
+  }
+
+  _applying = false;
+
+  step.bytes = 0;
+
+  for (Operation const & operation : step.operations)
+    step.bytes += operation.bytes;
+}
+
+
+void
+FlowUndoStack::
+apply(Operation & operation, Operation::Kind action, bool forward)
+{
+  using Kind = Operation::Kind;
+
+  switch (action)
+  {
+    case Kind::CreateNode:
+    {
+      _scene.restoreNode(operation.data);
+
+      // kept by the node from now on
+      operation.data = QJsonObject();
+      break;
+    }
+
+    case Kind::RemoveNode:
+    {
+      if (Node* node = _scene.findNode(operation.node))
+      {
+        operation.data = node->save();
+        _scene.removeNode(*node);
+      }
+      break;
+    }
+
+    case Kind::Connect:
+    {
+      if (!findConnection(_scene, operation.data))
+        _scene.restoreConnection(operation.data);
+      break;
+    }
+
+    case Kind::Disconnect:
+    {
+      if (Connection* connection = findConnection(_scene, operation.data))
+        _scene.deleteConnection(*connection);
+      break;
+    }
+
+    case Kind::Move:
+    {
+      if (Node* node = _scene.findNode(operation.node))
+      {
+        QPointF const position = forward ? operation.to : operation.from;
+
+        _scene.setNodePosition(*node, position);
+
+        // the nodeMoved() that follows is not an edit
+        _nodes[operation.node].position = position;
+      }
+      break;
+    }
+
+    case Kind::ChangeModel:
+    {
+      if (Node* node = _scene.findNode(operation.node))
+      {
+        NodeDataModel* model = node->nodeDataModel();
+
+        QJsonObject const patch =
+          operation.data[forward ? "redo" : "undo"].toObject();
+
+        model->restore(patched(model->save(), patch));
+
+        _nodes[operation.node].model = model->save();
+      }
+      break;
+    }
+  }
+
+  operation.bytes = sizeof(Operation) + jsonBytes(operation.data);
+
+  retainBlobs(operation);
+}
+
+
+void
+FlowUndoStack::
+retainBlobs(Operation & operation)
+{
+  std::vector<QString> ids;
+  BlobStore::collectReferences(operation.data, ids);
+
+  BlobStore & blobs = _scene.blobStore();
+
+  blobs.retain(ids);
+  blobs.release(operation.blobs);
+
+  operation.blobs = std::move(ids);
+}
+
+
+void
+FlowUndoStack::
+releaseBlobs(Step const & step)
+{
+  for (Operation const & operation : step.operations)
+    _scene.blobStore().release(operation.blobs);
+}
+
+
+void
+FlowUndoStack::
+updateBase(Node & node)
+{
+  NodeBase & base = _nodes[node.id()];
+
+  base.model    = node.nodeDataModel()->save();
+  base.position = node.nodeGraphicsObject().pos();
+}
+
+
+void
+FlowUndoStack::
+watchModel(Node & node)
+{
+  QUuid const id = node.id();
+
+  connect(node.nodeDataModel(), &NodeDataModel::dataUpdated,
+          this, [this, id]
+  {
+    if (_applying)
+      return;
+
+    // Looked at when the turn ends; outputs often update without any
+    // change to the saved state.
+    _dirty.insert(id);
+    scheduleClose();
+  });
+}
+
+
+void
+FlowUndoStack::
+scheduleClose()
+{
+  if (_closePending)
+    return;
+
+  _closePending = true;
+
+  QTimer::singleShot(0, this, SLOT(closeStep()));
+}
+
+
+bool
+FlowUndoStack::
+trim()
+{
+  bool dropped = false;
+
+  while (_memoryUsage > _memoryLimit && !_undo.empty())
+  {
+    _memoryUsage -= _undo.front().bytes;
+    releaseBlobs(_undo.front());
+    _undo.pop_front();
+    dropped = true;
+  }
+
+  // the redo steps furthest away go next
+  while (_memoryUsage > _memoryLimit && !_redo.empty())
+  {
+    _memoryUsage -= _redo.front().bytes;
+    releaseBlobs(_redo.front());
+    _redo.erase(_redo.begin());
+    dropped = true;
+  }
+
+  if (_undo.empty())
+  {
+    _mergeable.clear();
+    _stepOpen = false;
+  }
+
+  return dropped;
+}
+
+
+void
+FlowUndoStack::
+detach()
+{
+  // The scene removing its nodes on destruction is not an edit.
+  disconnect(&_scene, nullptr, this, nullptr);
+
+  for (auto const & node : _scene.nodes())
+    disconnect(node->nodeDataModel(), nullptr, this, nullptr);
+
+  _nodes.clear();
+  _dirty.clear();
+
+  clear();
+}
+
+
+void
+FlowUndoStack::
+recordCreated(Node & node)
+{
+  updateBase(node);
+  watchModel(node);
+
+  if (_applying)
+    return;
+
+  Operation operation;
+  operation.kind = Operation::Kind::CreateNode;
+  operation.node = node.id();
+
+  push(std::move(operation));
+
+  _mergeable[node.id()] = -1;
+}
+
+
+void
+FlowUndoStack::
+recordRemoved(Node & node)
+{
+  QUuid const id = node.id();
+
+  if (!_applying)
+  {
+    // a change made just before goes first, the removal saves the result
+    if (_dirty.erase(id) != 0)
+      recordModel(node);
+
+    Operation operation;
+    operation.kind = Operation::Kind::RemoveNode;
+    operation.node = id;
+    operation.data = node.save();
+
+    push(std::move(operation));
+  }
+
+  _nodes.erase(id);
+  _dirty.erase(id);
+}
+
+
+void
+FlowUndoStack::
+recordMoved(Node & node, QPointF const & position)
+{
+  auto base = _nodes.find(node.id());
+
+  if (base == _nodes.end())
+    return;
+
+  if (_applying || base->second.position == position)
+  {
+    base->second.position = position;
+    return;
+  }
+
+  QUuid const id = node.id();
+
+  Step & step = openStep(true, id);
+
+  auto mergeable = _mergeable.find(id);
+
+  if (mergeable != _mergeable.end() && mergeable->second >= 0)
+  {
+    step.operations[static_cast<std::size_t>(mergeable->second)].to = position;
+  }
+  else
+  {
+    Operation operation;
+    operation.kind = Operation::Kind::Move;
+    operation.node = id;
+    operation.from = base->second.position;
+    operation.to   = position;
+
+    push(std::move(operation), true);
+
+    _mergeable[id] = static_cast<std::ptrdiff_t>(step.operations.size() - 1);
+  }
+
+  base->second.position = position;
+}
+
+
+void
+FlowUndoStack::
+recordConnected(Connection const & connection)
+{
+  if (_applying)
+    return;
+
+  Operation operation;
+  operation.kind = Operation::Kind::Connect;
+  operation.data = connection.save();
+
+  push(std::move(operation));
+}
+
+
+void
+FlowUndoStack::
+recordDisconnected(Connection const & connection)
+{
+  if (_applying)
+    return;
+
+  Operation operation;
+  operation.kind = Operation::Kind::Disconnect;
+  operation.data = connection.save();
+
+  push(std::move(operation));
+}
@@ -17,9 +17,13 @@
 #include <QDebug>
 #include <iostream>
 #include <cmath>
+#include <stdexcept>
+#include <vector>
 
 #include "FlowScene.hpp"
 #include "DataModelRegistry.hpp"
+#include "FlowBinaryFormat.hpp"
+#include "FlowHeader.hpp"
 #include "Node.hpp"
 #include "NodeGraphicsObject.hpp"
 #include "ConnectionGraphicsObject.hpp"
@@ -27,12 +31,17 @@
 
 using QtNodes::FlowView;
 using QtNodes::FlowScene;
+using QtNodes::Node;
+using QtNodes::FlowBinaryFormat;
+using QtNodes::FlowHeader;
 
 FlowView::
 FlowView(QWidget *parent)
   : QGraphicsView(parent)
   , _clearSelectionAction(Q_NULLPTR)
   , _deleteSelectionAction(Q_NULLPTR)
+  , _copySelectionAction(Q_NULLPTR)
+  , _pasteAction(Q_NULLPTR)
   , _scene(Q_NULLPTR)
 {
   setDragMode(QGraphicsView::ScrollHandDrag);
@@ -80,6 +89,30 @@ deleteSelectionAction() const
 }
 
 
+QAction*
+FlowView::
+copySelectionAction() const
+{
+  return _copySelectionAction;
+}
+
+
+QAction*
+FlowView::
+pasteAction() const
+{
+  return _pasteAction;
+}
+
+
+QString
+FlowView::
+clipboardMimeType()
+{
+  return QStringLiteral("application/x-qtnodes-flow");
+}
+
+
 void
 FlowView::setScene(FlowScene *scene)
 {
@@ -99,17 +132,19 @@ FlowView::setScene(FlowScene *scene)
   connect(_deleteSelectionAction, &QAction::triggered, this, &FlowView::deleteSelectedNodes);
   addAction(_deleteSelectionAction);
 
-  //gzl
-//  QObject::connect(comboBoxVersion, static_cast<void (QComboBox::*)(const QString &)>(&QComboBox::currentIndexChanged), this, &RepositoryWidget::slotDisplayVersion);
-
-//  connect(this, &FlowView::signal_scale_param, scene, &FlowScene::scale_param_intern2);
-  connect(this, &FlowView::signal_scale_param,scene,[=](float scale_param_height){
+  delete _copySelectionAction;
+  _copySelectionAction = new QAction(QStringLiteral("Copy"), this);
+  _copySelectionAction->setShortcut(QKeySequence::Copy);
+  connect(_copySelectionAction, &QAction::triggered, this, &FlowView::copySelection);
+  addAction(_copySelectionAction);
 
-      //    std::cout<<"\nyes1"<<scale_param_height<<std::endl;
-      Q_EMIT scene->scale_param_intern1(scale_param_height);
+  delete _pasteAction;
+  _pasteAction = new QAction(QStringLiteral("Paste"), this);
+  _pasteAction->setShortcut(QKeySequence::Paste);
+  connect(_pasteAction, &QAction::triggered, this, &FlowView::paste);
+  addAction(_pasteAction);
 
-  });
-//  QObject::connect(this, SIGNAL(signal_scale_param(float)), _scene, SLOT(rest_cache_mode(float)));
+  updateViewScale();
 }
 
 
@@ -242,19 +277,6 @@ wheelEvent(QWheelEvent *event)
     scaleUp();
   else
     scaleDown();
-  //gzl
-//  QTransform t1 = transform();
-//  this->scale_param=t1.m11();
-//  std::cout<<"\nmatrix11: "<<this->scale_param<<std::endl;
-//  this->scale_param=3.14159265358979;
-//  this->setScene();
-//  std::cout<<"\ntime: "<<std::time(0)<<std::endl;
-  auto scale_param_height=this->tm11();
-//  auto scene=this->scene();
-//  connect(this, SIGNAL(signal_scale_param(int)), scene, SLOT(reset_cache_mode(int)));
-  Q_EMIT signal_scale_param(scale_param_height);
-
-
 }
 
 
@@ -271,6 +293,7 @@ scaleUp()
     return;
 
   scale(factor, factor);
+  updateViewScale();
 }
 
 
@@ -282,6 +305,7 @@ scaleDown()
   double const factor = std::pow(step, -1.0);
 
   scale(factor, factor);
+  updateViewScale();
 }
 
 
@@ -302,10 +326,62 @@ deleteSelectedNodes()
   // Selected connections were already deleted prior to this loop, otherwise
   // qgraphicsitem_cast<NodeGraphicsObject*>(item) could be a use-after-free
   // when a selected connection is deleted by deleting the node.
+  std::vector<Node*> nodes;
+
   for (QGraphicsItem * item : _scene->selectedItems())
   {
     if (auto n = qgraphicsitem_cast<NodeGraphicsObject*>(item))
-      _scene->removeNode(n->node());
+      nodes.push_back(&n->node());
+  }
+
+  _scene->removeNodes(nodes);
+}
+
+
+void
+FlowView::
+copySelection()
+{
+  if (_scene->selectedNodes().empty())
+    return;
+
+  auto mimeData = new QMimeData;
+  mimeData->setData(clipboardMimeType(), _scene->copySelection());
+
+  QApplication::clipboard()->setMimeData(mimeData);
+}
+
+
+void
+FlowView::
+paste()
+{
+  QMimeData const* mimeData = QApplication::clipboard()->mimeData();
+
+  if (!mimeData || !mimeData->hasFormat(clipboardMimeType()))
+    return;
+
+  QByteArray const data = mimeData->data(clipboardMimeType());
+
+  try
+  {
+    // next to the copied nodes, unless the cursor says where
+    QPointF offset(20, 20);
+
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    FlowHeader header;
+
+    if (underMouse() && FlowBinaryFormat::readHeader(buffer, header))
+      offset = mapToScene(mapFromGlobal(QCursor::pos())) - header.bounds.topLeft();
+
+    _scene->paste(data, offset);
+  }
+  catch (std::logic_error const & error)
+  {
+    qWarning() << "Cannot paste nodes:" << error.what();
   }
 }
 
@@ -435,6 +511,40 @@ showEvent(QShowEvent *event)
 }
 
 
+void
+FlowView::
+resizeEvent(QResizeEvent *event)
+{
+  QGraphicsView::resizeEvent(event);
+
+  // the visible area changed, nodes coming into view follow the zoom policy
+  updateViewScale();
+}
+
+
+void
+FlowView::
+scrollContentsBy(int dx, int dy)
+{
+  QGraphicsView::scrollContentsBy(dx, dy);
+
+  // brings nodes scrolled into view up to date with the zoom policy
+  updateViewScale();
+}
+
+
+void
+FlowView::
+updateViewScale()
+{
+  if (!_scene)
+    return;
+
+  _scene->setViewScale(transform().m11(),
+                       mapToScene(viewport()->rect()).boundingRect());
+}
+
+
 FlowScene *
 FlowView::
 scene()
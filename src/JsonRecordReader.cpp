@@ -0,0 +1,330 @@
+#include "JsonRecordReader.hpp"
+
+#include <QtCore/QIODevice>
+#include <QtCore/QJsonDocument>
+
+#include <stdexcept>
+
+using QtNodes::JsonRecordReader;
+
+namespace
+{
+
+bool
+isWhitespace(char c)
+{
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+[[noreturn]] void
+malformed()
+{
+  throw std::logic_error("Malformed JSON flow");
+}
+
+}
+
+
+JsonRecordReader::
+JsonRecordReader(QIODevice & device,
+                 std::size_t blockSize)
+  : _device(device)
+  , _blockSize(blockSize)
+{}
+
+
+bool
+JsonRecordReader::
+next()
+{
+  while (true)
+  {
+    switch (_state)
+    {
+      case State::Start:
+      {
+        skipWhitespace();
+
+        if (_pos == _block.size() && !fill())
+        {
+          _state = State::End;
+          return false;
+        }
+
+        expect('{');
+        _state = State::Members;
+        break;
+      }
+
+      case State::Members:
+      {
+        skipWhitespace();
+
+        char c = get();
+
+        if (c == '}')
+        {
+          _state = State::End;
+          return false;
+        }
+
+        if (c == ',')
+        {
+          skipWhitespace();
+          c = get();
+        }
+
+        if (c != '"')
+          malformed();
+
+        QByteArray key;
+        scanString(&key);
+        key.chop(1);
+
+        _key = QString::fromUtf8(key);
+
+        skipWhitespace();
+        expect(':');
+        skipWhitespace();
+
+        if (peek() == '[')
+        {
+          get();
+          _state = State::Records;
+        }
+        else
+        {
+          scanValue(nullptr);
+        }
+
+        break;
+      }
+
+      case State::Records:
+      {
+        skipWhitespace();
+
+        char const c = peek();
+
+        if (c == ']')
+        {
+          get();
+          _state = State::Members;
+          break;
+        }
+
+        if (c == ',')
+          get();
+
+        _text.clear();
+        scanValue(&_text);
+
+        return true;
+      }
+
+      case State::End:
+        return false;
+    }
+  }
+}
+
+
+QJsonObject
+JsonRecordReader::
+record() const
+{
+  QJsonParseError error;
+  QJsonDocument const document = QJsonDocument::fromJson(_text, &error);
+
+  if (error.error != QJsonParseError::NoError || !document.isObject())
+    throw std::logic_error("Malformed record in JSON flow");
+
+  return document.object();
+}
+
+
+bool
+JsonRecordReader::
+fill()
+{
+  _block = _device.read(static_cast<qint64>(_blockSize));
+  _pos   = 0;
+
+  return !_block.isEmpty();
+}
+
+
+char
+JsonRecordReader::
+peek()
+{
+  if (_pos == _block.size() && !fill())
+    throw std::logic_error("Truncated JSON flow");
+
+  return _block.at(_pos);
+}
+
+
+char
+JsonRecordReader::
+get()
+{
+  char const c = peek();
+  ++_pos;
+
+  return c;
+}
+
+
+void
+JsonRecordReader::
+skipWhitespace()
+{
+  while (_pos < _block.size() || fill())
+  {
+    if (!isWhitespace(_block.at(_pos)))
+      return;
+
+    ++_pos;
+  }
+}
+
+
+void
+JsonRecordReader::
+expect(char c)
+{
+  if (get() != c)
+    malformed();
+}
+
+
+void
+JsonRecordReader::
+scanString(QByteArray* out)
+{
+  bool escaped = false;
+
+  while (true)
+  {
+    if (_pos == _block.size() && !fill())
+      throw std::logic_error("Truncated JSON flow");
+
+    char const* data  = _block.constData();
+    int const   start = _pos;
+    int const   end   = _block.size();
+
+    bool closed = false;
+
+    for (; _pos < end; ++_pos)
+    {
+      char const c = data[_pos];
+
+      if (escaped)
+        escaped = false;
+      else if (c == '\\')
+        escaped = true;
+      else if (c == '"')
+      {
+        ++_pos;
+        closed = true;
+        break;
+      }
+    }
+
+    if (out)
+      out->append(data + start, _pos - start);
+
+    if (closed)
+      return;
+  }
+}
+
+
+void
+JsonRecordReader::
+scanValue(QByteArray* out)
+{
+  skipWhitespace();
+
+  char const first = peek();
+
+  if (first == '"')
+  {
+    get();
+
+    if (out)
+      out->append('"');
+
+    scanString(out);
+    return;
+  }
+
+  if (first != '{' && first != '[')
+  {
+    // number or literal, ending at the next delimiter
+    while (_pos < _block.size() || fill())
+    {
+      char const c = _block.at(_pos);
+
+      if (c == ',' || c == ']' || c == '}' || isWhitespace(c))
+        return;
+
+      if (out)
+        out->append(c);
+
+      ++_pos;
+    }
+
+    return;
+  }
+
+  // Objects and arrays are only checked for balanced nesting here; the
+  // record is fully validated when parsed.
+  int  depth    = 0;
+  bool inString = false;
+  bool escaped  = false;
+
+  while (true)
+  {
+    if (_pos == _block.size() && !fill())
+      throw std::logic_error("Truncated JSON flow");
+
+    char const* data  = _block.constData();
+    int const   start = _pos;
+    int const   end   = _block.size();
+
+    bool closed = false;
+
+    for (; _pos < end; ++_pos)
+    {
+      char const c = data[_pos];
+
+      if (inString)
+      {
+        if (escaped)
+          escaped = false;
+        else if (c == '\\')
+          escaped = true;
+        else if (c == '"')
+          inString = false;
+      }
+      else if (c == '"')
+        inString = true;
+      else if (c == '{' || c == '[')
+        ++depth;
+      else if ((c == '}' || c == ']') && --depth == 0)
+      {
+        ++_pos;
+        closed = true;
+        break;
+      }
+    }
+
+    if (out)
+      out->append(data + start, _pos - start);
+
+    if (closed)
+      return;
+  }
+}
@@ -1,7 +1,9 @@
 #include "Node.hpp"
 
 #include <QtCore/QObject>
+#include <QtCore/QTimer>
 
+#include <atomic>
 #include <utility>
 #include <iostream>
 
@@ -23,15 +25,42 @@ using QtNodes::NodeGraphicsObject;
 using QtNodes::PortIndex;
 using QtNodes::PortType;
 
+namespace
+{
+
+// Drawing every id from the system random source costs more than the
+// rest of creating a node. The random part is drawn once, the last eight
+// bytes count up, keeping the variant bits of a random UUID.
+QUuid
+nextId()
+{
+  static QUuid const base = QUuid::createUuid();
+  static std::atomic<quint64> counter{0};
+
+  quint64 const n = counter.fetch_add(1, std::memory_order_relaxed);
+
+  return QUuid(base.data1, base.data2, base.data3,
+               static_cast<uchar>(0x80 | ((n >> 56) & 0x3f)),
+               static_cast<uchar>(n >> 48),
+               static_cast<uchar>(n >> 40),
+               static_cast<uchar>(n >> 32),
+               static_cast<uchar>(n >> 24),
+               static_cast<uchar>(n >> 16),
+               static_cast<uchar>(n >> 8),
+               static_cast<uchar>(n));
+}
+
+}
+
 Node::
 Node(std::unique_ptr<NodeDataModel> && dataModel)
-  : _uid(QUuid::createUuid())
+  : _uid(nextId())
   , _nodeDataModel(std::move(dataModel))
   , _nodeState(_nodeDataModel)
   , _nodeGeometry(_nodeDataModel)
   , _nodeGraphicsObject(nullptr)
 {
-  _nodeGeometry.recalculateSize();
+  // The geometry is computed when the graphics object gets attached.
 
   // propagate data: model => node
   connect(_nodeDataModel.get(), &NodeDataModel::dataUpdated,
@@ -51,7 +80,7 @@ save() const
 {
   QJsonObject nodeJson;
 
-  nodeJson["id"] = _uid.toString();
+  nodeJson["id"] = id().toString();
 
   nodeJson["model"] = _nodeDataModel->save();
 
@@ -79,14 +108,6 @@ restore(QJsonObject const& json)
 }
 
 
-QUuid
-Node::
-id() const
-{
-  return _uid;
-}
-
-
 void
 Node::
 reactToPossibleConnection(PortType reactingPortType,
@@ -192,6 +213,7 @@ propagateData(std::shared_ptr<NodeData> nodeData,
   //Recalculate the nodes visuals. A data change can result in the node taking more space than before, so this forces a recalculate+repaint on the affected node
   _nodeGraphicsObject->setGeometryChanged();
   _nodeGeometry.recalculateSize();
+  _nodeGraphicsObject->refreshCacheMode();
   _nodeGraphicsObject->update();
   _nodeGraphicsObject->moveConnections();
 }
@@ -201,13 +223,103 @@ void
 Node::
 onDataUpdated(PortIndex index)
 {
-  auto nodeData = _nodeDataModel->outData(index);
+  using Mode = NodeDataModel::DeliveryPolicy::Mode;
+
+  auto const policy = _nodeDataModel->portOutDeliveryPolicy(index);
+
+  if (policy.mode == Mode::Immediate || index < 0)
+  {
+    deliverData(index);
+    return;
+  }
+
+  if (_deliveries.size() <= static_cast<std::size_t>(index))
+    _deliveries.resize(index + 1);
+
+  PendingDelivery & delivery = _deliveries[index];
+
+  delivery.pending = true;
+
+  if (delivery.scheduled)
+    return;
+
+  int delay = 0;
+
+  if (policy.mode == Mode::RateLimited && policy.maxRate > 0.0)
+  {
+    qint64 const interval = static_cast<qint64>(1000.0 / policy.maxRate);
+
+    qint64 const elapsed = delivery.lastDelivery.isValid() ?
+                           delivery.lastDelivery.elapsed() :
+                           interval;
+
+    // The first update after a quiet period goes through right away.
+    if (elapsed >= interval)
+    {
+      deliverData(index);
+      return;
+    }
+
+    delay = static_cast<int>(interval - elapsed);
+  }
 
-  auto connections =
-    _nodeState.connections(PortType::Out, index);
+  delivery.scheduled = true;
 
-  for (auto const & c : connections)
-    c.second->propagateData(nodeData);
+  QTimer::singleShot(delay, this, [this, index]() { onDeliveryTimeout(index); });
+}
+
+
+void
+Node::
+onOutputConnected(PortIndex index)
+{
+  if (index < 0 || static_cast<std::size_t>(index) >= _deliveries.size())
+  {
+    deliverData(index);
+    return;
+  }
+
+  QElapsedTimer const lastDelivery = _deliveries[index].lastDelivery;
+
+  deliverData(index);
+
+  _deliveries[index].lastDelivery = lastDelivery;
+}
+
+
+void
+Node::
+onDeliveryTimeout(PortIndex index)
+{
+  PendingDelivery & delivery = _deliveries[index];
+
+  delivery.scheduled = false;
+
+  if (delivery.pending)
+    deliverData(index);
+}
+
+
+void
+Node::
+deliverData(PortIndex index)
+{
+  if (static_cast<std::size_t>(index) < _deliveries.size())
+  {
+    _deliveries[index].pending = false;
+    _deliveries[index].lastDelivery.start();
+  }
+
+  auto nodeData = _nodeDataModel->outData(index);
+
+  // Indexed on purpose: a downstream model may connect or disconnect
+  // this port while data is being propagated.
+  for (std::size_t i = 0;
+       i < _nodeState.connections(PortType::Out, index).size();
+       ++i)
+  {
+    _nodeState.connections(PortType::Out, index)[i]->propagateData(nodeData);
+  }
 }
 
 void
@@ -219,13 +331,18 @@ onNodeSizeUpdated()
         nodeDataModel()->embeddedWidget()->adjustSize();
     }
     nodeGeometry().recalculateSize();
+
+    if (_nodeGraphicsObject)
+        _nodeGraphicsObject->refreshCacheMode();
+
+    NodeState const & state = _nodeState;
+
     for(PortType type: {PortType::In, PortType::Out})
     {
-        for(auto& conn_set : nodeState().getEntries(type))
+        for(auto const & conn_set : state.getEntries(type))
         {
-            for(auto& pair: conn_set)
+            for(Connection* conn: conn_set)
             {
-                Connection* conn = pair.second;
                 conn->getConnectionGraphicsObject().move();
             }
         }
@@ -62,6 +62,14 @@ canConnect(PortIndex &portIndex, TypeConverter & converter) const
   if (!nodePortIsEmpty(requiredPort, portIndex))
     return false;
 
+  // 3.5) The connection must not close a cycle
+
+  Node const & outNode = (requiredPort == PortType::In) ? *node : *_node;
+  Node const & inNode  = (requiredPort == PortType::In) ? *_node : *node;
+
+  if (_scene->wouldCreateCycle(outNode, inNode))
+    return false;
+
   // 4) Connection type equals node port type, or there is a registered type conversion that can translate between the two
 
   auto connectionDataType =
@@ -129,7 +137,7 @@ tryConnect() const
   if (outNode)
   {
     PortIndex outPortIndex = _connection->getPortIndex(PortType::Out);
-    outNode->onDataUpdated(outPortIndex);
+    outNode->onOutputConnected(outPortIndex);
   }
 
   return true;
@@ -149,7 +157,7 @@ disconnect(PortType portToDisconnect) const
   NodeState &state = _node->nodeState();
 
   // clear pointer to Connection in the NodeState
-  state.getEntries(portToDisconnect)[portIndex].clear();
+  state.clearConnections(portToDisconnect, portIndex);
 
   // 4) Propagate invalid data to IN node
   _connection->propagateEmptyData();
@@ -24,6 +24,7 @@ public:
   /// 1) Connection 'requires' a port
   /// 2) Connection's vacant end is above the node port
   /// 3) Node port is vacant
+  /// 3.5) The connection does not close a cycle
   /// 4) Connection type equals node port type, or there is a registered type conversion that can translate between the two
   bool canConnect(PortIndex & portIndex, 
                   TypeConverter & converter) const;
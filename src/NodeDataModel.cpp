@@ -1,7 +1,9 @@
 #include "NodeDataModel.hpp"
 
+#include "BlobStore.hpp"
 #include "StyleCollection.hpp"
 
+using QtNodes::BlobStore;
 using QtNodes::NodeDataModel;
 using QtNodes::NodeStyle;
 
@@ -39,3 +41,11 @@ setNodeStyle(NodeStyle const& style)
 {
   _nodeStyle = style;
 }
+
+
+void
+NodeDataModel::
+setBlobStore(std::shared_ptr<BlobStore> blobStore)
+{
+  _blobStore = std::move(blobStore);
+}
@@ -1,6 +1,5 @@
 #include "NodeGraphicsObject.hpp"
 
-#include <iostream>
 #include <cstdlib>
 
 
@@ -19,7 +18,6 @@
 #include "NodeConnectionInteraction.hpp"
 
 #include "StyleCollection.hpp"
-#include <ctime>
 
 using QtNodes::NodeGraphicsObject;
 using QtNodes::Node;
@@ -33,8 +31,9 @@ NodeGraphicsObject(FlowScene &scene,
   , _node(node)
   , _locked(false)
   , _proxyWidget(nullptr)
+  , _cachePolicyEpoch(scene.cachePolicyEpoch() - 1)
 {
-  _scene.addItem(this);
+  // FlowScene adds the item once the node is set up.
 
   setFlag(QGraphicsItem::ItemDoesntPropagateOpacityToChildren, true);
   setFlag(QGraphicsItem::ItemIsMovable, true);
@@ -64,58 +63,15 @@ NodeGraphicsObject(FlowScene &scene,
 
   embedQWidget();
 
-  // connect to the move signals to emit the move signals in FlowScene
-  auto onMoveSlot = [this] {
-    _scene.nodeMoved(_node, pos());
-  };
-  connect(this, &QGraphicsObject::xChanged, this, onMoveSlot);
-  connect(this, &QGraphicsObject::yChanged, this, onMoveSlot);
-
-  //gzl
-  connect(&scene, &FlowScene::scale_param_intern1, this, &NodeGraphicsObject::reset_cache_mode);
-
+  // FlowScene picks the cache mode once the item is in the scene
 }
 
-//gzl
-void
-NodeGraphicsObject::reset_cache_mode(float scale_param_height){
-    //获取需要生成的模块矩形的长和宽
-    int h=this->boundingRect().height();
-//    int w=this->boundingRect().width();
-//    float h=scale_param_height;
-    std::cout<<"\nheight: "<<h<<std::endl;
-    std::cout<<"\nscale_param_height: "<<scale_param_height<<std::endl;
-    std::cout<<"\ntime: "<<std::time(0)<<std::endl;
-
-
-  //  scene.views().at(0)
-    //根据模块尺寸选择显示模式
-    //添加放大倍数判断
-    if((h>1000) || (scale_param_height>1)){
-        //  无缓存模式，显示完全且清晰，不做缓存，然后每次都会重新绘制
-          QGraphicsItem::setCacheMode(QGraphicsItem::NoCache);
-          std::cout<<"\nmode_no_cache"<<std::endl;
-    }
-    else{
-        //高质量模式，但是会有过长的模块显示不全的问题
-        QGraphicsItem::setCacheMode( QGraphicsItem::DeviceCoordinateCache );
-        std::cout<<"\nmode_device_coordinate_cache"<<std::endl;
-    }
-
-
-    ////  低质量模式，像素很渣，但是能显示全從
-    ////   设置模块显示的固定像素大小
-    //  auto size = QSize(NodeGraphicsObject::boundingRect().width()*2,
-    //                    NodeGraphicsObject::boundingRect().height()*2);
-    //  std::cout<<"\nQsize"<<size.rheight()<<" "<<size.rwidth()<<std::endl;
-    //  setCacheMode( QGraphicsItem::ItemCoordinateCache, size);
-  }
-
 
 NodeGraphicsObject::
 ~NodeGraphicsObject()
 {
-  _scene.removeItem(this);
+  if (scene())
+    _scene.removeItem(this);
 }
 
 
@@ -183,6 +139,43 @@ setGeometryChanged()
 }
 
 
+bool
+NodeGraphicsObject::
+updateCacheMode()
+{
+  if (cacheModeCurrent())
+    return false;
+
+  _cachePolicyEpoch = _scene.cachePolicyEpoch();
+
+  setCacheMode(_scene.nodeCacheMode(boundingRect()));
+
+  return true;
+}
+
+
+bool
+NodeGraphicsObject::
+cacheModeCurrent() const
+{
+  return _cachePolicyEpoch == _scene.cachePolicyEpoch();
+}
+
+
+void
+NodeGraphicsObject::
+refreshCacheMode()
+{
+  if (!cacheModeCurrent())
+    return;
+
+  QGraphicsItem::CacheMode const mode = _scene.nodeCacheMode(boundingRect());
+
+  if (mode != cacheMode())
+    setCacheMode(mode);
+}
+
+
 void
 NodeGraphicsObject::
 moveConnections() const
@@ -196,8 +189,8 @@ moveConnections() const
 
     for (auto const & connections : connectionEntries)
     {
-      for (auto & con : connections)
-        con.second->getConnectionGraphicsObject().move();
+      for (Connection* con : connections)
+        con->getConnectionGraphicsObject().move();
     }
   }
 }
@@ -235,6 +228,10 @@ itemChange(GraphicsItemChange change, const QVariant &value)
   {
     moveConnections();
   }
+  else if (change == ItemScenePositionHasChanged)
+  {
+    _scene.scheduleNodeMoved(_node);
+  }
 
   return QGraphicsItem::itemChange(change, value);
 }
@@ -269,13 +266,13 @@ mousePressEvent(QGraphicsSceneMouseEvent * event)
     {
       NodeState const & nodeState = _node.nodeState();
 
-      std::unordered_map<QUuid, Connection*> connections =
+      NodeState::ConnectionSpan connections =
         nodeState.connections(portToCheck, portIndex);
 
       // start dragging existing connection
       if (!connections.empty() && portToCheck == PortType::In)
       {
-        auto con = connections.begin()->second;
+        auto con = connections.front();
 
         NodeConnectionInteraction interaction(_node, *con, _scene);
 
@@ -289,7 +286,7 @@ mousePressEvent(QGraphicsSceneMouseEvent * event)
           if (!connections.empty() &&
               outPolicy == NodeDataModel::ConnectionPolicy::One)
           {
-            _scene.deleteConnection( *connections.begin()->second );
+            _scene.deleteConnection( *connections.front() );
           }
         }
 
@@ -346,6 +343,7 @@ mouseMoveEvent(QGraphicsSceneMouseEvent * event)
       _proxyWidget->setPos(geom.widgetPosition());
 
       geom.recalculateSize();
+      refreshCacheMode();
       update();
 
       moveConnections();
@@ -153,11 +153,11 @@ drawConnectionPoints(QPainter* painter,
                 {
                     if (portType == PortType::In)
                     {
-                        typeConvertable = scene.registry().getTypeConverter(state.reactingDataType(), dataType) != nullptr;
+                        typeConvertable = scene.registry().findTypeConverter(state.reactingDataType(), dataType) != nullptr;
                     }
                     else
                     {
-                        typeConvertable = scene.registry().getTypeConverter(dataType, state.reactingDataType()) != nullptr;
+                        typeConvertable = scene.registry().findTypeConverter(dataType, state.reactingDataType()) != nullptr;
                     }
                 }
 
@@ -1,5 +1,7 @@
 #include "NodeState.hpp"
 
+#include <algorithm>
+
 #include "Node.hpp"
 
 #include "NodeDataModel.hpp"
@@ -46,13 +48,11 @@ getEntries(PortType portType)
 }
 
 
-NodeState::ConnectionPtrSet
+NodeState::ConnectionSpan
 NodeState::
 connections(PortType portType, PortIndex portIndex) const
 {
-    auto const &connections = getEntries(portType);
-
-    return connections[portIndex];
+    return getEntries(portType)[portIndex].view();
 }
 
 
@@ -62,10 +62,13 @@ setConnection(PortType portType,
               PortIndex portIndex,
               Connection& connection)
 {
-    auto &connections = getEntries(portType);
+    auto &connections = getEntries(portType).at(portIndex);
 
-    connections.at(portIndex).insert(std::make_pair(connection.id(),
-                                                    &connection));
+    if (std::find(connections.begin(), connections.end(), &connection) == connections.end())
+    {
+        connections.push_back(&connection);
+        _ordinalsDirty = true;
+    }
 }
 
 
@@ -73,9 +76,32 @@ void
 NodeState::
 eraseConnection(PortType portType,
                 PortIndex portIndex,
-                QUuid id)
+                Connection const& connection)
+{
+    auto &connections = getEntries(portType)[portIndex];
+
+    auto it = std::find(connections.begin(), connections.end(), &connection);
+
+    if (it != connections.end())
+    {
+        connections.erase(it);
+        _ordinalsDirty = true;
+    }
+}
+
+
+void
+NodeState::
+clearConnections(PortType portType,
+                 PortIndex portIndex)
 {
-    getEntries(portType)[portIndex].erase(id);
+    auto &connections = getEntries(portType)[portIndex];
+
+    if (!connections.empty())
+    {
+        connections.clear();
+        _ordinalsDirty = true;
+    }
 }
 
 
@@ -145,27 +171,10 @@ resizing() const
  * @param con
  */
 void NodeState::layoutConnections( Connection &con, const QPointF &outp,const QPointF &inp){
-    std::vector<Connection *> currentNodeConnections;
+    PortType portType = routingPortType();
 
-    //将当前Node的输出端点汇总到一起
-    std::vector<ConnectionPtrSet> vcpsin = getEntries(PortType::In);
-    std::vector<ConnectionPtrSet> vcpsout = getEntries(PortType::Out);
-    std::vector<ConnectionPtrSet> vcps;
-    PortType portType;
-    if(vcpsout.size()>=vcpsin.size()){
-        vcps = vcpsout;
-        portType = PortType::Out;
-    }else{
-        vcps = vcpsin;
-        portType = PortType::In;
-    }
-
-    for(ConnectionPtrSet cps:vcps){
-        for(std::pair<QUuid,Connection *> kv:cps)
-        {
-            currentNodeConnections.push_back(kv.second);
-        }
-    }
+    if (_ordinalsDirty)
+        updateOrdinals();
 
     ConnectionGeometry &cg = con.connectionGeometry();
 
@@ -173,7 +182,7 @@ void NodeState::layoutConnections( Connection &con, const QPointF &outp,const QP
     double horizontalSpace = std::abs((inp.x() - cg.TURNING_LINE_PADDING)
             - (outp.x() + cg.TURNING_LINE_PADDING));
     //计算每个位置的间隔
-    double splitSpace = horizontalSpace/(currentNodeConnections.size()+2);
+    double splitSpace = horizontalSpace/(_ordinals.size()+2);
 
     QList<QPointF> points;
     QList<QPointF> conPoints = con.connectionGeometry().getPoints();
@@ -204,30 +213,37 @@ void NodeState::layoutConnections( Connection &con, const QPointF &outp,const QP
  * @param con
  * @return
  */
-int NodeState::connectionIndex(Connection &con){
-    std::vector<Connection *> currentNodeConnections;
-    //将当前Node的输出端点汇总到一起
-    std::vector<ConnectionPtrSet> vcpsin = getEntries(PortType::In);
-    std::vector<ConnectionPtrSet> vcpsout = getEntries(PortType::Out);
-    std::vector<ConnectionPtrSet> vcps;
-    if(vcpsout.size()>=vcpsin.size()){
-        vcps = vcpsout;
-    }else{
-        vcps = vcpsin;
-    }
+int NodeState::connectionIndex(Connection const &con) const{
+    if (_ordinalsDirty)
+        updateOrdinals();
 
-    for(ConnectionPtrSet cps:vcps){
-        for(std::pair<QUuid,Connection *> kv:cps)
-        {
-            currentNodeConnections.push_back(kv.second);
-        }
-    }
+    auto it = _ordinals.find(&con);
+
+    return (it != _ordinals.end()) ? it->second : 0;
+}
+
+
+PortType
+NodeState::
+routingPortType() const
+{
+    return (_outConnections.size() >= _inConnections.size()) ? PortType::Out : PortType::In;
+}
+
+
+void
+NodeState::
+updateOrdinals() const
+{
+    //将当前Node的输出端点汇总到一起
+    _ordinals.clear();
 
-    if(currentNodeConnections.size()<=0) return 0;
-    for(int i=1;i<=currentNodeConnections.size();i++){
-        if(currentNodeConnections.at(i-1)->id()==con.id())
-            return i;
+    int ordinal = 0;
+    for (auto const & connections : getEntries(routingPortType()))
+    {
+        for (Connection * c : connections)
+            _ordinals.emplace(c, ++ordinal);
     }
 
-    return 0;
+    _ordinalsDirty = false;
 }
@@ -0,0 +1,185 @@
+#include "ObjectPool.hpp"
+
+#include <mutex>
+#include <vector>
+
+#if defined(__SANITIZE_ADDRESS__)
+#  include <sanitizer/asan_interface.h>
+#  define NODE_EDITOR_POISON(p, size)   ASAN_POISON_MEMORY_REGION(p, size)
+#  define NODE_EDITOR_UNPOISON(p, size) ASAN_UNPOISON_MEMORY_REGION(p, size)
+#else
+#  define NODE_EDITOR_POISON(p, size)   static_cast<void>(0)
+#  define NODE_EDITOR_UNPOISON(p, size) static_cast<void>(0)
+#endif
+
+using QtNodes::ObjectPool;
+
+constexpr std::size_t ObjectPool::MaxPooledSize;
+constexpr std::size_t ObjectPool::Alignment;
+
+namespace
+{
+
+constexpr std::size_t ClassCount = ObjectPool::MaxPooledSize / ObjectPool::Alignment;
+
+constexpr std::size_t ChunkSize = std::size_t(64) << 10;
+
+
+std::size_t
+classIndex(std::size_t size)
+{
+  return (size == 0) ? 0 : (size - 1) / ObjectPool::Alignment;
+}
+
+
+std::size_t
+classSize(std::size_t index)
+{
+  return (index + 1) * ObjectPool::Alignment;
+}
+
+
+struct FreeBlock
+{
+  FreeBlock* next;
+};
+
+}
+
+
+struct ObjectPool::State
+{
+  mutable std::mutex mutex;
+
+  Statistics statistics;
+
+  FreeBlock* freeLists[ClassCount] = {};
+
+  std::vector<unsigned char*> chunks;
+
+  ~State()
+  {
+    for (unsigned char* chunk : chunks)
+      ::operator delete(chunk);
+  }
+
+  // carves a new chunk into blocks of one size class
+  void
+  grow(std::size_t index)
+  {
+    std::size_t const blockSize = classSize(index);
+    std::size_t const count     = ChunkSize / blockSize;
+
+    auto chunk = static_cast<unsigned char*>(::operator new(count * blockSize));
+    chunks.push_back(chunk);
+
+    ++statistics.systemAllocations;
+    statistics.bytesReserved += count * blockSize;
+
+    for (std::size_t i = count; i-- > 0;)
+    {
+      auto block = reinterpret_cast<FreeBlock*>(chunk + i * blockSize);
+      block->next = freeLists[index];
+      freeLists[index] = block;
+    }
+
+    NODE_EDITOR_POISON(chunk, count * blockSize);
+  }
+};
+
+
+ObjectPool::
+ObjectPool()
+  : _state(new State)
+{}
+
+
+ObjectPool::
+~ObjectPool() = default;
+
+
+void*
+ObjectPool::
+allocate(std::size_t size)
+{
+  State & state = *_state;
+
+  if (size > MaxPooledSize)
+  {
+    void* p = ::operator new(size);
+
+    std::lock_guard<std::mutex> lock(state.mutex);
+    ++state.statistics.systemAllocations;
+
+    return p;
+  }
+
+  std::size_t const index = classIndex(size);
+
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  if (!state.freeLists[index])
+    state.grow(index);
+
+  FreeBlock* block = state.freeLists[index];
+
+  NODE_EDITOR_UNPOISON(block, classSize(index));
+
+  state.freeLists[index] = block->next;
+
+  ++state.statistics.allocations;
+  ++state.statistics.blocksInUse;
+
+  return block;
+}
+
+
+void
+ObjectPool::
+deallocate(void* p, std::size_t size) noexcept
+{
+  if (!p)
+    return;
+
+  if (size > MaxPooledSize)
+  {
+    ::operator delete(p);
+    return;
+  }
+
+  State & state = *_state;
+
+  std::size_t const index = classIndex(size);
+
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  auto block = static_cast<FreeBlock*>(p);
+  block->next = state.freeLists[index];
+  state.freeLists[index] = block;
+
+  NODE_EDITOR_POISON(block, classSize(index));
+
+  ++state.statistics.deallocations;
+  --state.statistics.blocksInUse;
+}
+
+
+ObjectPool::Statistics
+ObjectPool::
+statistics() const
+{
+  std::lock_guard<std::mutex> lock(_state->mutex);
+
+  return _state->statistics;
+}
+
+
+ObjectPool&
+ObjectPool::
+instance()
+{
+  // intentionally leaked, see the declaration
+  static ObjectPool* pool = new ObjectPool;
+
+  return *pool;
+}
@@ -0,0 +1,660 @@
+#include "ReachabilityIndex.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+using QtNodes::ReachabilityIndex;
+using QtNodes::TopologicalOrder;
+
+constexpr std::size_t ReachabilityIndex::ClosureLimit;
+constexpr std::size_t ReachabilityIndex::IncrementalEdgeLimit;
+constexpr int ReachabilityIndex::LabelCount;
+
+namespace
+{
+
+// index of the lowest set bit, `bits` must not be zero
+unsigned
+lowestBit(std::uint64_t bits)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, bits);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+}
+
+}
+
+
+ReachabilityIndex::
+ReachabilityIndex(TopologicalOrder const & graph)
+  : _graph(graph)
+{}
+
+
+void
+ReachabilityIndex::
+vertexAdded(Vertex v)
+{
+  std::size_t const bound = _graph.vertexBound();
+
+  switch (_mode)
+  {
+    case Mode::Invalid:
+      break;
+
+    case Mode::Closure:
+      if (bound > ClosureLimit)
+      {
+        invalidate();
+        break;
+      }
+
+      growClosure();
+
+      // a reused slot keeps nothing of its previous vertex
+      std::fill(row(_descendants, v), row(_descendants, v) + _words, 0);
+      std::fill(row(_ancestors, v), row(_ancestors, v) + _words, 0);
+      break;
+
+    case Mode::Labels:
+    {
+      // An isolated vertex numbered after all others: its labels neither
+      // contain nor are contained in any other.
+      _labels.resize(std::max(_labels.size(), bound * LabelCount), Label{0, 0});
+      _visitMark.resize(std::max(_visitMark.size(), bound), 0);
+
+      ++_postCount;
+
+      for (int k = 0; k < LabelCount; ++k)
+        _labels[v * LabelCount + k] = Label{_postCount, _postCount};
+
+      break;
+    }
+  }
+}
+
+
+void
+ReachabilityIndex::
+edgeAdded(Vertex from, Vertex to)
+{
+  if (_mode != Mode::Closure)
+  {
+    // labels are not updated in place
+    invalidate();
+    return;
+  }
+
+  if (std::max(from, to) >= closureRows())
+  {
+    invalidate();
+    return;
+  }
+
+  if (testBit(row(_descendants, from), to))
+    return;
+
+  // Everything reaching `from` now reaches everything reachable from `to`.
+  std::vector<std::uint64_t> upstream(row(_ancestors, from),
+                                      row(_ancestors, from) + _words);
+  setBit(upstream.data(), from);
+
+  std::vector<std::uint64_t> downstream(row(_descendants, to),
+                                        row(_descendants, to) + _words);
+  setBit(downstream.data(), to);
+
+  for (std::size_t w = 0; w < _words; ++w)
+  {
+    for (std::uint64_t bits = upstream[w]; bits; bits &= bits - 1)
+    {
+      Vertex const a = static_cast<Vertex>(w * 64 + lowestBit(bits));
+
+      std::uint64_t* target = row(_descendants, a);
+      for (std::size_t i = 0; i < _words; ++i)
+        target[i] |= downstream[i];
+    }
+
+    for (std::uint64_t bits = downstream[w]; bits; bits &= bits - 1)
+    {
+      Vertex const d = static_cast<Vertex>(w * 64 + lowestBit(bits));
+
+      std::uint64_t* target = row(_ancestors, d);
+      for (std::size_t i = 0; i < _words; ++i)
+        target[i] |= upstream[i];
+    }
+  }
+}
+
+
+void
+ReachabilityIndex::
+edgesAdded(std::vector<std::pair<Vertex, Vertex>> const & edges)
+{
+  if (edges.size() > IncrementalEdgeLimit)
+  {
+    invalidate();
+    return;
+  }
+
+  for (auto const & edge : edges)
+    edgeAdded(edge.first, edge.second);
+}
+
+
+void
+ReachabilityIndex::
+edgeRemoved(Vertex from, Vertex to)
+{
+  // labels of the larger graph still hold, see the class comment
+  if (_mode != Mode::Closure)
+    return;
+
+  if (std::max(from, to) >= closureRows())
+  {
+    invalidate();
+    return;
+  }
+
+  // Nothing changes while `from` reaches `to` through a parallel edge or
+  // another successor.
+  for (Vertex s : _graph.successors(from))
+  {
+    if (s == to || testBit(row(_descendants, s), to))
+      return;
+  }
+
+  recomputeAround({ from }, { to });
+}
+
+
+void
+ReachabilityIndex::
+edgesRemoved(std::vector<std::pair<Vertex, Vertex>> const & edges)
+{
+  if (_mode != Mode::Closure || edges.empty())
+    return;
+
+  if (edges.size() > IncrementalEdgeLimit)
+  {
+    invalidate();
+    return;
+  }
+
+  std::vector<Vertex> sources;
+  std::vector<Vertex> targets;
+
+  for (auto const & edge : edges)
+  {
+    if (std::max(edge.first, edge.second) >= closureRows())
+    {
+      invalidate();
+      return;
+    }
+
+    sources.push_back(edge.first);
+    targets.push_back(edge.second);
+  }
+
+  recomputeAround(sources, targets);
+}
+
+
+void
+ReachabilityIndex::
+recomputeAround(std::vector<Vertex> const & sources,
+                std::vector<Vertex> const & targets)
+{
+  // `vertices` plus the ones set in their rows of `rows`, each once
+  auto closureOf = [this](std::vector<Vertex> const & vertices,
+                          std::vector<std::uint64_t> const & rows)
+  {
+    std::vector<std::uint64_t> bits(_words, 0);
+
+    for (Vertex v : vertices)
+    {
+      std::uint64_t const* source = row(rows, v);
+      for (std::size_t i = 0; i < _words; ++i)
+        bits[i] |= source[i];
+
+      setBit(bits.data(), v);
+    }
+
+    std::vector<Vertex> result;
+
+    for (std::size_t w = 0; w < _words; ++w)
+    {
+      for (std::uint64_t word = bits[w]; word; word &= word - 1)
+        result.push_back(static_cast<Vertex>(w * 64 + lowestBit(word)));
+    }
+
+    return result;
+  };
+
+  // Only the sources and what is upstream of them lose descendants, and
+  // only the targets and what is downstream of them lose ancestors. The
+  // rows are recomputed from the current edges, downstream vertices first
+  // for the descendants and upstream ones first for the ancestors, so
+  // that the rows they are made of are current. Removed vertices are left
+  // with empty rows.
+  std::vector<Vertex> upstream   = closureOf(sources, _ancestors);
+  std::vector<Vertex> downstream = closureOf(targets, _descendants);
+
+  auto const removed = [this](Vertex v) { return !_graph.contains(v); };
+
+  for (Vertex v : upstream)
+  {
+    if (removed(v))
+      std::fill(row(_descendants, v), row(_descendants, v) + _words, 0);
+  }
+
+  for (Vertex v : downstream)
+  {
+    if (removed(v))
+      std::fill(row(_ancestors, v), row(_ancestors, v) + _words, 0);
+  }
+
+  upstream.erase(std::remove_if(upstream.begin(), upstream.end(), removed),
+                 upstream.end());
+  downstream.erase(std::remove_if(downstream.begin(), downstream.end(), removed),
+                   downstream.end());
+
+  std::sort(upstream.begin(), upstream.end(),
+            [this](Vertex a, Vertex b) { return _graph.precedes(b, a); });
+
+  for (Vertex u : upstream)
+  {
+    std::uint64_t* target = row(_descendants, u);
+    std::fill(target, target + _words, 0);
+
+    for (Vertex s : _graph.successors(u))
+    {
+      std::uint64_t const* source = row(_descendants, s);
+      for (std::size_t i = 0; i < _words; ++i)
+        target[i] |= source[i];
+
+      setBit(target, s);
+    }
+  }
+
+  std::sort(downstream.begin(), downstream.end(),
+            [this](Vertex a, Vertex b) { return _graph.precedes(a, b); });
+
+  for (Vertex d : downstream)
+  {
+    std::uint64_t* target = row(_ancestors, d);
+    std::fill(target, target + _words, 0);
+
+    for (Vertex p : _graph.predecessors(d))
+    {
+      std::uint64_t const* source = row(_ancestors, p);
+      for (std::size_t i = 0; i < _words; ++i)
+        target[i] |= source[i];
+
+      setBit(target, p);
+    }
+  }
+}
+
+
+void
+ReachabilityIndex::
+vertexRemoved(Vertex v)
+{
+  // A removed vertex is not queried and its slot is reset when reused, see
+  // vertexAdded(). Once its edges are reported, its closure rows are empty
+  // and no other row has its bit; anything left means they were not.
+  if (_mode != Mode::Closure || v >= closureRows())
+    return;
+
+  auto const isSet = [](std::uint64_t word) { return word != 0; };
+
+  if (std::any_of(row(_descendants, v), row(_descendants, v) + _words, isSet) ||
+      std::any_of(row(_ancestors, v), row(_ancestors, v) + _words, isSet))
+    invalidate();
+}
+
+
+void
+ReachabilityIndex::
+invalidate()
+{
+  _mode = Mode::Invalid;
+}
+
+
+bool
+ReachabilityIndex::
+reaches(Vertex from, Vertex to) const
+{
+  if (!_graph.contains(from) || !_graph.contains(to))
+    return false;
+
+  if (from == to)
+    return true;
+
+  // a vertex never reaches anything positioned before it
+  if (!_graph.precedes(from, to))
+    return false;
+
+  ensureBuilt();
+
+  if (_mode == Mode::Closure)
+    return testBit(row(_descendants, from), to);
+
+  if (!labelsContain(from, to))
+    return false;
+
+  // Search the region between both vertices, skipping everything whose
+  // labels or position rule it out.
+  if (++_searchEpoch == 0)
+  {
+    std::fill(_visitMark.begin(), _visitMark.end(), 0);
+    _searchEpoch = 1;
+  }
+
+  std::vector<Vertex> stack{from};
+  _visitMark[from] = _searchEpoch;
+
+  while (!stack.empty())
+  {
+    Vertex const u = stack.back();
+    stack.pop_back();
+
+    for (Vertex w : _graph.successors(u))
+    {
+      if (w == to)
+        return true;
+
+      if (_visitMark[w] == _searchEpoch ||
+          !_graph.precedes(w, to) ||
+          !labelsContain(w, to))
+        continue;
+
+      _visitMark[w] = _searchEpoch;
+      stack.push_back(w);
+    }
+  }
+
+  return false;
+}
+
+
+std::vector<ReachabilityIndex::Vertex>
+ReachabilityIndex::
+descendants(Vertex v) const
+{
+  return collect(v, true);
+}
+
+
+std::vector<ReachabilityIndex::Vertex>
+ReachabilityIndex::
+ancestors(Vertex v) const
+{
+  return collect(v, false);
+}
+
+
+bool
+ReachabilityIndex::
+usesClosure() const
+{
+  ensureBuilt();
+
+  return _mode == Mode::Closure;
+}
+
+
+void
+ReachabilityIndex::
+ensureBuilt() const
+{
+  if (_mode != Mode::Invalid)
+    return;
+
+  ++_buildCount;
+
+  if (_graph.vertexBound() <= ClosureLimit)
+  {
+    _labels.clear();
+    buildClosure();
+    _mode = Mode::Closure;
+  }
+  else
+  {
+    _descendants.clear();
+    _ancestors.clear();
+    buildLabels();
+    _mode = Mode::Labels;
+  }
+}
+
+
+void
+ReachabilityIndex::
+buildClosure() const
+{
+  std::size_t const bound = _graph.vertexBound();
+
+  _words = (bound + 63) / 64;
+
+  _descendants.assign(bound * _words, 0);
+  _ancestors.assign(bound * _words, 0);
+
+  std::vector<Vertex> const order = _graph.order();
+
+  // descendants of a vertex are its successors and their descendants
+  for (auto it = order.rbegin(); it != order.rend(); ++it)
+  {
+    std::uint64_t* target = row(_descendants, *it);
+
+    for (Vertex s : _graph.successors(*it))
+    {
+      std::uint64_t const* source = row(_descendants, s);
+      for (std::size_t i = 0; i < _words; ++i)
+        target[i] |= source[i];
+
+      setBit(target, s);
+    }
+  }
+
+  for (Vertex v : order)
+  {
+    std::uint64_t* target = row(_ancestors, v);
+
+    for (Vertex p : _graph.predecessors(v))
+    {
+      std::uint64_t const* source = row(_ancestors, p);
+      for (std::size_t i = 0; i < _words; ++i)
+        target[i] |= source[i];
+
+      setBit(target, p);
+    }
+  }
+}
+
+
+void
+ReachabilityIndex::
+growClosure()
+{
+  std::size_t const bound = _graph.vertexBound();
+
+  if (bound > _words * 64)
+  {
+    // wider rows, doubled so that a run of additions moves them rarely
+    std::size_t const words =
+      std::min(std::max(2 * _words, (bound + 63) / 64), (ClosureLimit + 63) / 64);
+
+    std::size_t const rows = closureRows();
+
+    std::vector<std::uint64_t> descendants(bound * words, 0);
+    std::vector<std::uint64_t> ancestors(bound * words, 0);
+
+    for (std::size_t v = 0; v < rows; ++v)
+    {
+      std::copy(row(_descendants, v), row(_descendants, v) + _words,
+                descendants.data() + v * words);
+      std::copy(row(_ancestors, v), row(_ancestors, v) + _words,
+                ancestors.data() + v * words);
+    }
+
+    _words       = words;
+    _descendants = std::move(descendants);
+    _ancestors   = std::move(ancestors);
+  }
+  else if (bound > closureRows())
+  {
+    _descendants.resize(bound * _words, 0);
+    _ancestors.resize(bound * _words, 0);
+  }
+}
+
+
+void
+ReachabilityIndex::
+buildLabels() const
+{
+  std::size_t const bound = _graph.vertexBound();
+
+  _labels.assign(bound * LabelCount, Label{0, 0});
+  _visitMark.assign(bound, 0);
+  _searchEpoch = 0;
+
+  std::vector<Vertex> const order = _graph.order();
+
+  // Each labelling is a post-order numbering of a depth first traversal;
+  // `low` is the smallest number found below the vertex. The second
+  // traversal visits the children in reverse, which makes the labels
+  // rule out different pairs.
+  for (int k = 0; k < LabelCount; ++k)
+  {
+    std::vector<char> visited(bound, 0);
+    std::vector<std::pair<Vertex, std::size_t>> stack;
+
+    std::uint32_t post = 0;
+
+    for (Vertex root : order)
+    {
+      if (visited[root])
+        continue;
+
+      visited[root] = 1;
+      stack.emplace_back(root, 0);
+
+      while (!stack.empty())
+      {
+        Vertex const u = stack.back().first;
+        std::size_t & next = stack.back().second;
+
+        auto const & children = _graph.successors(u);
+
+        if (next < children.size())
+        {
+          Vertex const c = (k == 0) ? children[next] :
+                                      children[children.size() - 1 - next];
+          ++next;
+
+          if (!visited[c])
+          {
+            visited[c] = 1;
+            stack.emplace_back(c, 0);
+          }
+
+          continue;
+        }
+
+        Label & label = _labels[u * LabelCount + k];
+
+        label.post = ++post;
+        label.low  = label.post;
+
+        for (Vertex c : children)
+          label.low = std::min(label.low, _labels[c * LabelCount + k].low);
+
+        stack.pop_back();
+      }
+    }
+
+    // the same for every labelling, all vertices are numbered
+    _postCount = post;
+  }
+}
+
+
+bool
+ReachabilityIndex::
+labelsContain(Vertex outer, Vertex inner) const
+{
+  for (int k = 0; k < LabelCount; ++k)
+  {
+    Label const & o = _labels[outer * LabelCount + k];
+    Label const & i = _labels[inner * LabelCount + k];
+
+    if (i.low < o.low || i.post > o.post)
+      return false;
+  }
+
+  return true;
+}
+
+
+std::vector<ReachabilityIndex::Vertex>
+ReachabilityIndex::
+collect(Vertex v, bool forward) const
+{
+  std::vector<Vertex> result;
+
+  if (!_graph.contains(v))
+    return result;
+
+  ensureBuilt();
+
+  if (_mode == Mode::Closure)
+  {
+    std::uint64_t const* bits = row(forward ? _descendants : _ancestors, v);
+
+    for (std::size_t w = 0; w < _words; ++w)
+    {
+      for (std::uint64_t word = bits[w]; word; word &= word - 1)
+        result.push_back(static_cast<Vertex>(w * 64 + lowestBit(word)));
+    }
+
+    return result;
+  }
+
+  if (++_searchEpoch == 0)
+  {
+    std::fill(_visitMark.begin(), _visitMark.end(), 0);
+    _searchEpoch = 1;
+  }
+
+  std::vector<Vertex> stack{v};
+  _visitMark[v] = _searchEpoch;
+
+  while (!stack.empty())
+  {
+    Vertex const u = stack.back();
+    stack.pop_back();
+
+    for (Vertex w : (forward ? _graph.successors(u) : _graph.predecessors(u)))
+    {
+      if (_visitMark[w] == _searchEpoch)
+        continue;
+
+      _visitMark[w] = _searchEpoch;
+      result.push_back(w);
+      stack.push_back(w);
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,292 @@
+#include "TopologicalOrder.hpp"
+
+#include <algorithm>
+
+using QtNodes::TopologicalOrder;
+
+constexpr TopologicalOrder::Vertex TopologicalOrder::None;
+
+namespace
+{
+
+using Vertex = TopologicalOrder::Vertex;
+
+void
+eraseOne(std::vector<Vertex> & list, Vertex v)
+{
+  auto it = std::find(list.begin(), list.end(), v);
+
+  if (it != list.end())
+  {
+    *it = list.back();
+    list.pop_back();
+  }
+}
+
+}
+
+
+void
+TopologicalOrder::
+addVertex(Vertex v)
+{
+  if (v >= _present.size())
+  {
+    std::size_t const size = v + 1;
+
+    _out.resize(size);
+    _in.resize(size);
+    _position.resize(size, 0);
+    _present.resize(size, 0);
+    _visitMark.resize(size, 0);
+  }
+
+  if (_present[v])
+    return;
+
+  _present[v]  = 1;
+  _position[v] = _vertexAt.size();
+  _vertexAt.push_back(v);
+
+  ++_vertexCount;
+}
+
+
+void
+TopologicalOrder::
+removeVertex(Vertex v)
+{
+  if (!contains(v))
+    return;
+
+  for (Vertex w : _out[v])
+    eraseOne(_in[w], v);
+
+  for (Vertex w : _in[v])
+    eraseOne(_out[w], v);
+
+  _out[v].clear();
+  _in[v].clear();
+
+  _vertexAt[_position[v]] = None;
+  _present[v] = 0;
+
+  --_vertexCount;
+
+  if (_vertexAt.size() > 2 * _vertexCount + 64)
+    compact();
+}
+
+
+bool
+TopologicalOrder::
+contains(Vertex v) const
+{
+  return v < _present.size() && _present[v];
+}
+
+
+bool
+TopologicalOrder::
+wouldCreateCycle(Vertex from, Vertex to) const
+{
+  if (from == to)
+    return true;
+
+  if (!contains(from) || !contains(to) || precedes(from, to))
+    return false;
+
+  std::vector<Vertex> visited;
+
+  return !search(to, from, _position[to], _position[from], true, visited);
+}
+
+
+bool
+TopologicalOrder::
+addEdge(Vertex from, Vertex to)
+{
+  if (from == to || !contains(from) || !contains(to))
+    return false;
+
+  if (!precedes(from, to))
+  {
+    std::size_t const lower = _position[to];
+    std::size_t const upper = _position[from];
+
+    // vertices reachable from `to` that sit before `from`
+    std::vector<Vertex> forward;
+    if (!search(to, from, lower, upper, true, forward))
+      return false;
+
+    // vertices reaching `from` that sit after `to`
+    std::vector<Vertex> backward;
+    search(from, None, lower, upper, false, backward);
+
+    reorder(forward, backward);
+  }
+
+  _out[from].push_back(to);
+  _in[to].push_back(from);
+
+  return true;
+}
+
+
+void
+TopologicalOrder::
+removeEdge(Vertex from, Vertex to)
+{
+  if (!contains(from) || !contains(to))
+    return;
+
+  auto & out = _out[from];
+  auto it = std::find(out.begin(), out.end(), to);
+
+  if (it == out.end())
+    return;
+
+  *it = out.back();
+  out.pop_back();
+
+  eraseOne(_in[to], from);
+}
+
+
+std::vector<TopologicalOrder::Vertex>
+TopologicalOrder::
+order() const
+{
+  std::vector<Vertex> result;
+  result.reserve(_vertexCount);
+
+  for (Vertex v : _vertexAt)
+  {
+    if (v != None)
+      result.push_back(v);
+  }
+
+  return result;
+}
+
+
+void
+TopologicalOrder::
+clear()
+{
+  _out.clear();
+  _in.clear();
+  _position.clear();
+  _vertexAt.clear();
+  _present.clear();
+  _visitMark.clear();
+
+  _vertexCount = 0;
+  _searchEpoch = 0;
+}
+
+
+bool
+TopologicalOrder::
+search(Vertex start,
+       Vertex stop,
+       std::size_t lower,
+       std::size_t upper,
+       bool forward,
+       std::vector<Vertex> & visited) const
+{
+  if (++_searchEpoch == 0)
+  {
+    std::fill(_visitMark.begin(), _visitMark.end(), 0);
+    _searchEpoch = 1;
+  }
+
+  _stack.clear();
+  _stack.push_back(start);
+  _visitMark[start] = _searchEpoch;
+
+  while (!_stack.empty())
+  {
+    Vertex const u = _stack.back();
+    _stack.pop_back();
+
+    visited.push_back(u);
+
+    for (Vertex w : (forward ? _out[u] : _in[u]))
+    {
+      if (w == stop)
+        return false;
+
+      std::size_t const p = _position[w];
+
+      if (p < lower || p > upper || _visitMark[w] == _searchEpoch)
+        continue;
+
+      _visitMark[w] = _searchEpoch;
+      _stack.push_back(w);
+    }
+  }
+
+  return true;
+}
+
+
+void
+TopologicalOrder::
+reorder(std::vector<Vertex> & forward,
+        std::vector<Vertex> & backward)
+{
+  auto byPosition = [this](Vertex a, Vertex b)
+  {
+    return _position[a] < _position[b];
+  };
+
+  std::sort(forward.begin(), forward.end(), byPosition);
+  std::sort(backward.begin(), backward.end(), byPosition);
+
+  // The affected vertices keep the same set of positions; everything
+  // reaching `from` moves in front of everything reachable from `to`.
+  std::vector<std::size_t> positions;
+  positions.reserve(forward.size() + backward.size());
+
+  for (Vertex v : backward)
+    positions.push_back(_position[v]);
+
+  for (Vertex v : forward)
+    positions.push_back(_position[v]);
+
+  std::sort(positions.begin(), positions.end());
+
+  std::size_t i = 0;
+
+  for (Vertex v : backward)
+  {
+    _position[v]              = positions[i];
+    _vertexAt[positions[i++]] = v;
+  }
+
+  for (Vertex v : forward)
+  {
+    _position[v]              = positions[i];
+    _vertexAt[positions[i++]] = v;
+  }
+}
+
+
+void
+TopologicalOrder::
+compact()
+{
+  std::size_t next = 0;
+
+  for (Vertex v : _vertexAt)
+  {
+    if (v == None)
+      continue;
+
+    _position[v]     = next;
+    _vertexAt[next++] = v;
+  }
+
+  _vertexAt.resize(next);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <memory>
+
+#include <QtCore/QDir>
+#include <QtCore/QString>
+#include <QtCore/QTemporaryDir>
+
+#include <nodes/DataModelRegistry>
+
+#include <catch2/catch.hpp>
+
+/// Registry knowing the given models, for scenes that save and load.
+template <typename... Models>
+std::shared_ptr<QtNodes::DataModelRegistry>
+registryWith()
+{
+  auto registry = std::make_shared<QtNodes::DataModelRegistry>();
+
+  int registered[] = { 0, (registry->registerModel<Models>(), 0)... };
+  (void)registered;
+
+  return registry;
+}
+
+
+/// Directory for the files written by a test, removed with it.
+class TestDirectory
+{
+public:
+  TestDirectory()
+  {
+    REQUIRE(_dir.isValid());
+  }
+
+  QString
+  filePath(QString const & name) const
+  {
+    return QDir(_dir.path()).filePath(name);
+  }
+
+private:
+  QTemporaryDir _dir;
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "StubNodeDataModel.hpp"
+
+/// One input and one output port, enough to build chains of nodes.
+class PortsDataModel : public StubNodeDataModel
+{
+public:
+  unsigned int nPorts(QtNodes::PortType) const override { return 1; }
+};
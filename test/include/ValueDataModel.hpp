@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QtCore/QJsonObject>
+
+#include <nodes/Node>
+
+#include "StubNodeDataModel.hpp"
+
+/// One port each way and an int that is saved, restored and reported
+/// through dataUpdated(), for tests that edit the scene.
+class ValueDataModel : public StubNodeDataModel
+{
+public:
+  unsigned int nPorts(QtNodes::PortType) const override { return 1; }
+
+  QJsonObject
+  save() const override
+  {
+    QJsonObject modelJson = StubNodeDataModel::save();
+    modelJson["value"] = value;
+    return modelJson;
+  }
+
+  void
+  restore(QJsonObject const & modelJson) override
+  {
+    value = modelJson["value"].toInt();
+  }
+
+  void
+  setValue(int v)
+  {
+    value = v;
+    dataUpdated(0);
+  }
+
+  int value = 0;
+};
+
+
+inline
+ValueDataModel&
+valueModel(QtNodes::Node & node)
+{
+  return *static_cast<ValueDataModel*>(node.nodeDataModel());
+}
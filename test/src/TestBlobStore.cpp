@@ -0,0 +1,232 @@
+#include <nodes/BlobStore>
+
+#include <nodes/DataModelRegistry>
+#include <nodes/FlowBinaryFormat>
+#include <nodes/FlowScene>
+#include <nodes/FlowUndoStack>
+#include <nodes/Node>
+
+#include <catch2/catch.hpp>
+
+#include <memory>
+
+#include "ApplicationSetup.hpp"
+#include "FlowFixture.hpp"
+#include "StubNodeDataModel.hpp"
+
+using QtNodes::BlobStore;
+using QtNodes::DataModelRegistry;
+using QtNodes::FlowBinaryFormat;
+using QtNodes::FlowScene;
+using QtNodes::FlowSnapshot;
+using QtNodes::FlowUndoStack;
+using QtNodes::Node;
+
+namespace
+{
+
+// Keeps its payload in the scene's blob store, fetched when needed.
+class PayloadDataModel : public StubNodeDataModel
+{
+public:
+
+  QJsonObject
+  save() const override
+  {
+    QJsonObject modelJson = StubNodeDataModel::save();
+
+    if (!payloadId.isEmpty())
+      modelJson["payload"] = BlobStore::reference(payloadId);
+
+    return modelJson;
+  }
+
+  void
+  restore(QJsonObject const & modelJson) override
+  {
+    payloadId = BlobStore::referencedId(modelJson["payload"]);
+  }
+
+  void
+  setPayload(QByteArray const & data)
+  {
+    payloadId = blobStore()->put(data);
+  }
+
+  QByteArray
+  payload() const
+  {
+    return blobStore()->get(payloadId);
+  }
+
+  QString payloadId;
+};
+
+PayloadDataModel&
+payloadModel(Node & node)
+{
+  return *static_cast<PayloadDataModel*>(node.nodeDataModel());
+}
+
+}
+
+TEST_CASE("BlobStore stores identical content once", "[blobs]")
+{
+  BlobStore store;
+
+  QByteArray const table(64 * 1024, 'x');
+
+  QString const id = store.put(table);
+
+  CHECK(id.size() == 64);
+  CHECK(store.put(table) == id);
+  CHECK(store.size() == 1);
+
+  CHECK(store.get(id) == table);
+  CHECK(store.get(store.put("other")) == "other");
+  CHECK(store.get("missing").isEmpty());
+
+  SECTION("compressible content is saved compressed")
+  {
+    FlowSnapshot::NodeRecord node;
+    node.model["table"] = BlobStore::reference(id);
+
+    auto const records = store.records({ node });
+
+    REQUIRE(records.size() == 1);
+    CHECK(records[0].compressed);
+    CHECK(records[0].size == quint64(table.size()));
+    CHECK(records[0].data.size() < table.size());
+
+    BlobStore loaded;
+    CHECK(loaded.insert(records[0]));
+
+    CHECK(loaded.get(id) == table);
+  }
+
+  SECTION("records not matching their id are refused")
+  {
+    FlowSnapshot::NodeRecord node;
+    node.model["table"] = BlobStore::reference(id);
+
+    FlowSnapshot::BlobRecord record = store.records({ node })[0];
+
+    BlobStore loaded;
+
+    FlowSnapshot::BlobRecord wrongSize = record;
+    wrongSize.size += 1;
+
+    CHECK_FALSE(loaded.insert(wrongSize));
+
+    record.data = qCompress(QByteArray(64 * 1024, 'y'));
+
+    CHECK_FALSE(loaded.insert(record));
+    CHECK_FALSE(loaded.contains(id));
+  }
+}
+
+TEST_CASE("Blobs no longer referred to are dropped", "[blobs]")
+{
+  auto setup = applicationSetup();
+
+  FlowScene scene(registryWith<PayloadDataModel>());
+
+  auto undoStack = std::make_unique<FlowUndoStack>(scene);
+
+  QByteArray const image(1024, 'i');
+
+  Node& node = scene.createNode(std::make_unique<PayloadDataModel>());
+  payloadModel(node).setPayload(image);
+
+  QUuid const id = node.id();
+
+  scene.blobStore().put("unused");
+
+  // closes the step of the creation
+  QCoreApplication::processEvents();
+
+  scene.removeNode(node);
+  QCoreApplication::processEvents();
+
+  scene.collectBlobs();
+
+  // the undo stack still holds the removed node
+  CHECK(scene.blobStore().size() == 1);
+
+  undoStack->undo();
+
+  Node* restored = scene.findNode(id);
+  REQUIRE(restored);
+  CHECK(payloadModel(*restored).payload() == image);
+
+  undoStack.reset();
+  scene.clearScene();
+
+  CHECK(scene.blobStore().size() == 0);
+}
+
+TEST_CASE("Flow files carry the blobs the models refer to", "[blobs][serialization]")
+{
+  auto setup = applicationSetup();
+
+  auto registry = std::make_shared<DataModelRegistry>();
+  registry->registerModel<PayloadDataModel>();
+
+  FlowScene scene(registry);
+
+  QByteArray const image(256 * 1024, '\x7f');
+
+  for (int i = 0; i < 3; ++i)
+  {
+    Node& node = scene.createNode(std::make_unique<PayloadDataModel>());
+    payloadModel(node).setPayload(image);
+  }
+
+  // stored, but no model refers to it
+  scene.blobStore().put("unused");
+
+  FlowSnapshot const snapshot = scene.snapshot();
+
+  REQUIRE(snapshot.blobs.size() == 1);
+
+  // saving leaves the store alone, collecting drops what isn't referred to
+  CHECK(scene.blobStore().size() == 2);
+
+  scene.collectBlobs();
+  CHECK(scene.blobStore().size() == 1);
+
+  SECTION("JSON")
+  {
+    QByteArray const json = scene.saveToMemory();
+
+    // compressed once rather than inlined three times
+    CHECK(json.size() < image.size() / 8);
+
+    FlowScene loaded(registry);
+    loaded.loadFromMemory(json);
+
+    REQUIRE(loaded.nodes().size() == 3);
+    CHECK(loaded.blobStore().size() == 1);
+
+    for (auto const & node : loaded.nodes())
+      CHECK(payloadModel(*node).payload() == image);
+  }
+
+  SECTION("binary")
+  {
+    QByteArray const binary = scene.saveToBinary();
+
+    FlowSnapshot const read =
+      FlowBinaryFormat::read(binary.constData(), static_cast<std::size_t>(binary.size()));
+
+    REQUIRE(read.blobs.size() == 1);
+    CHECK(read.blobs[0].id == snapshot.blobs[0].id);
+    CHECK(read.blobs[0].data == snapshot.blobs[0].data);
+
+    FlowScene loaded(registry);
+    loaded.restoreSnapshot(read);
+
+    for (auto const & node : loaded.nodes())
+      CHECK(payloadModel(*node).payload() == image);
+  }
+}
@@ -0,0 +1,73 @@
+#include <nodes/BufferPool>
+
+#include <catch2/catch.hpp>
+
+using QtNodes::BufferPool;
+using QtNodes::SharedBuffer;
+
+TEST_CASE("BufferPool recycles released buffers", "[memory]")
+{
+  BufferPool pool;
+
+  SECTION("sizes are rounded up to a size class")
+  {
+    auto buffer = pool.acquire(5000);
+
+    CHECK(buffer->size() == 5000);
+    CHECK(buffer->capacity() == 8192);
+  }
+
+  SECTION("a released buffer is handed out again")
+  {
+    unsigned char* first = nullptr;
+    {
+      auto buffer = pool.acquire(100000);
+      first = buffer->data();
+
+      CHECK(pool.statistics().bytesInUse == buffer->capacity());
+    }
+
+    CHECK(pool.statistics().bytesRetained == 131072);
+
+    auto buffer = pool.acquire(120000);
+
+    CHECK(buffer->data() == first);
+
+    auto stats = pool.statistics();
+    CHECK(stats.acquisitions == 2);
+    CHECK(stats.allocations == 1);
+    CHECK(stats.reuses == 1);
+    CHECK(stats.bytesRetained == 0);
+  }
+
+  SECTION("limits bound the idle memory")
+  {
+    BufferPool::Limits limits;
+    limits.maxBuffersPerClass = 1;
+    pool.setLimits(limits);
+
+    {
+      SharedBuffer a = pool.acquire(4096);
+      SharedBuffer b = pool.acquire(4096);
+    }
+
+    auto stats = pool.statistics();
+    CHECK(stats.releases == 2);
+    CHECK(stats.discards == 1);
+    CHECK(stats.bytesRetained == 4096);
+
+    pool.clear();
+    CHECK(pool.statistics().bytesRetained == 0);
+  }
+
+  SECTION("buffers outliving the pool are still freed")
+  {
+    SharedBuffer buffer;
+    {
+      BufferPool shortLived;
+      buffer = shortLived.acquire(1024);
+    }
+
+    CHECK(buffer->capacity() == BufferPool::MinimumClassSize);
+  }
+}
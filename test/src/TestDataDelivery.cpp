@@ -0,0 +1,176 @@
+#include <nodes/FlowScene>
+#include <nodes/Node>
+#include <nodes/NodeDataModel>
+
+#include <catch2/catch.hpp>
+
+#include <QtTest>
+
+#include <memory>
+
+#include "ApplicationSetup.hpp"
+#include "StubNodeDataModel.hpp"
+
+using QtNodes::FlowScene;
+using QtNodes::Node;
+using QtNodes::NodeData;
+using QtNodes::NodeDataModel;
+using QtNodes::NodeDataType;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+
+namespace
+{
+
+struct CounterData : NodeData
+{
+  explicit
+  CounterData(int v) : value(v) {}
+
+  NodeDataType type() const override { return NodeDataType(); }
+
+  int value;
+};
+
+
+struct EmittingModel : StubNodeDataModel
+{
+  explicit
+  EmittingModel(DeliveryPolicy p) : policy(p) {}
+
+  unsigned int nPorts(PortType) const override { return 1; }
+
+  DeliveryPolicy
+  portOutDeliveryPolicy(PortIndex) const override { return policy; }
+
+  std::shared_ptr<NodeData>
+  outData(PortIndex) override { return std::make_shared<CounterData>(counter); }
+
+  void
+  emitValue(int v)
+  {
+    counter = v;
+    Q_EMIT dataUpdated(0);
+  }
+
+  DeliveryPolicy policy;
+  int counter = 0;
+};
+
+
+struct ReceivingModel : StubNodeDataModel
+{
+  unsigned int nPorts(PortType) const override { return 1; }
+
+  void
+  setInData(std::shared_ptr<NodeData> data, PortIndex) override
+  {
+    if (auto counter = std::dynamic_pointer_cast<CounterData>(data))
+    {
+      ++received;
+      last = counter->value;
+    }
+  }
+
+  int received = 0;
+  int last     = -1;
+};
+
+
+struct DeliverySetup
+{
+  explicit
+  DeliverySetup(NodeDataModel::DeliveryPolicy policy)
+  {
+    auto source = std::make_unique<EmittingModel>(policy);
+    auto sink   = std::make_unique<ReceivingModel>();
+
+    emitter  = source.get();
+    receiver = sink.get();
+
+    Node& from = scene.createNode(std::move(source));
+    Node& to   = scene.createNode(std::move(sink));
+
+    scene.createConnection(to, 0, from, 0);
+
+    QCoreApplication::processEvents();
+    receiver->received = 0;
+  }
+
+  FlowScene scene;
+
+  EmittingModel*  emitter  = nullptr;
+  ReceivingModel* receiver = nullptr;
+};
+
+}
+
+
+TEST_CASE("Output delivery policies", "[gui]")
+{
+  using DeliveryPolicy = NodeDataModel::DeliveryPolicy;
+
+  auto app = applicationSetup();
+
+  SECTION("immediate delivers every value")
+  {
+    DeliverySetup setup(DeliveryPolicy::immediate());
+
+    for (int i = 1; i <= 100; ++i)
+      setup.emitter->emitValue(i);
+
+    CHECK(setup.receiver->received == 100);
+    CHECK(setup.receiver->last == 100);
+  }
+
+  SECTION("coalesce delivers only the latest value")
+  {
+    DeliverySetup setup(DeliveryPolicy::coalesce());
+
+    for (int i = 1; i <= 100; ++i)
+      setup.emitter->emitValue(i);
+
+    CHECK(setup.receiver->received == 0);
+
+    QCoreApplication::processEvents();
+
+    CHECK(setup.receiver->received == 1);
+    CHECK(setup.receiver->last == 100);
+
+    setup.emitter->emitValue(101);
+    QCoreApplication::processEvents();
+
+    CHECK(setup.receiver->received == 2);
+    CHECK(setup.receiver->last == 101);
+  }
+
+  SECTION("rate limit caps the number of deliveries")
+  {
+    DeliverySetup setup(DeliveryPolicy::rateLimited(10.0));
+
+    // The first value after a quiet period is not delayed; the data sent
+    // when the connection was made does not count against the limit.
+    setup.emitter->emitValue(1);
+
+    CHECK(setup.receiver->received == 1);
+
+    for (int i = 2; i <= 100; ++i)
+      setup.emitter->emitValue(i);
+
+    CHECK(setup.receiver->received == 1);
+
+    QElapsedTimer timer;
+    timer.start();
+    while (setup.receiver->received < 2 && timer.elapsed() < 1000)
+      QTest::qWait(10);
+
+    // the trailing edge carries the latest value
+    CHECK(setup.receiver->received == 2);
+    CHECK(setup.receiver->last == 100);
+
+    // and nothing is left to deliver after it
+    QTest::qWait(250);
+
+    CHECK(setup.receiver->received == 2);
+  }
+}
@@ -2,6 +2,11 @@
 
 #include <catch2/catch.hpp>
 
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 #include "StubNodeDataModel.hpp"
 
 using QtNodes::DataModelRegistry;
@@ -70,3 +75,115 @@ TEST_CASE("DataModelRegistry::registerModel", "[interface]")
     }
   }
 }
+
+TEST_CASE("DataModelRegistry::freeze", "[interface]")
+{
+  DataModelRegistry registry;
+
+  registry.registerModel<StubNodeDataModel>();
+  registry.registerTypeConverter(std::make_pair(NodeDataType{"a", "A"},
+                                                NodeDataType{"b", "B"}),
+                                 [](std::shared_ptr<NodeData> d) { return d; });
+
+  CHECK_FALSE(registry.isFrozen());
+
+  registry.freeze();
+
+  CHECK(registry.isFrozen());
+
+  CHECK_THROWS_AS(registry.registerModel<StubModelStaticName>(), std::logic_error);
+  CHECK_THROWS_AS(registry.registerTypeConverter(
+                    std::make_pair(NodeDataType{"b", "B"}, NodeDataType{"a", "A"}),
+                    [](std::shared_ptr<NodeData> d) { return d; }),
+                  std::logic_error);
+
+  CHECK(registry.create("name") != nullptr);
+  CHECK(registry.create("Name") == nullptr);
+
+  CHECK(registry.findTypeConverter(NodeDataType{"a", "A"}, NodeDataType{"b", "B"}) != nullptr);
+  CHECK(registry.findTypeConverter(NodeDataType{"b", "B"}, NodeDataType{"a", "A"}) == nullptr);
+  CHECK(registry.getTypeConverter(NodeDataType{"a", "A"}, NodeDataType{"b", "B"}));
+}
+
+TEST_CASE("DataModelRegistry concurrent use", "[interface][stress]")
+{
+  DataModelRegistry registry;
+
+  auto registerStub = [&registry](QString const & name)
+  {
+    registry.registerModel<StubNodeDataModel>([name] {
+      auto model = std::make_unique<StubNodeDataModel>();
+      model->name(name);
+      return model;
+    });
+  };
+
+  registerStub("model0");
+  registry.registerTypeConverter(std::make_pair(NodeDataType{"a", "A"},
+                                                NodeDataType{"b", "B"}),
+                                 [](std::shared_ptr<NodeData> d) { return d; });
+
+  int const readerCount    = 8;
+  int const lateModelCount = 200;
+
+  std::atomic<bool> registering{true};
+  std::atomic<int>  failures{0};
+
+  auto reader = [&]()
+  {
+    int const rounds = 2000;
+
+    for (int i = 0; i < rounds || registering; ++i)
+    {
+      auto model = registry.create("model0");
+      if (!model || model->name() != "model0")
+        ++failures;
+
+      auto converter = registry.getTypeConverter(NodeDataType{"a", "A"},
+                                                 NodeDataType{"b", "B"});
+      if (!converter)
+        ++failures;
+
+      if (!registry.findTypeConverter(NodeDataType{"a", "A"},
+                                      NodeDataType{"b", "B"}))
+        ++failures;
+
+      // Models registered by the writer are either missing or complete.
+      auto late = registry.create(QString("late%1").arg(i % lateModelCount));
+      if (late && late->name() != QString("late%1").arg(i % lateModelCount))
+        ++failures;
+    }
+  };
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < readerCount; ++i)
+    readers.emplace_back(reader);
+
+  for (int i = 0; i < lateModelCount; ++i)
+  {
+    registerStub(QString("late%1").arg(i));
+    registry.registerTypeConverter(
+      std::make_pair(NodeDataType{QString("c%1").arg(i), "C"},
+                     NodeDataType{"a", "A"}),
+      [](std::shared_ptr<NodeData> d) { return d; });
+  }
+
+  registry.freeze();
+  registering = false;
+
+  for (auto & t : readers)
+    t.join();
+
+  CHECK(failures.load() == 0);
+  CHECK(registry.registeredModelCreators().size() == std::size_t(lateModelCount + 1));
+
+  // Frozen: every lookup below runs without locking.
+  readers.clear();
+  for (int i = 0; i < readerCount; ++i)
+    readers.emplace_back(reader);
+
+  for (auto & t : readers)
+    t.join();
+
+  CHECK(failures.load() == 0);
+}
@@ -0,0 +1,213 @@
+#include <nodes/FlowBinaryFormat>
+
+#include <nodes/DataModelRegistry>
+#include <nodes/FlowScene>
+#include <nodes/Node>
+
+#include <catch2/catch.hpp>
+
+#include <QtCore/QJsonDocument>
+
+#include <memory>
+#include <stdexcept>
+
+#include "ApplicationSetup.hpp"
+#include "Stringify.hpp"
+#include "StubNodeDataModel.hpp"
+
+using QtNodes::DataModelRegistry;
+using QtNodes::FlowBinaryFormat;
+using QtNodes::FlowScene;
+using QtNodes::FlowSnapshot;
+using QtNodes::NodeDataType;
+
+namespace
+{
+
+FlowSnapshot
+sampleSnapshot()
+{
+  FlowSnapshot snapshot;
+
+  for (int i = 0; i < 3; ++i)
+  {
+    FlowSnapshot::NodeRecord node;
+    node.id       = QUuid::createUuid();
+    node.position = QPointF(10.5 * i, -3.25 * i);
+
+    node.model["name"]  = (i == 1) ? "Multiply" : "Number";
+    node.model["value"] = QString::number(i);
+
+    snapshot.nodes.push_back(node);
+  }
+
+  FlowSnapshot::ConnectionRecord plain;
+  plain.outNode = 0; plain.outPort = 0;
+  plain.inNode  = 1; plain.inPort  = 1;
+  plain.turningPoints << QPointF(1, 2) << QPointF(3, 4);
+  snapshot.connections.push_back(plain);
+
+  FlowSnapshot::ConnectionRecord converted;
+  converted.outNode = 1; converted.outPort = 0;
+  converted.inNode  = 2; converted.inPort  = 0;
+  converted.hasConverter = true;
+  converted.inType  = NodeDataType{ "text", "Text" };
+  converted.outType = NodeDataType{ "decimal", "Decimal" };
+  snapshot.connections.push_back(converted);
+
+  return snapshot;
+}
+
+}
+
+TEST_CASE("FlowBinaryFormat round trips snapshots", "[serialization]")
+{
+  FlowSnapshot const snapshot = sampleSnapshot();
+
+  QByteArray const binary = FlowBinaryFormat::write(snapshot);
+
+  REQUIRE(FlowBinaryFormat::isBinary(binary.constData(), binary.size()));
+
+  FlowSnapshot const read = FlowBinaryFormat::read(binary.constData(), binary.size());
+
+  CHECK(read.toJson() == snapshot.toJson());
+
+  SECTION("JSON converts both ways")
+  {
+    QByteArray const json = snapshot.toJson();
+
+    QByteArray const converted = FlowBinaryFormat::fromJson(json);
+
+    CHECK(converted == binary);
+    CHECK(FlowBinaryFormat::toJson(converted.constData(), converted.size()) == json);
+  }
+
+  SECTION("truncated data is rejected")
+  {
+    for (int size : { 4, 20, 40, binary.size() - 8 })
+    {
+      CHECK_THROWS_AS(FlowBinaryFormat::read(binary.constData(), size),
+                      std::logic_error);
+    }
+  }
+
+  SECTION("unknown chunks are skipped")
+  {
+    QByteArray extended = binary;
+    extended.append("XTRA", 4);
+    extended.append(QByteArray(4, '\0'));
+    extended.append(QByteArray("\x03\0\0\0\0\0\0\0", 8));
+    extended.append(QByteArray(8, 'x'));
+
+    FlowSnapshot const tolerant =
+      FlowBinaryFormat::read(extended.constData(), extended.size());
+
+    CHECK(tolerant.toJson() == snapshot.toJson());
+  }
+}
+
+TEST_CASE("FlowBinaryFormat reads parts of a flow", "[serialization]")
+{
+  // a chain of 100 nodes laid out on a 10 x 10 grid
+  FlowSnapshot snapshot;
+
+  for (int i = 0; i < 100; ++i)
+  {
+    FlowSnapshot::NodeRecord node;
+    node.id       = QUuid::createUuid();
+    node.position = QPointF(100 * (i % 10), 100 * (i / 10));
+    node.model["name"] = "Number";
+
+    snapshot.nodes.push_back(node);
+  }
+
+  for (std::size_t i = 0; i + 1 < snapshot.nodes.size(); ++i)
+  {
+    FlowSnapshot::ConnectionRecord connection;
+    connection.outNode = i;     connection.outPort = 0;
+    connection.inNode  = i + 1; connection.inPort  = 0;
+
+    snapshot.connections.push_back(connection);
+  }
+
+  // far away from the grid, without making its cells any larger
+  FlowSnapshot::NodeRecord outlier;
+  outlier.id       = QUuid::createUuid();
+  outlier.position = QPointF(1e9, 1e9);
+  outlier.model["name"] = "Number";
+
+  snapshot.nodes.push_back(outlier);
+
+  QByteArray binary = FlowBinaryFormat::write(snapshot);
+
+  SECTION("through the index")
+  {
+  }
+
+  SECTION("of files without an index")
+  {
+    // the index is the last chunk
+    binary.truncate(binary.lastIndexOf("INDX"));
+  }
+
+  FlowSnapshot const region =
+    FlowBinaryFormat::readRegion(binary.constData(), binary.size(),
+                                 QRectF(-10, -10, 250, 150));
+
+  REQUIRE(region.nodes.size() == 6);
+  CHECK(region.nodes[0].id == snapshot.nodes[0].id);
+  CHECK(region.nodes[3].id == snapshot.nodes[10].id);
+
+  // 0 -> 1 -> 2 and 10 -> 11 -> 12
+  REQUIRE(region.connections.size() == 4);
+  CHECK(region.connections[2].outNode == 3);
+  CHECK(region.connections[2].inNode == 4);
+
+  FlowSnapshot const upstream =
+    FlowBinaryFormat::readUpstream(binary.constData(), binary.size(),
+                                   { snapshot.nodes[5].id, QUuid::createUuid() });
+
+  REQUIRE(upstream.nodes.size() == 6);
+  CHECK(upstream.nodes[5].id == snapshot.nodes[5].id);
+  CHECK(upstream.connections.size() == 5);
+
+  // the same parts picked from the snapshot, as for JSON files
+  CHECK(snapshot.within(QRectF(-10, -10, 250, 150)).toJson() == region.toJson());
+  CHECK(snapshot.upstreamOf({ snapshot.nodes[5].id, QUuid::createUuid() }).toJson() ==
+        upstream.toJson());
+
+  FlowSnapshot const far =
+    FlowBinaryFormat::readRegion(binary.constData(), binary.size(),
+                                 QRectF(1e9 - 1, 1e9 - 1, 2, 2));
+
+  REQUIRE(far.nodes.size() == 1);
+  CHECK(far.nodes[0].id == outlier.id);
+}
+
+TEST_CASE("FlowScene saves and loads binary flows", "[serialization]")
+{
+  auto setup = applicationSetup();
+
+  auto registry = std::make_shared<DataModelRegistry>();
+  registry->registerModel<StubNodeDataModel>();
+
+  FlowScene scene(registry);
+
+  auto& a = scene.createNode(std::make_unique<StubNodeDataModel>());
+  auto& b = scene.createNode(std::make_unique<StubNodeDataModel>());
+  scene.setNodePosition(b, QPointF(100, 50));
+
+  QByteArray const binary = scene.saveToBinary();
+
+  FlowScene loaded(registry);
+  loaded.loadFromMemory(binary);
+
+  REQUIRE(loaded.nodes().size() == 2);
+
+  auto loadedB = loaded.findNode(b.id());
+  REQUIRE(loadedB != nullptr);
+  CHECK(loaded.getNodePosition(*loadedB) == QPointF(100, 50));
+  CHECK(loaded.findNode(a.id()) != nullptr);
+
+  CHECK(loaded.saveToMemory() == scene.saveToMemory());
+}
@@ -0,0 +1,121 @@
+#include <nodes/FlowHeader>
+
+#include <nodes/FlowScene>
+#include <nodes/FlowSnapshot>
+#include <nodes/Node>
+
+#include <catch2/catch.hpp>
+
+#include <QtCore/QFile>
+#include <QtWidgets/QGraphicsObject>
+
+#include <memory>
+
+#include "ApplicationSetup.hpp"
+#include "FlowFixture.hpp"
+#include "PortsDataModel.hpp"
+
+using QtNodes::FlowHeader;
+using QtNodes::FlowScene;
+using QtNodes::FlowSnapshot;
+using QtNodes::Node;
+
+TEST_CASE("Flow files start with a header readable on its own", "[serialization]")
+{
+  auto setup = applicationSetup();
+
+  auto registry = registryWith<PortsDataModel>();
+
+  FlowScene scene(registry);
+
+  Node& a = scene.createNode(std::make_unique<PortsDataModel>());
+  Node& b = scene.createNode(std::make_unique<PortsDataModel>());
+  scene.setNodePosition(b, QPointF(400, 200));
+  scene.createConnection(a, 0, b, 0);
+
+  TestDirectory dir;
+
+  QString const fileName = dir.filePath("flow.flow");
+
+  SECTION("in either format")
+  {
+    for (auto format : { FlowScene::FileFormat::Json, FlowScene::FileFormat::Binary })
+    {
+      REQUIRE(scene.saveToFile(fileName, format));
+
+      FlowHeader header;
+      REQUIRE(FlowScene::readHeader(fileName, header));
+
+      CHECK(header.nodeCount == 2);
+      CHECK(header.connectionCount == 1);
+      CHECK(header.bounds == (a.nodeGraphicsObject().sceneBoundingRect() |
+                              b.nodeGraphicsObject().sceneBoundingRect()));
+
+      QImage const thumbnail = header.thumbnailImage();
+
+      REQUIRE_FALSE(thumbnail.isNull());
+      CHECK(thumbnail.width() == 256);
+      CHECK(thumbnail.height() <= 256);
+
+      // the header doesn't get in the way of loading
+      FlowScene loaded(registry);
+      REQUIRE(loaded.loadFromFile(fileName));
+      CHECK(loaded.nodes().size() == 2);
+    }
+  }
+
+  SECTION("ahead of the rest of toJson()")
+  {
+    QByteArray const json = scene.snapshot().toJson();
+
+    QFile file(fileName);
+    REQUIRE(file.open(QIODevice::WriteOnly));
+    file.write(json);
+    file.close();
+
+    FlowHeader header;
+    REQUIRE(FlowScene::readHeader(fileName, header));
+
+    CHECK(header.nodeCount == 2);
+    CHECK(header.connectionCount == 1);
+  }
+
+  SECTION("files written without one are told apart")
+  {
+    QFile file(fileName);
+    REQUIRE(file.open(QIODevice::WriteOnly));
+    file.write("{ \"nodes\": [], \"connections\": [] }");
+    file.close();
+
+    FlowHeader header;
+    CHECK_FALSE(FlowScene::readHeader(fileName, header));
+  }
+}
+
+TEST_CASE("Thumbnails are drawn from the snapshot alone", "[serialization]")
+{
+  auto setup = applicationSetup();
+
+  FlowSnapshot snapshot;
+
+  CHECK(snapshot.renderThumbnail().isNull());
+
+  // a wide flow, read from a file and so without node sizes
+  for (int i = 0; i < 20000; ++i)
+  {
+    FlowSnapshot::NodeRecord node;
+    node.id       = QUuid::createUuid();
+    node.position = QPointF(200 * (i % 1000), 200 * (i / 1000));
+
+    snapshot.nodes.push_back(node);
+  }
+
+  QImage const thumbnail = snapshot.renderThumbnail();
+
+  REQUIRE_FALSE(thumbnail.isNull());
+  CHECK(thumbnail.width() == 256);
+  CHECK(thumbnail.height() < 256);
+
+  // no larger than the cap, however large asked for
+  CHECK(snapshot.renderThumbnail(QSize(8192, 8192)).width() == 1024);
+}
@@ -0,0 +1,181 @@
+#include <nodes/FlowJournal>
+
+#include <nodes/FlowScene>
+#include <nodes/Node>
+
+#include <catch2/catch.hpp>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryDir>
+#include <QtWidgets/QGraphicsObject>
+
+#include <memory>
+
+#include "ApplicationSetup.hpp"
+#include "FlowFixture.hpp"
+#include "ValueDataModel.hpp"
+
+using QtNodes::FlowJournal;
+using QtNodes::FlowScene;
+using QtNodes::Node;
+
+TEST_CASE("FlowJournal recovers edits made after the snapshot", "[serialization]")
+{
+  auto setup = applicationSetup();
+
+  QTemporaryDir dir;
+  REQUIRE(dir.isValid());
+
+  QString const snapshotFile = QDir(dir.path()).filePath("flow.flow");
+  QString const journalFile  = QDir(dir.path()).filePath("flow.journal");
+
+  FlowScene scene(registryWith<ValueDataModel>());
+
+  Node& kept = scene.createNode(std::make_unique<ValueDataModel>());
+
+  FlowJournal journal(scene);
+  REQUIRE(journal.open(snapshotFile, journalFile));
+
+  CHECK(QFileInfo(journalFile).size() == 0);
+
+  Node& a = scene.createNode(std::make_unique<ValueDataModel>());
+  Node& b = scene.createNode(std::make_unique<ValueDataModel>());
+  scene.createConnection(b, 0, a, 0);
+  scene.createConnection(kept, 0, b, 0);
+
+  scene.setNodePosition(a, QPointF(30, 40));
+  valueModel(b).setValue(7);
+
+  Node& removed = scene.createNode(std::make_unique<ValueDataModel>());
+  scene.createConnection(removed, 0, kept, 0);
+
+  QUuid const removedId = removed.id();
+  scene.removeNode(removed);
+
+  // moves and model changes are recorded once the event loop runs
+  QCoreApplication::processEvents();
+
+  FlowScene recovered(registryWith<ValueDataModel>());
+  REQUIRE(FlowJournal::recover(recovered, snapshotFile, journalFile));
+
+  REQUIRE(recovered.nodes().size() == 3);
+  CHECK(recovered.connections().size() == 2);
+
+  Node* recoveredA = recovered.findNode(a.id());
+  Node* recoveredB = recovered.findNode(b.id());
+
+  REQUIRE(recoveredA);
+  REQUIRE(recoveredB);
+  CHECK(recoveredA->nodeGraphicsObject().pos() == QPointF(30, 40));
+  CHECK(valueModel(*recoveredB).value == 7);
+  CHECK(recovered.findNode(removedId) == nullptr);
+
+  SECTION("a torn last record is ignored")
+  {
+    QFile file(journalFile);
+    REQUIRE(file.open(QIODevice::Append));
+    file.write("{\"op\":\"remove\",\"id\":\"");
+    file.close();
+
+    FlowScene again(registryWith<ValueDataModel>());
+    REQUIRE(FlowJournal::recover(again, snapshotFile, journalFile));
+    CHECK(again.nodes().size() == 3);
+  }
+
+  SECTION("a journal from before a compaction replays onto the new snapshot")
+  {
+    QString const stale = QDir(dir.path()).filePath("stale.journal");
+    REQUIRE(QFile::copy(journalFile, stale));
+
+    REQUIRE(journal.compact());
+    CHECK(QFileInfo(journalFile).size() == 0);
+
+    FlowScene again(registryWith<ValueDataModel>());
+    REQUIRE(FlowJournal::recover(again, snapshotFile, stale));
+
+    CHECK(again.nodes().size() == 3);
+    CHECK(again.connections().size() == 2);
+  }
+}
+
+TEST_CASE("FlowJournal records cost in proportion to the edit", "[serialization]")
+{
+  auto setup = applicationSetup();
+
+  QTemporaryDir dir;
+  REQUIRE(dir.isValid());
+
+  QString const snapshotFile = QDir(dir.path()).filePath("flow.flow");
+  QString const journalFile  = QDir(dir.path()).filePath("flow.journal");
+
+  FlowScene scene(registryWith<ValueDataModel>());
+
+  for (int i = 0; i < 200; ++i)
+    scene.createNode(std::make_unique<ValueDataModel>());
+
+  Node& node = scene.createNode(std::make_unique<ValueDataModel>());
+
+  FlowJournal journal(scene);
+  REQUIRE(journal.open(snapshotFile, journalFile));
+
+  qint64 const snapshotSize = QFileInfo(snapshotFile).size();
+
+  valueModel(node).setValue(1);
+  valueModel(node).setValue(2);
+  QCoreApplication::processEvents();
+
+  // one model record, holding the changed value only
+  QFile file(journalFile);
+  REQUIRE(file.open(QIODevice::ReadOnly));
+
+  QByteArray const records = file.readAll();
+  CHECK(records.count('\n') == 1);
+  CHECK(records.contains("\"value\":2"));
+  CHECK_FALSE(records.contains("\"name\""));
+  CHECK(records.size() < snapshotSize / 100);
+
+  SECTION("the journal is compacted once it outgrows the snapshot")
+  {
+    journal.setCompactionThreshold(0);
+
+    bool   compacted = false;
+    qint64 previous  = 0;
+
+    for (int i = 0; !compacted && i < 10000; ++i)
+    {
+      scene.setNodePosition(node, QPointF(i, i));
+      QCoreApplication::processEvents();
+
+      qint64 const size = QFileInfo(journalFile).size();
+      compacted = size < previous;
+      previous  = size;
+    }
+
+    CHECK(compacted);
+    CHECK(previous < snapshotSize);
+
+    FlowScene recovered(registryWith<ValueDataModel>());
+    REQUIRE(FlowJournal::recover(recovered, snapshotFile, journalFile));
+    CHECK(recovered.nodes().size() == 201);
+  }
+
+  SECTION("closing the scene is not recorded as removals")
+  {
+    QString const otherSnapshot = QDir(dir.path()).filePath("other.flow");
+    QString const otherJournal  = QDir(dir.path()).filePath("other.journal");
+
+    {
+      FlowScene other(registryWith<ValueDataModel>());
+      auto otherJournaling = new FlowJournal(other, &other);
+
+      other.createNode(std::make_unique<ValueDataModel>());
+      REQUIRE(otherJournaling->open(otherSnapshot, otherJournal));
+    }
+
+    FlowScene recovered(registryWith<ValueDataModel>());
+    REQUIRE(FlowJournal::recover(recovered, otherSnapshot, otherJournal));
+    CHECK(recovered.nodes().size() == 1);
+  }
+}
@@ -0,0 +1,178 @@
+#include <nodes/FlowLoader>
+
+#include <nodes/FlowScene>
+#include <nodes/Node>
+
+#include <catch2/catch.hpp>
+
+#include <QtTest>
+
+#include <memory>
+#include <utility>
+
+#include "ApplicationSetup.hpp"
+#include "FlowFixture.hpp"
+#include "PortsDataModel.hpp"
+
+using QtNodes::FlowLoader;
+using QtNodes::FlowScene;
+using QtNodes::Node;
+
+namespace
+{
+
+void
+waitForLoader(FlowLoader const & loader)
+{
+  for (int i = 0; i < 5000 && loader.isRunning(); ++i)
+    QTest::qWait(1);
+}
+
+}
+
+TEST_CASE("FlowLoader builds the scene in the background", "[serialization]")
+{
+  auto setup = applicationSetup();
+
+  auto registry = registryWith<PortsDataModel>();
+
+  FlowScene source(registry);
+
+  Node* previous = nullptr;
+
+  for (int i = 0; i < 100; ++i)
+  {
+    Node& node = source.createNode(std::make_unique<PortsDataModel>());
+
+    if (previous)
+      source.createConnection(node, 0, *previous, 0);
+
+    previous = &node;
+  }
+
+  TestDirectory dir;
+
+  QString const jsonFile   = dir.filePath("flow.flow");
+  QString const binaryFile = dir.filePath("flow.flowb");
+
+  REQUIRE(source.saveToFile(jsonFile));
+  REQUIRE(source.saveToFile(binaryFile, FlowScene::FileFormat::Binary));
+
+  FlowScene scene(registry);
+  FlowLoader loader(scene);
+
+  // one batch of nodes or one connection per slice
+  loader.setSliceBudget(0);
+
+  int finished  = 0;
+  int lastBuilt = 0;
+  int slices    = 0;
+
+  QObject::connect(&loader, &FlowLoader::finished, [&] { ++finished; });
+  QObject::connect(&loader, &FlowLoader::buildingProgress,
+                   [&](int built, int total)
+  {
+    CHECK(built >= lastBuilt);
+    CHECK(total == 199);
+    lastBuilt = built;
+    ++slices;
+  });
+
+  SECTION("completes in slices")
+  {
+    for (QString const & fileName : { jsonFile, binaryFile })
+    {
+      scene.clearScene();
+      finished  = 0;
+      lastBuilt = 0;
+      slices    = 0;
+
+      REQUIRE(loader.start(fileName));
+      CHECK_FALSE(loader.start(fileName));
+      CHECK(scene.nodes().empty());
+
+      waitForLoader(loader);
+
+      CHECK(finished == 1);
+      CHECK(slices > 1);
+      CHECK(lastBuilt == 199);
+      CHECK(scene.nodes().size() == 100);
+      CHECK(scene.connections().size() == 99);
+    }
+  }
+
+  SECTION("cancelling removes what was built")
+  {
+    int cancelled = 0;
+    QObject::connect(&loader, &FlowLoader::cancelled, [&] { ++cancelled; });
+
+    QObject::connect(&loader, &FlowLoader::buildingProgress,
+                     &loader, &FlowLoader::cancel);
+
+    REQUIRE(loader.start(jsonFile));
+    waitForLoader(loader);
+
+    CHECK(slices == 1);
+    CHECK(cancelled == 1);
+    CHECK(finished == 0);
+    CHECK(scene.nodes().empty());
+    CHECK(scene.connections().empty());
+  }
+
+  SECTION("nodes deleted while loading are skipped")
+  {
+    QObject::connect(&loader, &FlowLoader::buildingProgress,
+                     [&] { if (slices == 1) scene.clearScene(); });
+
+    REQUIRE(loader.start(jsonFile));
+    waitForLoader(loader);
+
+    CHECK(finished == 1);
+    CHECK(scene.nodes().size() < 100);
+  }
+}
+
+TEST_CASE("FlowLoader reports failures without touching the scene", "[serialization]")
+{
+  auto setup = applicationSetup();
+
+  auto registry = registryWith<PortsDataModel>();
+
+  TestDirectory dir;
+
+  FlowScene scene(registry);
+  FlowLoader loader(scene);
+
+  QString message;
+  QObject::connect(&loader, &FlowLoader::failed,
+                   [&](QString const & m) { message = m; });
+
+  SECTION("missing file")
+  {
+    REQUIRE(loader.start(dir.filePath("missing.flow")));
+    waitForLoader(loader);
+
+    CHECK_FALSE(message.isEmpty());
+  }
+
+  SECTION("unknown model")
+  {
+    auto unknown = std::make_unique<PortsDataModel>();
+    unknown->name("unknown");
+
+    FlowScene source;
+    source.createNode(std::make_unique<PortsDataModel>());
+    source.createNode(std::move(unknown));
+
+    QString const fileName = dir.filePath("flow.flow");
+    REQUIRE(source.saveToFile(fileName));
+
+    REQUIRE(loader.start(fileName));
+    waitForLoader(loader);
+
+    CHECK_FALSE(message.isEmpty());
+  }
+
+  CHECK_FALSE(loader.isRunning());
+  CHECK(scene.nodes().empty());
+}
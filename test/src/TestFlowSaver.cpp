@@ -0,0 +1,118 @@
+#include <nodes/FlowSaver>
+
+#include <nodes/FlowScene>
+#include <nodes/Node>
+
+#include <catch2/catch.hpp>
+
+#include <QtTest>
+
+#include <memory>
+#include <vector>
+
+#include "ApplicationSetup.hpp"
+#include "FlowFixture.hpp"
+#include "PortsDataModel.hpp"
+
+using QtNodes::FlowSaver;
+using QtNodes::FlowScene;
+using QtNodes::Node;
+
+namespace
+{
+
+struct Result
+{
+  QString fileName;
+  bool    success;
+};
+
+void
+waitForSaver(FlowSaver const & saver)
+{
+  for (int i = 0; i < 5000 && saver.isRunning(); ++i)
+    QTest::qWait(1);
+}
+
+}
+
+TEST_CASE("FlowSaver writes a snapshot taken when the save starts", "[serialization]")
+{
+  auto setup = applicationSetup();
+
+  auto registry = registryWith<PortsDataModel>();
+
+  FlowScene scene(registry);
+
+  Node& a = scene.createNode(std::make_unique<PortsDataModel>());
+  Node& b = scene.createNode(std::make_unique<PortsDataModel>());
+  scene.createConnection(b, 0, a, 0);
+
+  TestDirectory dir;
+
+  FlowSaver saver(scene);
+
+  std::vector<Result> results;
+  QObject::connect(&saver, &FlowSaver::finished,
+                   [&](QString const & fileName, bool success, QString const &)
+  {
+    results.push_back({ fileName, success });
+  });
+
+  SECTION("in either format")
+  {
+    QString const jsonFile   = dir.filePath("flow.flow");
+    QString const binaryFile = dir.filePath("flow.flowb");
+
+    saver.start(jsonFile);
+    saver.start(binaryFile, FlowScene::FileFormat::Binary);
+
+    // edits after start() are not part of the saves
+    scene.createNode(std::make_unique<PortsDataModel>());
+
+    waitForSaver(saver);
+
+    REQUIRE(results.size() == 2);
+    CHECK(results[0].fileName == jsonFile);
+    CHECK(results[0].success);
+    CHECK(results[1].fileName == binaryFile);
+    CHECK(results[1].success);
+
+    for (QString const & fileName : { jsonFile, binaryFile })
+    {
+      FlowScene loaded(registry);
+      REQUIRE(loaded.loadFromFile(fileName));
+
+      CHECK(loaded.nodes().size() == 2);
+      CHECK(loaded.connections().size() == 1);
+    }
+  }
+
+  SECTION("saves waiting for the same file are merged")
+  {
+    QString const fileName = dir.filePath("flow.flow");
+
+    saver.start(fileName);
+    saver.start(fileName);
+
+    scene.createNode(std::make_unique<PortsDataModel>());
+    saver.start(fileName);
+
+    waitForSaver(saver);
+
+    CHECK(results.size() == 2);
+
+    FlowScene loaded(registry);
+    REQUIRE(loaded.loadFromFile(fileName));
+    CHECK(loaded.nodes().size() == 3);
+  }
+
+  SECTION("failures are reported")
+  {
+    saver.start(dir.filePath("missing/flow.flow"));
+    waitForSaver(saver);
+
+    REQUIRE(results.size() == 1);
+    CHECK_FALSE(results[0].success);
+  }
+}
@@ -1,5 +1,9 @@
 #include <nodes/FlowScene>
 
+#include <QtCore/QBuffer>
+#include <QtWidgets/QWidget>
+
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <utility>
@@ -12,6 +16,8 @@
 
 #include "ApplicationSetup.hpp"
 #include "Stringify.hpp"
+#include "FlowFixture.hpp"
+#include "PortsDataModel.hpp"
 #include "StubNodeDataModel.hpp"
 
 using QtNodes::Connection;
@@ -254,3 +260,637 @@ TEST_CASE("FlowScene's DataModelRegistry outlives nodes and connections", "[asan
 
   CHECK(modelsDestroyed == 1);
 }
+
+TEST_CASE("FlowScene node ids", "[gui]")
+{
+  auto setup = applicationSetup();
+
+  auto registry = std::make_shared<DataModelRegistry>();
+  registry->registerModel<StubNodeDataModel>();
+
+  FlowScene scene(std::move(registry));
+
+  Node& a = scene.createNode(std::make_unique<StubNodeDataModel>());
+  Node& b = scene.createNode(std::make_unique<StubNodeDataModel>());
+
+  SECTION("new nodes get distinct random UUIDs")
+  {
+    CHECK(a.id() != b.id());
+    CHECK(a.id().version() == QUuid::Random);
+    CHECK(a.id().variant() == QUuid::DCE);
+
+    CHECK(scene.findNode(a.id()) == &a);
+    CHECK(scene.findNode(b.id()) == &b);
+    CHECK(scene.findNode(QUuid::createUuid()) == nullptr);
+  }
+
+  SECTION("restored nodes keep the id from the file")
+  {
+    QJsonObject nodeJson = b.save();
+
+    scene.removeNode(b);
+
+    QUuid const id(nodeJson["id"].toString());
+
+    CHECK(scene.findNode(id) == nullptr);
+
+    Node& restored = scene.restoreNode(nodeJson);
+
+    CHECK(restored.id() == id);
+    CHECK(scene.findNode(id) == &restored);
+  }
+}
+
+TEST_CASE("NodeState numbers connections for routing", "[gui]")
+{
+  struct TwoPortsDataModel : StubNodeDataModel
+  {
+    unsigned int nPorts(PortType) const override { return 2; }
+  };
+
+  auto setup = applicationSetup();
+
+  FlowScene scene;
+
+  Node& source = scene.createNode(std::make_unique<TwoPortsDataModel>());
+  Node& a      = scene.createNode(std::make_unique<TwoPortsDataModel>());
+  Node& b      = scene.createNode(std::make_unique<TwoPortsDataModel>());
+
+  auto toA = scene.createConnection(a, 0, source, 1);
+  auto toB = scene.createConnection(b, 0, source, 0);
+
+  auto const & state = source.nodeState();
+
+  // ordered by port first
+  CHECK(state.connectionIndex(*toB) == 1);
+  CHECK(state.connectionIndex(*toA) == 2);
+
+  SECTION("removing a connection renumbers the others")
+  {
+    scene.deleteConnection(*toB);
+
+    CHECK(state.connectionIndex(*toA) == 1);
+  }
+
+  SECTION("connections attached elsewhere have no ordinal")
+  {
+    auto other = scene.createConnection(b, 1, a, 0);
+
+    CHECK(state.connectionIndex(*other) == 0);
+  }
+}
+
+TEST_CASE("FlowScene creates graphs in bulk", "[gui]")
+{
+  struct RelayDataModel : StubNodeDataModel
+  {
+    unsigned int nPorts(PortType) const override { return 1; }
+
+    std::shared_ptr<NodeData>
+    outData(PortIndex) override { return data; }
+
+    void
+    setInData(std::shared_ptr<NodeData> nodeData, PortIndex) override
+    {
+      ++received;
+      data = std::move(nodeData);
+      Q_EMIT dataUpdated(0);
+    }
+
+    void
+    inputConnectionCreated(Connection const&) override
+    {
+      ++inputsCreated;
+    }
+
+    std::shared_ptr<NodeData> data;
+    int received      = 0;
+    int inputsCreated = 0;
+  };
+
+  struct Value : NodeData
+  {
+    NodeDataType type() const override { return NodeDataType{"value", "Value"}; }
+  };
+
+  auto setup = applicationSetup();
+
+  FlowScene scene;
+
+  int nodeSignals       = 0;
+  int connectionSignals = 0;
+  int graphSignals      = 0;
+
+  QObject::connect(&scene, &FlowScene::nodeCreated,
+                   [&](Node&) { ++nodeSignals; });
+  QObject::connect(&scene, &FlowScene::connectionCreated,
+                   [&](Connection const&) { ++connectionSignals; });
+  QObject::connect(&scene, &FlowScene::graphCreated,
+                   [&](QtNodes::GraphItems const&) { ++graphSignals; });
+
+  std::vector<QtNodes::NodeDescriptor> nodes(4);
+  std::vector<RelayDataModel*> models;
+
+  for (std::size_t i = 0; i < nodes.size(); ++i)
+  {
+    auto model = std::make_unique<RelayDataModel>();
+    models.push_back(model.get());
+
+    nodes[i].model    = std::move(model);
+    nodes[i].position = QPointF(200.0 * i, 0.0);
+  }
+
+  models[0]->data = std::make_shared<Value>();
+
+  // 0 -> 1 -> 3 and 0 -> 2, listed downstream first
+  std::vector<QtNodes::EdgeDescriptor> edges(3);
+  edges[0].outNode = 1; edges[0].outPort = 0; edges[0].inNode = 3; edges[0].inPort = 0;
+  edges[1].outNode = 0; edges[1].outPort = 0; edges[1].inNode = 1; edges[1].inPort = 0;
+  edges[2].outNode = 0; edges[2].outPort = 0; edges[2].inNode = 2; edges[2].inPort = 0;
+
+  SECTION("items are created with the per item notifications")
+  {
+    QtNodes::GraphItems items = scene.createGraph(std::move(nodes), edges);
+
+    CHECK(items.nodes.size() == 4);
+    CHECK(items.connections.size() == 3);
+    CHECK(scene.nodes().size() == 4);
+    CHECK(scene.connections().size() == 3);
+
+    CHECK(nodeSignals == 4);
+    CHECK(connectionSignals == 3);
+    CHECK(graphSignals == 1);
+
+    CHECK(items.nodes[2]->nodeGraphicsObject().pos() == QPointF(400.0, 0.0));
+    CHECK(items.nodes[2]->nodeGraphicsObject().scene() == &scene);
+
+    CHECK(models[3]->inputsCreated == 1);
+
+    // each output is delivered once, upstream first
+    CHECK(models[1]->received == 1);
+    CHECK(models[2]->received == 1);
+    CHECK(models[3]->data == models[0]->data);
+
+    SECTION("bulk created connections are regular connections")
+    {
+      scene.deleteConnection(*items.connections[1]);
+
+      CHECK(scene.connections().size() == 2);
+      CHECK(models[1]->data == nullptr);
+    }
+  }
+
+  SECTION("invalid edges leave the scene untouched")
+  {
+    edges[0].inPort = 1;
+
+    CHECK_THROWS_AS(scene.createGraph(std::move(nodes), edges), std::logic_error);
+
+    CHECK(scene.nodes().empty());
+    CHECK(scene.connections().empty());
+    CHECK(graphSignals == 0);
+  }
+
+  SECTION("an input takes a single connection")
+  {
+    edges[0].outNode = 2;
+    edges.push_back(edges[0]);
+    edges.back().outNode = 1;
+
+    CHECK_THROWS_AS(scene.createGraph(std::move(nodes), edges), std::logic_error);
+
+    CHECK(scene.nodes().empty());
+  }
+
+  SECTION("node ids are unique")
+  {
+    QUuid const id = QUuid::createUuid();
+
+    nodes[0].id = id;
+    nodes[3].id = id;
+
+    CHECK_THROWS_AS(scene.createGraph(std::move(nodes), edges), std::logic_error);
+
+    CHECK(scene.nodes().empty());
+    CHECK(scene.findNode(id) == nullptr);
+  }
+}
+
+TEST_CASE("FlowScene removes nodes in bulk", "[gui]")
+{
+  struct CountingDataModel : StubNodeDataModel
+  {
+    CountingDataModel(int & received, int & disconnected)
+      : received(received)
+      , disconnected(disconnected)
+    {}
+
+    unsigned int nPorts(PortType) const override { return 1; }
+
+    void
+    setInData(std::shared_ptr<NodeData>, PortIndex) override
+    {
+      ++received;
+    }
+
+    void
+    inputConnectionDeleted(Connection const&) override
+    {
+      ++disconnected;
+    }
+
+    void
+    outputConnectionDeleted(Connection const&) override
+    {
+      ++disconnected;
+    }
+
+    int & received;
+    int & disconnected;
+  };
+
+  auto setup = applicationSetup();
+
+  FlowScene scene;
+
+  int received[4]     = {};
+  int disconnected[4] = {};
+  std::vector<Node*> nodes;
+
+  for (int i = 0; i < 4; ++i)
+  {
+    nodes.push_back(&scene.createNode(
+                      std::make_unique<CountingDataModel>(received[i], disconnected[i])));
+  }
+
+  // 0 -> 1 -> 2 -> 3
+  for (int i = 0; i < 3; ++i)
+    scene.createConnection(*nodes[i + 1], 0, *nodes[i], 0);
+
+  std::fill(std::begin(received), std::end(received), 0);
+
+  int deleted    = 0;
+  int afterCalls = 0;
+
+  QObject::connect(&scene, &FlowScene::nodeDeleted,
+                   [&](Node&) { ++deleted; });
+  QObject::connect(&scene, &FlowScene::afterNodeDeleted,
+                   [&]() { ++afterCalls; });
+
+  SECTION("only the remaining nodes get notified")
+  {
+    scene.removeNodes({ nodes[1], nodes[2] });
+
+    CHECK(scene.nodes().size() == 2);
+    CHECK(scene.connections().empty());
+    CHECK(deleted == 2);
+    CHECK(afterCalls == 1);
+
+    CHECK(received[0] == 0);
+    CHECK(received[1] == 0);
+    CHECK(received[2] == 0);
+    CHECK(received[3] == 1);
+
+    CHECK(disconnected[0] == 1);
+    CHECK(disconnected[1] == 0);
+    CHECK(disconnected[2] == 0);
+    CHECK(disconnected[3] == 1);
+
+    CHECK(scene.downstreamNodes(*nodes[0]).empty());
+    CHECK(scene.upstreamNodes(*nodes[3]).empty());
+  }
+
+  SECTION("clearScene propagates nothing")
+  {
+    scene.clearScene();
+
+    CHECK(scene.nodes().empty());
+    CHECK(scene.connections().empty());
+    CHECK(deleted == 4);
+
+    CHECK(std::count(std::begin(received), std::end(received), 0) == 4);
+  }
+}
+
+TEST_CASE("FlowScene refuses cycles", "[gui]")
+{
+  auto setup = applicationSetup();
+
+  FlowScene scene;
+
+  Node& a = scene.createNode(std::make_unique<PortsDataModel>());
+  Node& b = scene.createNode(std::make_unique<PortsDataModel>());
+  Node& c = scene.createNode(std::make_unique<PortsDataModel>());
+
+  // c -> b -> a, against the creation order
+  auto cb = scene.createConnection(b, 0, c, 0);
+  scene.createConnection(a, 0, b, 0);
+
+  CHECK(scene.wouldCreateCycle(a, c));
+  CHECK(scene.wouldCreateCycle(a, a));
+  CHECK_FALSE(scene.wouldCreateCycle(c, a));
+
+  CHECK_THROWS_AS(scene.createConnection(c, 0, a, 0), std::logic_error);
+  CHECK(scene.connections().size() == 2);
+
+  SECTION("deleting a connection allows it again")
+  {
+    scene.deleteConnection(*cb);
+
+    CHECK_FALSE(scene.wouldCreateCycle(a, c));
+    CHECK_NOTHROW(scene.createConnection(c, 0, a, 0));
+  }
+
+  SECTION("removed nodes leave the order")
+  {
+    scene.removeNode(b);
+
+    CHECK_FALSE(scene.wouldCreateCycle(a, c));
+  }
+
+  SECTION("createGraph checks its own edges")
+  {
+    std::vector<QtNodes::NodeDescriptor> nodes(2);
+    nodes[0].model = std::make_unique<PortsDataModel>();
+    nodes[1].model = std::make_unique<PortsDataModel>();
+
+    std::vector<QtNodes::EdgeDescriptor> edges(2);
+    edges[0].outNode = 0; edges[0].outPort = 0; edges[0].inNode = 1; edges[0].inPort = 0;
+    edges[1].outNode = 1; edges[1].outPort = 0; edges[1].inNode = 0; edges[1].inPort = 0;
+
+    CHECK_THROWS_AS(scene.createGraph(std::move(nodes), edges), std::logic_error);
+    CHECK(scene.nodes().size() == 3);
+  }
+
+  SECTION("flows containing a cycle still load")
+  {
+    // 0 -> 1 -> 2 -> 0, the last connection closing the cycle
+    QtNodes::FlowSnapshot snapshot;
+    snapshot.nodes.resize(3);
+    snapshot.connections.resize(3);
+
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+      snapshot.nodes[i].id    = QUuid::createUuid();
+      snapshot.nodes[i].model = PortsDataModel().save();
+
+      snapshot.connections[i].outNode = i;
+      snapshot.connections[i].inNode  = (i + 1) % 3;
+    }
+
+    auto registry = registryWith<PortsDataModel>();
+
+    FlowScene loaded(registry);
+
+    SECTION("JSON")
+    {
+      QBuffer buffer;
+      buffer.open(QIODevice::WriteOnly);
+      snapshot.writeJson(buffer);
+
+      loaded.loadFromMemory(buffer.data());
+    }
+
+    SECTION("binary")
+    {
+      loaded.restoreSnapshot(snapshot);
+    }
+
+    CHECK(loaded.nodes().size() == 3);
+    CHECK(loaded.connections().size() == 2);
+  }
+}
+
+TEST_CASE("FlowScene answers upstream and downstream queries", "[gui]")
+{
+  auto setup = applicationSetup();
+
+  FlowScene scene;
+
+  Node& a = scene.createNode(std::make_unique<PortsDataModel>());
+  Node& b = scene.createNode(std::make_unique<PortsDataModel>());
+  Node& c = scene.createNode(std::make_unique<PortsDataModel>());
+  Node& d = scene.createNode(std::make_unique<PortsDataModel>());
+
+  // a -> b -> c, d stays unconnected
+  scene.createConnection(b, 0, a, 0);
+  auto bc = scene.createConnection(c, 0, b, 0);
+
+  CHECK(scene.isUpstream(a, c));
+  CHECK_FALSE(scene.isUpstream(c, a));
+  CHECK_FALSE(scene.isUpstream(a, a));
+  CHECK_FALSE(scene.isUpstream(a, d));
+
+  auto sorted = [](std::vector<Node*> nodes)
+  {
+    std::sort(nodes.begin(), nodes.end());
+    return nodes;
+  };
+
+  CHECK(sorted(scene.downstreamNodes(a)) == sorted({&b, &c}));
+  CHECK(sorted(scene.upstreamNodes(c)) == sorted({&a, &b}));
+  CHECK(scene.downstreamNodes(d).empty());
+
+  SECTION("deleting a connection splits the cone")
+  {
+    scene.deleteConnection(*bc);
+
+    CHECK_FALSE(scene.isUpstream(a, c));
+    CHECK(scene.downstreamNodes(a) == std::vector<Node*>{&b});
+  }
+
+  SECTION("removed nodes leave the cone")
+  {
+    scene.removeNode(b);
+
+    CHECK(scene.downstreamNodes(a).empty());
+    CHECK(scene.upstreamNodes(c).empty());
+  }
+}
+
+TEST_CASE("FlowScene coalesces node moves", "[gui]")
+{
+  auto setup = applicationSetup();
+
+  FlowScene scene;
+
+  Node& a = scene.createNode(std::make_unique<StubNodeDataModel>());
+  Node& b = scene.createNode(std::make_unique<StubNodeDataModel>());
+
+  std::vector<std::pair<Node*, QPointF>> moves;
+
+  QObject::connect(&scene, &FlowScene::nodeMoved,
+                   [&](Node& n, QPointF const& pos) { moves.emplace_back(&n, pos); });
+
+  scene.setNodePosition(a, QPointF(10, 0));
+  scene.setNodePosition(a, QPointF(10, 20));
+  scene.setNodePosition(b, QPointF(5, 5));
+
+  CHECK(moves.empty());
+
+  QCoreApplication::processEvents();
+
+  REQUIRE(moves.size() == 2);
+  CHECK(moves[0].first == &a);
+  CHECK(moves[0].second == QPointF(10, 20));
+  CHECK(moves[1].first == &b);
+
+  SECTION("removed nodes are not reported")
+  {
+    moves.clear();
+
+    scene.setNodePosition(b, QPointF(0, 0));
+    scene.removeNode(b);
+
+    QCoreApplication::processEvents();
+
+    CHECK(moves.empty());
+  }
+}
+
+TEST_CASE("FlowScene caches nodes depending on the zoom", "[gui]")
+{
+  auto setup = applicationSetup();
+
+  FlowScene scene;
+
+  Node& shown  = scene.createNode(std::make_unique<StubNodeDataModel>());
+  Node& hidden = scene.createNode(std::make_unique<StubNodeDataModel>());
+  scene.setNodePosition(hidden, QPointF(10000, 10000));
+
+  auto& shownItem  = shown.nodeGraphicsObject();
+  auto& hiddenItem = hidden.nodeGraphicsObject();
+
+  CHECK(shownItem.cacheMode() == QGraphicsItem::DeviceCoordinateCache);
+
+  QRectF const visible(-100, -100, 500, 500);
+
+  scene.setViewScale(1.5, visible);
+
+  CHECK(shownItem.cacheMode() == QGraphicsItem::NoCache);
+  CHECK(hiddenItem.cacheMode() == QGraphicsItem::DeviceCoordinateCache);
+  CHECK_FALSE(hiddenItem.cacheModeCurrent());
+
+  SECTION("nodes coming into view are updated")
+  {
+    scene.setViewScale(1.8, QRectF(9900, 9900, 500, 500));
+
+    CHECK(hiddenItem.cacheMode() == QGraphicsItem::NoCache);
+  }
+
+  SECTION("zooming back out restores the cache")
+  {
+    scene.setViewScale(0.8, visible);
+
+    CHECK(shownItem.cacheMode() == QGraphicsItem::DeviceCoordinateCache);
+  }
+}
+
+TEST_CASE("FlowScene caches nodes depending on their height", "[gui]")
+{
+  struct WidgetDataModel : StubNodeDataModel
+  {
+    // owned by the node's proxy widget once embedded
+    QWidget* widget = new QWidget;
+
+    QWidget*
+    embeddedWidget() override { return widget; }
+  };
+
+  auto setup = applicationSetup();
+
+  FlowScene scene;
+
+  auto model = std::make_unique<WidgetDataModel>();
+  WidgetDataModel& widgetModel = *model;
+
+  widgetModel.widget->setFixedSize(100, 100);
+
+  Node& node = scene.createNode(std::move(model));
+  auto& item = node.nodeGraphicsObject();
+
+  CHECK(item.cacheMode() == QGraphicsItem::DeviceCoordinateCache);
+
+  widgetModel.widget->setFixedSize(100, 1200);
+  Q_EMIT widgetModel.embeddedWidgetSizeUpdated();
+
+  CHECK(item.cacheMode() == QGraphicsItem::NoCache);
+
+  widgetModel.widget->setFixedSize(100, 100);
+  Q_EMIT widgetModel.embeddedWidgetSizeUpdated();
+
+  CHECK(item.cacheMode() == QGraphicsItem::DeviceCoordinateCache);
+}
+
+TEST_CASE("FlowScene copies and pastes the selection", "[gui]")
+{
+  auto setup = applicationSetup();
+
+  auto registry = registryWith<PortsDataModel>();
+
+  FlowScene scene(registry);
+
+  Node& a = scene.createNode(std::make_unique<PortsDataModel>());
+  Node& b = scene.createNode(std::make_unique<PortsDataModel>());
+  Node& c = scene.createNode(std::make_unique<PortsDataModel>());
+
+  scene.setNodePosition(b, QPointF(200, 0));
+  scene.setNodePosition(c, QPointF(400, 0));
+
+  // a -> b is copied, b -> c leaves the selection
+  scene.createConnection(b, 0, a, 0);
+  scene.createConnection(c, 0, b, 0);
+
+  a.nodeGraphicsObject().setSelected(true);
+  b.nodeGraphicsObject().setSelected(true);
+
+  QByteArray const data = scene.copySelection();
+
+  SECTION("into another scene")
+  {
+    FlowScene other(registry);
+
+    QtNodes::GraphItems items = other.paste(data, QPointF(10, 20));
+
+    REQUIRE(items.nodes.size() == 2);
+    CHECK(other.connections().size() == 1);
+
+    std::vector<QPointF> positions;
+
+    for (Node* node : items.nodes)
+      positions.push_back(node->nodeGraphicsObject().pos());
+
+    std::sort(positions.begin(), positions.end(),
+              [](QPointF const & l, QPointF const & r) { return l.x() < r.x(); });
+
+    CHECK(positions[0] == QPointF(10, 20));
+    CHECK(positions[1] == QPointF(210, 20));
+
+    CHECK(other.selectedNodes().size() == 2);
+  }
+
+  SECTION("into the same scene")
+  {
+    QtNodes::GraphItems items = scene.paste(data);
+
+    CHECK(scene.nodes().size() == 5);
+    CHECK(scene.connections().size() == 3);
+
+    // the pasted nodes get ids of their own and replace the selection
+    for (Node* node : items.nodes)
+    {
+      CHECK((node->id() != a.id() && node->id() != b.id()));
+      CHECK(scene.findNode(node->id()) == node);
+    }
+
+    CHECK_FALSE(a.nodeGraphicsObject().isSelected());
+    CHECK(scene.selectedNodes().size() == 2);
+  }
+
+  SECTION("malformed data")
+  {
+    CHECK_THROWS_AS(scene.paste(data.left(data.size() / 2)), std::logic_error);
+
+    CHECK(scene.nodes().size() == 3);
+  }
+}
@@ -0,0 +1,209 @@
+#include <nodes/FlowUndoStack>
+
+#include <nodes/FlowScene>
+#include <nodes/Node>
+
+#include <catch2/catch.hpp>
+
+#include <QtWidgets/QGraphicsObject>
+
+#include <memory>
+
+#include "ApplicationSetup.hpp"
+#include "FlowFixture.hpp"
+#include "ValueDataModel.hpp"
+
+using QtNodes::FlowScene;
+using QtNodes::FlowUndoStack;
+using QtNodes::Node;
+
+namespace
+{
+
+// Lets the undo stack close the step of the edits made so far.
+void
+endTurn()
+{
+  QCoreApplication::processEvents();
+}
+
+}
+
+TEST_CASE("FlowUndoStack undoes and redoes edits", "[undo]")
+{
+  auto setup = applicationSetup();
+
+  auto registry = registryWith<ValueDataModel>();
+
+  FlowScene scene(registry);
+
+  Node& a = scene.createNode(std::make_unique<ValueDataModel>());
+  QUuid const idA = a.id();
+
+  FlowUndoStack stack(scene);
+  CHECK_FALSE(stack.canUndo());
+
+  Node& b = scene.createNode(std::make_unique<ValueDataModel>());
+  QUuid const idB = b.id();
+  scene.createConnection(b, 0, a, 0);
+  endTurn();
+
+  CHECK(stack.undoCount() == 1);
+
+  SECTION("creation and connection")
+  {
+    stack.undo();
+
+    CHECK(scene.nodes().size() == 1);
+    CHECK(scene.connections().size() == 0);
+    CHECK(stack.canRedo());
+
+    stack.redo();
+
+    CHECK(scene.nodes().size() == 2);
+    CHECK(scene.connections().size() == 1);
+    CHECK(scene.findNode(idB) != nullptr);
+  }
+
+  SECTION("removal brings back the connections")
+  {
+    valueModel(b).setValue(5);
+    scene.removeNode(b);
+    endTurn();
+
+    CHECK(stack.undoCount() == 2);
+
+    stack.undo();
+
+    Node* restored = scene.findNode(idB);
+    REQUIRE(restored);
+    CHECK(scene.connections().size() == 1);
+
+    // the change made right before the removal is part of the same step
+    CHECK(valueModel(*restored).value == 0);
+
+    stack.redo();
+    CHECK(scene.findNode(idB) == nullptr);
+    CHECK(scene.connections().size() == 0);
+  }
+
+  SECTION("model changes")
+  {
+    valueModel(a).setValue(3);
+    endTurn();
+
+    valueModel(a).setValue(4);
+    endTurn();
+
+    CHECK(stack.undoCount() == 3);
+
+    stack.undo();
+    CHECK(valueModel(*scene.findNode(idA)).value == 3);
+
+    stack.undo();
+    CHECK(valueModel(*scene.findNode(idA)).value == 0);
+
+    stack.redo();
+    stack.redo();
+    CHECK(valueModel(*scene.findNode(idA)).value == 4);
+  }
+
+  SECTION("a new edit drops the redo steps")
+  {
+    stack.undo();
+    REQUIRE(stack.canRedo());
+
+    scene.createNode(std::make_unique<ValueDataModel>());
+    endTurn();
+
+    CHECK_FALSE(stack.canRedo());
+  }
+}
+
+TEST_CASE("FlowUndoStack merges the moves of a drag", "[undo]")
+{
+  auto setup = applicationSetup();
+
+  FlowScene scene;
+
+  Node& node = scene.createNode(std::make_unique<ValueDataModel>());
+  scene.setNodePosition(node, QPointF(10, 10));
+  endTurn();
+
+  FlowUndoStack stack(scene);
+  stack.setMoveMergeInterval(60 * 1000);
+
+  for (int i = 1; i <= 20; ++i)
+  {
+    scene.setNodePosition(node, QPointF(10 + i, 10 + 2 * i));
+    endTurn();
+    endTurn();
+  }
+
+  CHECK(stack.undoCount() == 1);
+
+  stack.undo();
+  endTurn();
+
+  CHECK(node.nodeGraphicsObject().pos() == QPointF(10, 10));
+
+  // the move made by undo() is not recorded
+  CHECK(stack.undoCount() == 0);
+  CHECK(stack.canRedo());
+
+  stack.redo();
+  CHECK(node.nodeGraphicsObject().pos() == QPointF(30, 50));
+}
+
+TEST_CASE("FlowUndoStack keeps within its memory limit", "[undo]")
+{
+  auto setup = applicationSetup();
+
+  FlowScene scene;
+  FlowUndoStack stack(scene);
+
+  for (int i = 0; i < 10; ++i)
+  {
+    scene.createNode(std::make_unique<ValueDataModel>());
+    endTurn();
+  }
+
+  REQUIRE(stack.undoCount() == 10);
+
+  std::size_t const perStep = stack.memoryUsage() / 10;
+
+  stack.setMemoryLimit(perStep * 4);
+
+  CHECK(stack.undoCount() <= 4);
+  CHECK(stack.memoryUsage() <= stack.memoryLimit());
+
+  // the most recent steps are kept
+  stack.undo();
+  CHECK(scene.nodes().size() == 9);
+}
+
+TEST_CASE("FlowUndoStack lowers its memory limit while a step is open", "[undo]")
+{
+  auto setup = applicationSetup();
+
+  FlowScene scene;
+  FlowUndoStack stack(scene);
+
+  // the step of this creation is still open
+  scene.createNode(std::make_unique<ValueDataModel>());
+
+  stack.setMemoryLimit(0);
+
+  CHECK(stack.undoCount() == 0);
+  CHECK(stack.memoryUsage() == 0);
+
+  // recording goes on with a step of its own
+  stack.setMemoryLimit(16 * 1024 * 1024);
+  scene.createNode(std::make_unique<ValueDataModel>());
+  endTurn();
+
+  CHECK(stack.undoCount() == 1);
+
+  stack.undo();
+  CHECK(scene.nodes().size() == 1);
+}
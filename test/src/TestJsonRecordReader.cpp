@@ -0,0 +1,124 @@
+#include <nodes/JsonRecordReader>
+
+#include <nodes/FlowScene>
+#include <nodes/Node>
+
+#include <catch2/catch.hpp>
+
+#include <QtCore/QBuffer>
+#include <QtCore/QJsonDocument>
+
+#include <memory>
+#include <stdexcept>
+
+#include "ApplicationSetup.hpp"
+#include "FlowFixture.hpp"
+#include "PortsDataModel.hpp"
+
+using QtNodes::FlowScene;
+using QtNodes::JsonRecordReader;
+
+TEST_CASE("JsonRecordReader hands out array elements one at a time", "[serialization]")
+{
+  QByteArray const json =
+    "{ \"version\": { \"major\": [1, 2] },\n"
+    "  \"nodes\": [ {\"id\": \"a\", \"text\": \"} ] \\\" {\"}, {\"id\": \"b\"} ],\n"
+    "  \"empty\": [],\n"
+    "  \"connections\": [ {\"in\": 1} ] }";
+
+  QBuffer buffer;
+  buffer.setData(json);
+  buffer.open(QIODevice::ReadOnly);
+
+  // tiny blocks make records span several reads
+  JsonRecordReader reader(buffer, 3);
+
+  REQUIRE(reader.next());
+  CHECK(reader.key() == "nodes");
+  CHECK(reader.record()["text"].toString() == "} ] \" {");
+
+  REQUIRE(reader.next());
+  CHECK(reader.record()["id"].toString() == "b");
+
+  REQUIRE(reader.next());
+  CHECK(reader.key() == "connections");
+  CHECK(reader.record()["in"].toInt() == 1);
+
+  CHECK_FALSE(reader.next());
+  CHECK_FALSE(reader.next());
+}
+
+TEST_CASE("JsonRecordReader rejects broken input", "[serialization]")
+{
+  auto readAll = [](QByteArray const & json)
+  {
+    QBuffer buffer;
+    buffer.setData(json);
+    buffer.open(QIODevice::ReadOnly);
+
+    JsonRecordReader reader(buffer);
+    while (reader.next())
+      reader.record();
+  };
+
+  CHECK_NOTHROW(readAll(""));
+  CHECK_THROWS_AS(readAll("[]"), std::logic_error);
+  CHECK_THROWS_AS(readAll("{\"nodes\": [{\"id\": 1}"), std::logic_error);
+  CHECK_THROWS_AS(readAll("{\"nodes\": [{\"id\" 1}]}"), std::logic_error);
+}
+
+TEST_CASE("FlowScene streams JSON flows in either key order", "[serialization]")
+{
+  auto setup = applicationSetup();
+
+  auto registry = registryWith<PortsDataModel>();
+
+  FlowScene scene(registry);
+
+  auto& a = scene.createNode(std::make_unique<PortsDataModel>());
+  auto& b = scene.createNode(std::make_unique<PortsDataModel>());
+  auto& c = scene.createNode(std::make_unique<PortsDataModel>());
+  scene.createConnection(b, 0, a, 0);
+  scene.createConnection(c, 0, b, 0);
+
+  SECTION("nodes first, as saveToMemory() writes")
+  {
+    FlowScene loaded(registry);
+    loaded.loadFromMemory(scene.saveToMemory());
+
+    CHECK(loaded.nodes().size() == 3);
+    CHECK(loaded.connections().size() == 2);
+  }
+
+  QByteArray const json =
+    QJsonDocument(QJsonDocument::fromJson(scene.snapshot().toJson()).object()).toJson();
+  REQUIRE(json.indexOf("connections") < json.indexOf("nodes"));
+
+  SECTION("connections first, as QJsonDocument writes")
+  {
+    FlowScene loaded(registry);
+    loaded.loadFromMemory(json);
+
+    CHECK(loaded.nodes().size() == 3);
+    CHECK(loaded.connections().size() == 2);
+    CHECK(loaded.isUpstream(*loaded.findNode(a.id()), *loaded.findNode(c.id())));
+  }
+
+  SECTION("connections first, from a device read only once")
+  {
+    struct SequentialBuffer : QBuffer
+    {
+      bool isSequential() const override { return true; }
+    };
+
+    SequentialBuffer buffer;
+    buffer.setData(json);
+    buffer.open(QIODevice::ReadOnly);
+
+    FlowScene loaded(registry);
+    loaded.loadFromDevice(buffer);
+
+    CHECK(loaded.nodes().size() == 3);
+    CHECK(loaded.connections().size() == 2);
+  }
+}
@@ -0,0 +1,90 @@
+#include <nodes/ObjectPool>
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <vector>
+
+using QtNodes::ObjectPool;
+using QtNodes::PoolAllocated;
+using QtNodes::PoolAllocator;
+
+TEST_CASE("ObjectPool recycles blocks", "[memory]")
+{
+  ObjectPool pool;
+
+  SECTION("blocks are aligned and distinct")
+  {
+    std::set<void*> blocks;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+      void* p = pool.allocate(72);
+
+      CHECK(reinterpret_cast<std::uintptr_t>(p) % ObjectPool::Alignment == 0);
+      CHECK(blocks.insert(p).second);
+    }
+
+    auto stats = pool.statistics();
+    CHECK(stats.allocations == 1000);
+    CHECK(stats.blocksInUse == 1000);
+    CHECK(stats.systemAllocations < 10);
+
+    for (void* p : blocks)
+      pool.deallocate(p, 72);
+
+    CHECK(pool.statistics().blocksInUse == 0);
+  }
+
+  SECTION("a released block is handed out again for the same size class")
+  {
+    void* first = pool.allocate(40);
+    pool.deallocate(first, 40);
+
+    CHECK(pool.allocate(48) == first);
+    CHECK(pool.statistics().systemAllocations == 1);
+  }
+
+  SECTION("oversized requests bypass the pool")
+  {
+    void* p = pool.allocate(ObjectPool::MaxPooledSize + 1);
+
+    CHECK(pool.statistics().bytesReserved == 0);
+    CHECK(pool.statistics().systemAllocations == 1);
+
+    pool.deallocate(p, ObjectPool::MaxPooledSize + 1);
+  }
+}
+
+TEST_CASE("PoolAllocated and PoolAllocator use the shared pool", "[memory]")
+{
+  struct Base : PoolAllocated
+  {
+    virtual ~Base() = default;
+    int a = 0;
+  };
+
+  struct Derived : Base
+  {
+    double b[20] = {};
+  };
+
+  ObjectPool& pool = ObjectPool::instance();
+
+  auto const before = pool.statistics();
+
+  {
+    std::unique_ptr<Base> object(new Derived);
+
+    auto shared = std::allocate_shared<Derived>(PoolAllocator<Derived>());
+
+    CHECK(pool.statistics().blocksInUse == before.blocksInUse + 2);
+  }
+
+  auto const after = pool.statistics();
+
+  CHECK(after.blocksInUse == before.blocksInUse);
+  CHECK(after.allocations - before.allocations == 2);
+}
@@ -0,0 +1,264 @@
+#include <nodes/ReachabilityIndex>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+using QtNodes::ReachabilityIndex;
+using QtNodes::TopologicalOrder;
+
+namespace
+{
+
+// plain depth first search as the reference
+std::vector<char>
+reachableFrom(TopologicalOrder const & graph, unsigned v)
+{
+  std::vector<char> seen(graph.vertexBound(), 0);
+  std::vector<unsigned> stack{v};
+
+  while (!stack.empty())
+  {
+    unsigned u = stack.back();
+    stack.pop_back();
+
+    for (unsigned w : graph.successors(u))
+    {
+      if (!seen[w])
+      {
+        seen[w] = 1;
+        stack.push_back(w);
+      }
+    }
+  }
+
+  return seen;
+}
+
+}
+
+TEST_CASE("ReachabilityIndex keeps the closure of small graphs", "[topology]")
+{
+  TopologicalOrder graph;
+  ReachabilityIndex index(graph);
+
+  for (unsigned v = 0; v < 5; ++v)
+    graph.addVertex(v);
+
+  index.invalidate();
+
+  auto connect = [&](unsigned from, unsigned to)
+  {
+    REQUIRE(graph.addEdge(from, to));
+    index.edgeAdded(from, to);
+  };
+
+  // 0 -> 1 -> 2, 3 -> 1, 4 alone
+  connect(1, 2);
+  CHECK(index.usesClosure());
+
+  connect(0, 1);
+  connect(3, 1);
+
+  CHECK(index.reaches(0, 2));
+  CHECK(index.reaches(3, 2));
+  CHECK(index.reaches(2, 2));
+  CHECK_FALSE(index.reaches(2, 0));
+  CHECK_FALSE(index.reaches(0, 3));
+  CHECK_FALSE(index.reaches(4, 2));
+
+  auto downstream = index.descendants(0);
+  std::sort(downstream.begin(), downstream.end());
+  CHECK(downstream == std::vector<unsigned>{1, 2});
+
+  auto upstream = index.ancestors(2);
+  std::sort(upstream.begin(), upstream.end());
+  CHECK(upstream == std::vector<unsigned>{0, 1, 3});
+
+  SECTION("removals are picked up after invalidation")
+  {
+    graph.removeEdge(0, 1);
+    index.invalidate();
+
+    CHECK_FALSE(index.reaches(0, 2));
+    CHECK(index.reaches(3, 2));
+  }
+
+  SECTION("removals are applied in place")
+  {
+    std::size_t const builds = index.buildCount();
+
+    // a parallel edge keeps the pair connected
+    connect(0, 1);
+    graph.removeEdge(0, 1);
+    index.edgeRemoved(0, 1);
+
+    CHECK(index.reaches(0, 2));
+
+    graph.removeEdge(0, 1);
+    index.edgeRemoved(0, 1);
+
+    CHECK_FALSE(index.reaches(0, 1));
+    CHECK_FALSE(index.reaches(0, 2));
+    CHECK(index.reaches(3, 2));
+    CHECK(index.ancestors(2) == std::vector<unsigned>{1, 3});
+
+    graph.removeEdge(1, 2);
+    index.edgeRemoved(1, 2);
+    graph.removeVertex(2);
+    index.vertexRemoved(2);
+
+    CHECK(index.descendants(3) == std::vector<unsigned>{1});
+
+    CHECK(index.buildCount() == builds);
+  }
+
+  SECTION("the edges of a removed vertex go in one update")
+  {
+    std::size_t const builds = index.buildCount();
+
+    graph.removeVertex(1);
+    index.edgesRemoved({ { 0, 1 }, { 3, 1 }, { 1, 2 } });
+    index.vertexRemoved(1);
+
+    CHECK_FALSE(index.reaches(0, 2));
+    CHECK_FALSE(index.reaches(3, 2));
+    CHECK(index.descendants(0).empty());
+    CHECK(index.ancestors(2).empty());
+
+    CHECK(index.buildCount() == builds);
+  }
+}
+
+TEST_CASE("ReachabilityIndex agrees with a search in both modes", "[topology]")
+{
+  std::mt19937 random(11);
+
+  for (unsigned vertexCount : { 300u, unsigned(ReachabilityIndex::ClosureLimit + 900) })
+  {
+    TopologicalOrder graph;
+    ReachabilityIndex index(graph);
+
+    for (unsigned v = 0; v < vertexCount; ++v)
+      graph.addVertex(v);
+
+    std::uniform_int_distribution<unsigned> vertex(0, vertexCount - 1);
+
+    std::vector<std::pair<unsigned, unsigned>> edges;
+
+    for (unsigned i = 0; i < vertexCount * 2; ++i)
+    {
+      unsigned const from = vertex(random);
+      unsigned const to   = vertex(random);
+
+      if (graph.addEdge(from, to))
+      {
+        index.edgeAdded(from, to);
+        edges.emplace_back(from, to);
+      }
+    }
+
+    CHECK(index.usesClosure() == (vertexCount <= ReachabilityIndex::ClosureLimit));
+
+    std::size_t const builds = index.buildCount();
+
+    for (std::size_t i = 0; i < edges.size(); i += 3)
+    {
+      graph.removeEdge(edges[i].first, edges[i].second);
+      index.edgeRemoved(edges[i].first, edges[i].second);
+    }
+
+    CHECK(index.buildCount() == builds);
+
+    int mismatches = 0;
+
+    for (int i = 0; i < 50; ++i)
+    {
+      unsigned const from = vertex(random);
+
+      std::vector<char> const expected = reachableFrom(graph, from);
+
+      for (unsigned to = 0; to < vertexCount; ++to)
+      {
+        if (to != from && index.reaches(from, to) != (expected[to] != 0))
+          ++mismatches;
+      }
+
+      if (index.descendants(from).size() !=
+          static_cast<std::size_t>(std::count(expected.begin(), expected.end(), 1)))
+        ++mismatches;
+    }
+
+    CHECK(mismatches == 0);
+  }
+}
+
+TEST_CASE("ReachabilityIndex takes additions without rebuilding", "[topology]")
+{
+  SECTION("closure")
+  {
+    TopologicalOrder graph;
+    ReachabilityIndex index(graph);
+
+    for (unsigned v = 0; v < 100; ++v)
+    {
+      graph.addVertex(v);
+      index.vertexAdded(v);
+    }
+
+    REQUIRE(graph.addEdge(0, 1));
+    index.edgeAdded(0, 1);
+
+    CHECK(index.reaches(0, 1));
+    REQUIRE(index.buildCount() == 1);
+
+    // past the width of the rows built so far
+    for (unsigned v = 100; v < 200; ++v)
+    {
+      graph.addVertex(v);
+      index.vertexAdded(v);
+    }
+
+    REQUIRE(graph.addEdge(1, 150));
+    index.edgeAdded(1, 150);
+
+    REQUIRE(graph.addEdge(150, 199));
+    index.edgesAdded({ { 150, 199 } });
+
+    CHECK(index.reaches(0, 199));
+    CHECK_FALSE(index.reaches(199, 0));
+    CHECK_FALSE(index.reaches(2, 199));
+    CHECK(index.ancestors(199).size() == 3);
+
+    CHECK(index.buildCount() == 1);
+  }
+
+  SECTION("labels")
+  {
+    unsigned const vertexCount = ReachabilityIndex::ClosureLimit + 10;
+
+    TopologicalOrder graph;
+    ReachabilityIndex index(graph);
+
+    for (unsigned v = 0; v < vertexCount; ++v)
+      graph.addVertex(v);
+
+    for (unsigned v = 1; v < vertexCount; ++v)
+      REQUIRE(graph.addEdge(v - 1, v));
+
+    CHECK_FALSE(index.usesClosure());
+    REQUIRE(index.buildCount() == 1);
+
+    graph.addVertex(vertexCount);
+    index.vertexAdded(vertexCount);
+
+    CHECK(index.reaches(0, vertexCount - 1));
+    CHECK_FALSE(index.reaches(0, vertexCount));
+    CHECK_FALSE(index.reaches(vertexCount, 0));
+
+    CHECK(index.buildCount() == 1);
+  }
+}
@@ -0,0 +1,96 @@
+#include <nodes/SlotMap>
+
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <vector>
+
+using QtNodes::SlotHandle;
+using QtNodes::SlotMap;
+
+TEST_CASE("SlotMap insert, find and erase", "[slotmap]")
+{
+  SlotMap<int> map;
+
+  SlotHandle a = map.insert(1);
+  SlotHandle b = map.insert(2);
+  SlotHandle c = map.insert(3);
+
+  CHECK(map.size() == 3);
+  CHECK(*map.find(a) == 1);
+  CHECK(*map.find(b) == 2);
+  CHECK(*map.find(c) == 3);
+
+  SECTION("erased handles go stale")
+  {
+    CHECK(map.erase(b));
+    CHECK_FALSE(map.contains(b));
+    CHECK(map.find(b) == nullptr);
+    CHECK_FALSE(map.erase(b));
+
+    // the remaining handles still resolve after the values moved
+    CHECK(*map.find(a) == 1);
+    CHECK(*map.find(c) == 3);
+  }
+
+  SECTION("reused slots get a new generation")
+  {
+    map.erase(b);
+    SlotHandle d = map.insert(4);
+
+    CHECK(d.index == b.index);
+    CHECK(d != b);
+    CHECK(map.find(b) == nullptr);
+    CHECK(*map.find(d) == 4);
+  }
+
+  SECTION("iteration is contiguous and deterministic")
+  {
+    map.erase(a);
+
+    std::vector<int> values(map.begin(), map.end());
+
+    CHECK(values == std::vector<int>{3, 2});
+    CHECK(map.handleAt(0) == c);
+    CHECK(map.handleAt(1) == b);
+  }
+
+  SECTION("invalid handle")
+  {
+    CHECK_FALSE(SlotHandle{}.isValid());
+    CHECK(map.find(SlotHandle{}) == nullptr);
+  }
+}
+
+TEST_CASE("SlotMap destroys erased values after updating itself", "[slotmap]")
+{
+  struct Probe
+  {
+    SlotMap<std::unique_ptr<Probe>>* map = nullptr;
+    std::size_t* sizeSeen = nullptr;
+
+    ~Probe()
+    {
+      if (map)
+        *sizeSeen = map->size();
+    }
+  };
+
+  SlotMap<std::unique_ptr<Probe>> map;
+  std::size_t sizeSeen = 0;
+
+  auto probe = std::make_unique<Probe>();
+  probe->map      = &map;
+  probe->sizeSeen = &sizeSeen;
+
+  SlotHandle h = map.insert(std::move(probe));
+  map.insert(std::make_unique<Probe>());
+
+  map.erase(h);
+
+  CHECK(sizeSeen == 1);
+
+  map.clear();
+
+  CHECK(map.empty());
+}
@@ -0,0 +1,74 @@
+#include <nodes/SmallVector>
+
+#include <catch2/catch.hpp>
+
+#include <utility>
+#include <vector>
+
+using QtNodes::SmallVector;
+using QtNodes::Span;
+
+TEST_CASE("SmallVector stays inline up to its capacity", "[smallvector]")
+{
+  SmallVector<int*, 2> v;
+
+  int a = 1, b = 2, c = 3;
+
+  CHECK(v.empty());
+  CHECK(v.capacity() == 2);
+
+  v.push_back(&a);
+  v.push_back(&b);
+
+  CHECK(v.capacity() == 2);
+  CHECK(v.size() == 2);
+
+  v.push_back(&c);
+
+  CHECK(v.capacity() > 2);
+  CHECK(std::vector<int*>(v.begin(), v.end()) == std::vector<int*>{&a, &b, &c});
+
+  SECTION("erase keeps the order")
+  {
+    v.erase(v.begin() + 1);
+
+    CHECK(std::vector<int*>(v.begin(), v.end()) == std::vector<int*>{&a, &c});
+  }
+
+  SECTION("copies and moves")
+  {
+    SmallVector<int*, 2> copy = v;
+    SmallVector<int*, 2> moved = std::move(v);
+
+    CHECK(v.empty());
+    CHECK(copy.size() == 3);
+    CHECK(moved.size() == 3);
+    CHECK(copy[2] == &c);
+    CHECK(moved[2] == &c);
+
+    SmallVector<int*, 2> small{&a};
+    small = copy;
+    CHECK(small.size() == 3);
+
+    copy = SmallVector<int*, 2>{&b};
+    CHECK(copy.size() == 1);
+    CHECK(copy.front() == &b);
+  }
+
+  SECTION("views")
+  {
+    Span<int* const> view = v.view();
+
+    CHECK(view.size() == 3);
+    CHECK(view[0] == &a);
+    CHECK(view.front() == &a);
+  }
+
+  SECTION("clear")
+  {
+    v.clear();
+
+    CHECK(v.empty());
+    CHECK(v.view().empty());
+  }
+}
@@ -0,0 +1,154 @@
+#include <nodes/TopologicalOrder>
+
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <vector>
+
+using QtNodes::TopologicalOrder;
+
+namespace
+{
+
+bool
+isTopological(TopologicalOrder const & topology,
+              std::vector<std::pair<unsigned, unsigned>> const & edges)
+{
+  for (auto const & edge : edges)
+  {
+    if (!topology.precedes(edge.first, edge.second))
+      return false;
+  }
+
+  return true;
+}
+
+}
+
+TEST_CASE("TopologicalOrder keeps edges pointing forward", "[topology]")
+{
+  TopologicalOrder topology;
+
+  for (unsigned v = 0; v < 4; ++v)
+    topology.addVertex(v);
+
+  SECTION("edges against the order move the affected vertices")
+  {
+    CHECK(topology.addEdge(3, 2));
+    CHECK(topology.addEdge(2, 1));
+    CHECK(topology.addEdge(1, 0));
+
+    CHECK(topology.order() == std::vector<unsigned>{3, 2, 1, 0});
+  }
+
+  SECTION("cycles are rejected")
+  {
+    REQUIRE(topology.addEdge(0, 1));
+    REQUIRE(topology.addEdge(1, 2));
+
+    CHECK(topology.wouldCreateCycle(2, 0));
+    CHECK(topology.wouldCreateCycle(1, 1));
+    CHECK_FALSE(topology.wouldCreateCycle(0, 2));
+    CHECK_FALSE(topology.wouldCreateCycle(3, 0));
+
+    CHECK_FALSE(topology.addEdge(2, 0));
+    CHECK(topology.precedes(0, 2));
+
+    SECTION("removing an edge opens the cycle again")
+    {
+      topology.removeEdge(1, 2);
+
+      CHECK_FALSE(topology.wouldCreateCycle(2, 0));
+      CHECK(topology.addEdge(2, 0));
+    }
+
+    SECTION("parallel edges are counted")
+    {
+      REQUIRE(topology.addEdge(1, 2));
+      topology.removeEdge(1, 2);
+
+      CHECK(topology.wouldCreateCycle(2, 0));
+    }
+
+    SECTION("removing a vertex removes its edges")
+    {
+      topology.removeVertex(1);
+
+      CHECK_FALSE(topology.contains(1));
+      CHECK(topology.vertexCount() == 3);
+      CHECK_FALSE(topology.wouldCreateCycle(2, 0));
+    }
+  }
+}
+
+TEST_CASE("TopologicalOrder stays consistent under random updates", "[topology]")
+{
+  std::mt19937 random(7);
+
+  unsigned const vertexCount = 200;
+
+  TopologicalOrder topology;
+  for (unsigned v = 0; v < vertexCount; ++v)
+    topology.addVertex(v);
+
+  std::vector<std::pair<unsigned, unsigned>> edges;
+
+  // reference answer by plain depth first search
+  auto reaches = [&](unsigned from, unsigned to)
+  {
+    std::vector<char> seen(vertexCount, 0);
+    std::vector<unsigned> stack{from};
+
+    while (!stack.empty())
+    {
+      unsigned u = stack.back();
+      stack.pop_back();
+
+      if (u == to)
+        return true;
+
+      for (auto const & edge : edges)
+      {
+        if (edge.first == u && !seen[edge.second])
+        {
+          seen[edge.second] = 1;
+          stack.push_back(edge.second);
+        }
+      }
+    }
+
+    return false;
+  };
+
+  std::uniform_int_distribution<unsigned> vertex(0, vertexCount - 1);
+
+  int mismatches = 0;
+
+  for (int i = 0; i < 2000; ++i)
+  {
+    if (!edges.empty() && random() % 4 == 0)
+    {
+      std::size_t const k = random() % edges.size();
+      topology.removeEdge(edges[k].first, edges[k].second);
+      edges.erase(edges.begin() + k);
+      continue;
+    }
+
+    unsigned const from = vertex(random);
+    unsigned const to   = vertex(random);
+
+    bool const cycle = (from == to) || reaches(to, from);
+
+    if (topology.wouldCreateCycle(from, to) != cycle)
+      ++mismatches;
+
+    if (topology.addEdge(from, to) == cycle)
+      ++mismatches;
+
+    if (!cycle)
+      edges.emplace_back(from, to);
+  }
+
+  CHECK(mismatches == 0);
+  CHECK(isTopological(topology, edges));
+}